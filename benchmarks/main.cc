@@ -0,0 +1,774 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <vector-class/vector.h>
+#include <vector-class/particles.h>
+#include <vector-class/quantize.h>
+#include <vector-class/color_ramp.h>
+#include <vector-class/morton.h>
+#include <vector-class/spatial_hash.h>
+#include <vector-class/polygon.h>
+#include <vector-class/mesh_normals.h>
+#include <vector-class/vector_codec.h>
+#include <vector-class/point_cloud.h>
+#include <vector-class/text_format.h>
+#include <vector-class/pipeline.h>
+#include <vector-class/bounding_sphere.h>
+#include <vector-class/angles.h>
+#include <vector-class/vector_random.h>
+#include <vector-class/noise.h>
+
+//
+// runs fn 'iterations' times and reports items processed per second
+//
+template<typename Fn>
+static double measure(const char* name, size_t items, int iterations, Fn&& fn)
+{
+	fn(); // warm-up
+
+	const auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++)
+		fn();
+	const auto end = std::chrono::steady_clock::now();
+
+	const double seconds = std::chrono::duration<double>(end - start).count() / iterations;
+	printf("%-40s %10.3f ms %12.2f M items/s\n", name, seconds * 1000.0, items / seconds / 1e6);
+	return seconds;
+}
+
+//
+// particles, once far beyond the caches and once resident in them
+//
+static void bench_particles(size_t count, int iterations)
+{
+	printf("%zu particles\n", count);
+
+	ParticleSystem ps(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		ps.SetPosition(i, Vector((float)(i % 1000), (float)(i / 1000 % 1000), (float)(i / 1000000)));
+		ps.SetVelocity(i, Vector(1.0f, 2.0f, 3.0f));
+	}
+	ps.SetAcceleration(Vector(0.0f, 0.0f, -9.81f));
+
+	measure("particles: semi-implicit euler", count, iterations, [&] { ps.StepEuler(1.0f / 60.0f); });
+	measure("particles: semi-implicit euler, uniform", count, iterations, [&] { ps.StepEuler(1.0f / 60.0f, Vector(0.0f, 0.0f, -9.81f)); });
+	measure("particles: verlet", count, iterations, [&] { ps.StepVerlet(1.0f / 60.0f); });
+
+	// reference: one particle at a time using MulAdd
+	std::vector<Vector> pos(count), vel(count, Vector(1.0f, 2.0f, 3.0f));
+	const Vector gravity(0.0f, 0.0f, -9.81f);
+	measure("particles: scalar MulAdd loop", count, iterations, [&]
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			vel[i].MulAdd(vel[i], gravity, 1.0f / 60.0f);
+			pos[i].MulAdd(pos[i], vel[i], 1.0f / 60.0f);
+		}
+	});
+}
+
+static void bench_particles()
+{
+	bench_particles(10'000'000, 10);
+	bench_particles(16'384, 10'000);
+}
+
+//
+// fma mode, speed and accuracy against a double precision reference
+//
+static void bench_fma()
+{
+#ifdef VECTORCLASS_FMA
+	printf("fma: enabled\n");
+#else
+	printf("fma: disabled\n");
+#endif
+
+	const size_t count = 1'000'000;
+
+	// nearly parallel pairs, where the cross product cancels the most
+	std::vector<Vector> a(count), b(count), out(count);
+	uint32_t seed = 1;
+	auto rnd = [&seed]() { seed = seed * 1664525u + 1013904223u; return (float)(seed >> 8) / 16777216.0f - 0.5f; };
+	for (size_t i = 0; i < count; i++)
+	{
+		a[i] = Vector(rnd(), rnd(), rnd()) * 100.0f;
+		b[i] = a[i] + Vector(rnd(), rnd(), rnd()) * 1e-3f;
+	}
+
+	float sink = 0.0f;
+	measure("fma: Dot", count, 20, [&] { for (size_t i = 0; i < count; i++) sink += a[i].Dot(b[i]); });
+	measure("fma: CrossProduct", count, 20, [&] { for (size_t i = 0; i < count; i++) out[i].CrossProduct(a[i], b[i]); });
+	measure("fma: MulAdd", count, 20, [&] { for (size_t i = 0; i < count; i++) out[i].MulAdd(a[i], b[i], 0.5f); });
+	measure("fma: Lerp", count, 20, [&] { for (size_t i = 0; i < count; i++) out[i].Lerp(a[i], b[i], 0.25f); });
+
+	// relative error of the cross product, measured against the magnitude of
+	// the exact result
+	double max_err = 0.0, sum_err = 0.0;
+	for (size_t i = 0; i < count; i++)
+	{
+		Vector c;
+		c.CrossProduct(a[i], b[i]);
+
+		const double ax = a[i].x, ay = a[i].y, az = a[i].z, bx = b[i].x, by = b[i].y, bz = b[i].z;
+		const double rx = ay * bz - az * by, ry = az * bx - ax * bz, rz = ax * by - ay * bx;
+		const double len = std::sqrt(rx * rx + ry * ry + rz * rz);
+		if (len == 0.0)
+			continue;
+
+		const double dx = c.x - rx, dy = c.y - ry, dz = c.z - rz;
+		const double err = std::sqrt(dx * dx + dy * dy + dz * dz) / len;
+
+		max_err = std::max(max_err, err);
+		sum_err += err;
+	}
+
+	printf("fma: CrossProduct relative error: max %.3e, mean %.3e\n", max_err, sum_err / count);
+
+	// printed so that the Dot loop is not optimized away
+	printf("fma: Dot checksum %f\n", sink);
+}
+
+//
+// palette quantization of a 4K image
+//
+static void bench_quantize()
+{
+	const uint32_t width = 3840, height = 2160;
+	const size_t count = (size_t)width * height;
+
+	CImage img(width, height);
+	for (uint32_t y = 0; y < height; y++)
+	{
+		for (uint32_t x = 0; x < width; x++)
+			img.at(x, y) = CColor255((uint8_t)(x * 255 / width), (uint8_t)(y * 255 / height), (uint8_t)((x + y) & 255), 255);
+	}
+
+	CPaletteQuantizer q;
+	measure("quantize: build median cut, 256 colors", count, 5, [&] { q.build(img, 256, CPaletteQuantizer::k_median_cut); });
+	measure("quantize: build k-means, 256 colors", count, 5, [&] { q.build(img, 256, CPaletteQuantizer::k_kmeans); });
+
+	std::vector<uint8_t> indices(count);
+	measure("quantize: map", count, 5, [&] { q.map(img, indices.data()); });
+	measure("quantize: map, dithered", count, 5, [&] { q.map(img, indices.data(), 16.0f); });
+
+	// reference: one pixel at a time, rgb distance with early out
+	const auto& palette = q.palette();
+	measure("quantize: scalar nearest loop", count, 1, [&]
+	{
+		for (uint32_t y = 0; y < height; y++)
+		{
+			for (uint32_t x = 0; x < width; x++)
+			{
+				const CColor255& p = img.at(x, y);
+				int best = INT32_MAX;
+				for (size_t k = 0; k < palette.size(); k++)
+				{
+					const int dr = p.r - palette[k].r, dg = p.g - palette[k].g, db = p.b - palette[k].b;
+					const int d = dr * dr + dg * dg + db * db;
+					if (d < best)
+					{
+						best = d;
+						indices[(size_t)y * width + x] = (uint8_t)k;
+					}
+				}
+			}
+		}
+	});
+}
+
+//
+// scalar to color mapping through a color ramp
+//
+static void bench_color_ramp()
+{
+	const size_t count = 10'000'000;
+
+	CColorRamp ramp;
+	ramp.add_stop(0.0f, CColor(0.0f, 0.0f, 0.5f, 1.0f));
+	ramp.add_stop(0.25f, CColor(0.0f, 0.5f, 1.0f, 1.0f));
+	ramp.add_stop(0.5f, CColor(0.5f, 1.0f, 0.5f, 1.0f));
+	ramp.add_stop(0.75f, CColor(1.0f, 0.5f, 0.0f, 1.0f));
+	ramp.add_stop(1.0f, CColor(0.5f, 0.0f, 0.0f, 1.0f));
+	ramp.build(CColorRamp::k_linear, 1024);
+
+	std::vector<float> values(count);
+	for (size_t i = 0; i < count; i++)
+		values[i] = (float)((i * 7919) % count) / count;
+
+	std::vector<uint32_t> packed(count);
+	measure("color ramp: map to packed", count, 10, [&] { ramp.map(values.data(), count, packed.data()); });
+
+	// reference: search the stops and blend every sample
+	measure("color ramp: sample + as_u32 loop", count, 1, [&]
+	{
+		for (size_t i = 0; i < count; i++)
+			packed[i] = ramp.sample(values[i]).as_u32();
+	});
+}
+
+//
+// morton codes and spatial sort of a shuffled point cloud
+//
+static void bench_morton()
+{
+	const size_t count = 4'000'000;
+
+	std::vector<Vector> points(count);
+	std::vector<CColor255> colors(count);
+	uint32_t seed = 3;
+	auto rnd = [&seed]() { seed = seed * 1664525u + 1013904223u; return (float)(seed >> 8) / 16777216.0f; };
+	for (size_t i = 0; i < count; i++)
+	{
+		points[i] = Vector(rnd(), rnd(), rnd()) * 100.0f;
+		colors[i] = CColor255((uint8_t)i, (uint8_t)(i >> 8), (uint8_t)(i >> 16), 255);
+	}
+
+	Vector mins, maxs;
+	Morton::Bounds(points.data(), count, mins, maxs);
+
+	std::vector<uint32_t> codes32(count);
+	std::vector<uint64_t> codes64(count);
+	measure("morton: encode 30-bit", count, 10, [&] { Morton::Encode32(points.data(), count, mins, maxs, codes32.data()); });
+	measure("morton: encode 63-bit", count, 10, [&] { Morton::Encode64(points.data(), count, mins, maxs, codes64.data()); });
+
+	std::vector<uint32_t> keys(count), values(count);
+	measure("morton: radix sort 30-bit keys", count, 5, [&]
+	{
+		keys = codes32;
+		for (size_t i = 0; i < count; i++)
+			values[i] = (uint32_t)i;
+		detail::radix_sort(keys.data(), values.data(), count, 30);
+	});
+
+	measure("morton: std::sort 30-bit keys", count, 1, [&]
+	{
+		keys = codes32;
+		std::sort(keys.begin(), keys.end());
+	});
+
+	// locality pass: sum of distances between consecutive points
+	auto walk = [&]
+	{
+		float sum = 0.0f;
+		for (size_t i = 1; i < count; i++)
+			sum += points[i].Distance(points[i - 1]);
+		return sum;
+	};
+
+	const float before = walk();
+	measure("morton: sort points with payload", count, 1, [&] { Morton::Sort(points.data(), count, colors.data()); });
+	printf("morton: consecutive distance %.1f -> %.1f\n", before, walk());
+}
+
+//
+// spatial hash broadphase, about one object per cell
+//
+static void bench_spatial_hash()
+{
+	uint32_t seed = 5;
+	auto rnd = [&seed]() { seed = seed * 1664525u + 1013904223u; return (float)(seed >> 8) / 16777216.0f; };
+
+	for (size_t count : { (size_t)100'000, (size_t)1'000'000, (size_t)10'000'000 })
+	{
+		const float side = std::cbrt((float)count);
+		const int iterations = count > 1'000'000 ? 1 : 5;
+
+		std::vector<Vector> pos(count);
+		for (auto& p : pos)
+			p = Vector(rnd(), rnd(), rnd()) * side;
+
+		char name[64];
+		SpatialHash grid(1.0f);
+		std::vector<uint32_t> handles(count);
+
+		snprintf(name, sizeof(name), "spatial hash: insert %zuk", count / 1000);
+		measure(name, count, iterations, [&]
+		{
+			grid.Clear();
+			for (size_t i = 0; i < count; i++)
+				handles[i] = grid.Insert(pos[i]);
+		});
+
+		snprintf(name, sizeof(name), "spatial hash: move %zuk", count / 1000);
+		measure(name, count, iterations, [&]
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				pos[i] += Vector(0.01f, -0.01f, 0.02f);
+				grid.Move(handles[i], pos[i]);
+			}
+		});
+
+		std::vector<SpatialHash::pair_t> pairs;
+		snprintf(name, sizeof(name), "spatial hash: pairs %zuk", count / 1000);
+		measure(name, count, iterations, [&] { grid.FindPairs(1.0f, pairs); });
+		printf("spatial hash: %zu pairs\n", pairs.size());
+	}
+
+	// reference: nested Distance loops over 10k objects
+	const size_t count = 10'000;
+	const float side = std::cbrt((float)count);
+
+	std::vector<Vector> pos(count);
+	for (auto& p : pos)
+		p = Vector(rnd(), rnd(), rnd()) * side;
+
+	size_t found = 0;
+	measure("spatial hash: brute force 10k", count, 1, [&]
+	{
+		found = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			for (size_t j = i + 1; j < count; j++)
+				found += pos[i].Distance(pos[j]) < 1.0f;
+		}
+	});
+
+	SpatialHash grid(1.0f);
+	for (const auto& p : pos)
+		grid.Insert(p);
+
+	std::vector<SpatialHash::pair_t> pairs;
+	measure("spatial hash: pairs 10k", count, 5, [&] { grid.FindPairs(1.0f, pairs); });
+	printf("spatial hash: %zu pairs, brute force %zu\n", pairs.size(), found);
+}
+
+//
+// convex hull and point in polygon
+//
+static void bench_polygon()
+{
+	const size_t count = 4'000'000;
+
+	uint32_t seed = 9;
+	auto rnd = [&seed]() { seed = seed * 1664525u + 1013904223u; return (float)(seed >> 8) / 16777216.0f; };
+
+	std::vector<Vector2D> points(count);
+	for (auto& p : points)
+		p = Vector2D(rnd() - 0.5f, rnd() - 0.5f) * 1000.0f;
+
+	std::vector<Vector2D> hull;
+	measure("polygon: convex hull, prefiltered", count, 5, [&] { Polygon2D::ConvexHull(points.data(), count, hull); });
+	measure("polygon: convex hull, full sort", count, 2, [&] { Polygon2D::ConvexHull(points.data(), count, hull, false); });
+
+	// star shaped polygon with 64 vertices
+	std::vector<Vector2D> star;
+	for (int i = 0; i < 64; i++)
+	{
+		const float angle = i * 6.2831853f / 64.0f, radius = (i & 1) ? 200.0f : 450.0f;
+		star.push_back(Vector2D(std::cos(angle), std::sin(angle)) * radius);
+	}
+
+	std::vector<uint8_t> inside(count);
+	measure("polygon: point in polygon, 64 edges", count, 5, [&] { Polygon2D::Contains(star.data(), star.size(), points.data(), count, inside.data()); });
+}
+
+//
+// vertex normals of a one million triangle grid
+//
+static void bench_mesh_normals()
+{
+	const uint32_t n = 708;
+
+	std::vector<Vector> positions;
+	std::vector<uint32_t> indices;
+	for (uint32_t y = 0; y < n; y++)
+	{
+		for (uint32_t x = 0; x < n; x++)
+			positions.push_back(Vector((float)x, (float)y, std::sin(x * 0.05f) * std::cos(y * 0.07f) * 10.0f));
+	}
+
+	// shuffled rows of triangles, so neighbouring faces are not neighbours in memory
+	for (uint32_t y = 0; y + 1 < n; y++)
+	{
+		const uint32_t row = (y * 337) % (n - 1);
+		for (uint32_t x = 0; x + 1 < n; x++)
+		{
+			const uint32_t i = row * n + x;
+			indices.insert(indices.end(), { i, i + 1, i + n, i + 1, i + n + 1, i + n });
+		}
+	}
+
+	const size_t triangles = indices.size() / 3;
+	std::vector<Vector> normals(positions.size());
+
+	MeshNormals mesh;
+	measure("mesh normals: topology", triangles, 5, [&] { mesh.SetTopology(indices.data(), triangles, positions.size()); });
+	measure("mesh normals: compute", triangles, 10, [&] { mesh.Compute(positions.data(), normals.data()); });
+
+	// reference: serial scatter of CrossProduct into the vertices
+	measure("mesh normals: serial scatter", triangles, 5, [&]
+	{
+		std::fill(normals.begin(), normals.end(), Vector());
+		for (size_t f = 0; f < indices.size(); f += 3)
+		{
+			Vector c;
+			c.CrossProduct(positions[indices[f + 1]] - positions[indices[f]], positions[indices[f + 2]] - positions[indices[f]]);
+			normals[indices[f]] += c;
+			normals[indices[f + 1]] += c;
+			normals[indices[f + 2]] += c;
+		}
+
+		for (auto& v : normals)
+			v.NormalizeInPlace();
+	});
+}
+
+//
+// vector codec
+//
+static void bench_vector_codec()
+{
+	const size_t count = 4'000'000;
+
+	std::vector<Vector> path(count);
+	for (size_t i = 0; i < count; i++)
+		path[i] = Vector(std::sin(i * 1e-4f) * 1000.0f, std::cos(i * 3e-4f) * 500.0f, i * 1e-3f);
+
+	VectorCodec codec(0.001f);
+	std::vector<uint8_t> bytes;
+	std::vector<Vector> decoded;
+
+	measure("vector codec: encode", count, 5, [&] { bytes.clear(); codec.Encode(path.data(), count, bytes); });
+	measure("vector codec: decode", count, 10, [&] { decoded.clear(); VectorCodec::Decode(bytes.data(), bytes.size(), decoded); });
+
+	// chunk by chunk into the same buffer, as a streaming reader would
+	const double seconds = measure("vector codec: decode chunks", count, 10, [&]
+	{
+		size_t offset = 0, n, size, consumed;
+		for (Vector* at = decoded.data(); VectorCodec::PeekChunk(bytes.data() + offset, bytes.size() - offset, n, size); at += n)
+		{
+			VectorCodec::DecodeChunk(bytes.data() + offset, bytes.size() - offset, at, consumed);
+			offset += consumed;
+		}
+	});
+
+	printf("%-40s %10.2f bits/vector %8.2f GB/s decoded\n", "vector codec: ratio", bytes.size() * 8.0 / count,
+		   count * sizeof(Vector) / seconds / 1e9);
+}
+
+//
+// point cloud files
+//
+static void bench_point_cloud()
+{
+	const size_t count = 4'000'000;
+	const char* path = "point_cloud_bench.bin";
+
+	std::vector<Vector> positions(count);
+	std::vector<CColor255> colors(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		positions[i] = Vector(std::sin(i * 1e-3f) * 100.0f, std::cos(i * 7e-4f) * 100.0f, i * 1e-5f);
+		colors[i] = CColor255(i & 255, (i >> 8) & 255, (i >> 16) & 255, 255);
+	}
+
+	measure("point cloud: write", count, 3, [&]
+	{
+		PointCloudWriter writer;
+		writer.Open(path);
+		writer.Write(positions.data(), colors.data(), count);
+		writer.Close();
+	});
+
+	PointCloudReader reader;
+	measure("point cloud: open", count, 10, [&] { reader.Open(path); });
+
+	// touches every point through the mapped spans
+	float sum = 0.0f;
+	measure("point cloud: scan mapped", count, 10, [&]
+	{
+		for (size_t c = 0; c < reader.ChunkCount(); c++)
+		{
+			for (const auto& p : reader.Positions(c))
+				sum += p.x;
+		}
+	});
+
+	reader.Close();
+	std::remove(path);
+	printf("%-40s %f\n", "point cloud: checksum", sum);
+}
+
+//
+// text formatting and parsing, items are bytes of text
+//
+static void bench_text_format()
+{
+	const size_t count = 1'000'000;
+
+	std::vector<Vector> values(count);
+	for (size_t i = 0; i < count; i++)
+		values[i] = Vector(std::sin(i * 1e-3f) * 100.0f, std::cos(i * 7e-4f) * 1e-3f, i * 0.5f);
+
+	std::vector<char> text(count * TextFormat::MaxChars<Vector>());
+	size_t written = 0, bytes = 0;
+	bytes = TextFormat::Format(text.data(), text.data() + text.size(), values.data(), count, written) - text.data();
+
+	measure("text: format to_chars (bytes)", bytes, 5, [&]
+	{
+		TextFormat::Format(text.data(), text.data() + text.size(), values.data(), count, written);
+	});
+
+	std::string streamed;
+	measure("text: format ostringstream (bytes)", bytes, 2, [&]
+	{
+		std::ostringstream out;
+		out.precision(9);
+		for (const auto& v : values)
+			out << v.x << ' ' << v.y << ' ' << v.z << '\n';
+		streamed = out.str();
+	});
+
+	std::vector<Vector> parsed(count);
+	size_t count_parsed = 0;
+	measure("text: parse from_chars (bytes)", bytes, 5, [&]
+	{
+		TextFormat::Parse(text.data(), text.data() + bytes, parsed.data(), count, count_parsed);
+	});
+
+	measure("text: parse istringstream (bytes)", bytes, 2, [&]
+	{
+		std::istringstream in(std::string(text.data(), bytes));
+		for (auto& v : parsed)
+			in >> v.x >> v.y >> v.z;
+	});
+}
+
+//
+// coroutine pipelines
+//
+static void bench_pipeline()
+{
+	const size_t count = 10'000'000;
+
+	std::vector<Vector> points(count);
+	for (size_t i = 0; i < count; i++)
+		points[i] = Vector(std::sin(i * 1e-3f) * 100.0f, std::cos(i * 7e-4f) * 100.0f, (float)(i % 1000));
+
+	auto transform = [](VectorStream::chunk_t chunk)
+	{
+		for (auto& v : chunk)
+			v = Vector(v.x * 0.5f + 1.0f, v.y * 0.5f - 1.0f, v.z * 2.0f);
+	};
+
+	auto cull = [](const Vector& v) { return v.x > 0.0f && v.z < 1000.0f; };
+
+	// reference: every stage materializes a full copy
+	size_t kept = 0;
+	measure("pipeline: materialized stages", count, 5, [&]
+	{
+		std::vector<Vector> copy(points);
+		transform(VectorStream::chunk_t(copy));
+
+		std::vector<Vector> visible;
+		for (const auto& v : copy)
+		{
+			if (cull(v))
+				visible.push_back(v);
+		}
+		kept = visible.size();
+	});
+
+	measure("pipeline: chunked stream", count, 5, [&]
+	{
+		kept = 0;
+		VectorStream::FromArray(points.data(), count).Transform(transform).Filter(cull).ForEach([&](VectorStream::chunk_t chunk) { kept += chunk.size(); });
+	});
+
+	measure("pipeline: chunked stream, parallel", count, 5, [&]
+	{
+		kept = 0;
+		VectorStream::FromArray(points.data(), count).TransformParallel(transform).Filter(cull).ForEach([&](VectorStream::chunk_t chunk) { kept += chunk.size(); });
+	});
+}
+
+//
+// bounding spheres
+//
+static void bench_bounding_sphere()
+{
+	const size_t clusters = 250'000, size = 16;
+
+	std::vector<Vector> points;
+	std::vector<uint32_t> offsets = { 0 };
+	points.reserve(clusters * size);
+	for (size_t c = 0; c < clusters; c++)
+	{
+		const Vector center((float)(c % 1000), (float)(c / 1000), 0.0f);
+		for (size_t i = 0; i < size; i++)
+		{
+			const float t = (c * size + i) * 0.7f;
+			points.push_back(center + Vector(std::sin(t), std::cos(t * 1.3f), std::sin(t * 0.4f)) * 0.5f);
+		}
+		offsets.push_back((uint32_t)points.size());
+	}
+
+	const size_t count = points.size();
+	SphereBatch spheres;
+
+	// reference: centroid, then the farthest point with Distance
+	measure("bounding sphere: centroid + Distance", count, 5, [&]
+	{
+		spheres.Resize(clusters);
+		for (size_t c = 0; c < clusters; c++)
+		{
+			Vector center;
+			for (uint32_t i = offsets[c]; i < offsets[c + 1]; i++)
+				center += points[i];
+			center /= (float)(offsets[c + 1] - offsets[c]);
+
+			float radius = 0.0f;
+			for (uint32_t i = offsets[c]; i < offsets[c + 1]; i++)
+				radius = std::max(radius, center.Distance(points[i]));
+
+			spheres.Set(c, center, radius);
+		}
+	});
+
+	measure("bounding sphere: ritter batch", count, 5, [&] { BoundingSphere::Ritter(points.data(), offsets.data(), clusters, spheres); });
+	measure("bounding sphere: welzl batch", count, 5, [&] { BoundingSphere::Welzl(points.data(), offsets.data(), clusters, spheres); });
+
+	// one large set
+	measure("bounding sphere: ritter, one set", count, 5, [&] { BoundingSphere::Ritter(points.data(), count); });
+}
+
+//
+// euler angles
+//
+static void bench_angles()
+{
+	const size_t count = 32'768;
+	const float deg_to_rad = 3.14159265f / 180.0f;
+
+	std::vector<Vector> angles(count), forward(count), right(count), up(count), back(count);
+	for (size_t i = 0; i < count; i++)
+		angles[i] = Vector((float)(i % 170) - 85.0f, (float)(i * 7 % 360), (float)(i * 13 % 360) - 180.0f);
+
+	// reference: one entity at a time with the library functions
+	measure("angles: AngleVectors, std::sin/cos", count, 500, [&]
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			const float sp = std::sin(angles[i].x * deg_to_rad), cp = std::cos(angles[i].x * deg_to_rad);
+			const float sy = std::sin(angles[i].y * deg_to_rad), cy = std::cos(angles[i].y * deg_to_rad);
+			const float sr = std::sin(angles[i].z * deg_to_rad), cr = std::cos(angles[i].z * deg_to_rad);
+
+			forward[i] = Vector(cp * cy, cp * sy, -sp);
+			right[i] = Vector(-sr * sp * cy + cr * sy, -sr * sp * sy - cr * cy, -sr * cp);
+			up[i] = Vector(cr * sp * cy + sr * sy, cr * sp * sy - sr * cy, cr * cp);
+		}
+	});
+
+	measure("angles: AngleVectors batch", count, 500, [&] { EulerAngles::AngleVectors(angles.data(), count, forward.data(), right.data(), up.data()); });
+	measure("angles: AngleVectors batch, forward", count, 500, [&] { EulerAngles::AngleVectors(angles.data(), count, forward.data()); });
+
+	measure("angles: VectorAngles, std::atan2", count, 500, [&]
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			const Vector& f = forward[i];
+			float yaw = std::atan2(f.y, f.x) / deg_to_rad;
+			float pitch = std::atan2(-f.z, std::sqrt(f.x * f.x + f.y * f.y)) / deg_to_rad;
+			back[i] = Vector(pitch < 0.0f ? pitch + 360.0f : pitch, yaw < 0.0f ? yaw + 360.0f : yaw, 0.0f);
+		}
+	});
+
+	measure("angles: VectorAngles batch", count, 500, [&] { EulerAngles::VectorAngles(forward.data(), count, back.data()); });
+}
+
+//
+// random vectors
+//
+static void bench_vector_random()
+{
+	const size_t count = 1'000'000;
+	std::vector<Vector> out(count);
+
+	// reference: a random point in the cube, normalized, which is also biased
+	std::mt19937 engine(1234);
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+	measure("random: mt19937 + Normalize", count, 10, [&]
+	{
+		for (size_t i = 0; i < count; i++)
+			out[i] = Vector(dist(engine), dist(engine), dist(engine)).Normalize();
+	});
+
+	VectorRandom rng(1234);
+	measure("random: OnSphere", count, 10, [&] { rng.OnSphere(out.data(), count); });
+	measure("random: InBox", count, 10, [&] { rng.InBox(out.data(), count, Vector(-1.0f, -1.0f, -1.0f), Vector(1.0f, 1.0f, 1.0f)); });
+
+	measure("random: OnSphere, parallel", count, 10, [&]
+	{
+		VectorRandom::Parallel(1234, out.data(), count, [](auto& rng, Vector* out, size_t n) { rng.OnSphere(out, n); });
+	});
+}
+
+//
+// gradient noise
+//
+static void bench_noise()
+{
+	const size_t count = 1'000'000;
+	const GradientNoise noise(1234);
+
+	std::vector<Vector> points(count);
+	std::vector<float> x(count), y(count), z(count), out(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		points[i] = Vector((float)(i % 1000) * 0.05f, (float)(i / 1000) * 0.05f, (float)(i % 7) * 0.3f);
+		x[i] = points[i].x;
+		y[i] = points[i].y;
+		z[i] = points[i].z;
+	}
+
+	// reference: one position at a time
+	measure("noise: perlin, one at a time", count, 5, [&]
+	{
+		for (size_t i = 0; i < count; i++)
+			out[i] = noise.Perlin(points[i]);
+	});
+
+	measure("noise: perlin batch", count, 5, [&] { noise.Perlin(x.data(), y.data(), z.data(), count, out.data()); });
+	measure("noise: perlin batch, vectors", count, 5, [&] { noise.Perlin(points.data(), count, out.data()); });
+	measure("noise: simplex batch", count, 5, [&] { noise.Simplex(x.data(), y.data(), z.data(), count, out.data()); });
+
+	GradientNoise::fbm_t fbm;
+	measure("noise: fbm, 5 octaves perlin, one at a time", count, 5, [&]
+	{
+		for (size_t i = 0; i < count; i++)
+			out[i] = noise.Fbm(fbm, points[i]);
+	});
+	measure("noise: fbm, 5 octaves perlin", count, 5, [&] { noise.Fbm(fbm, x.data(), y.data(), z.data(), count, out.data()); });
+
+	fbm.kind = GradientNoise::k_simplex;
+	measure("noise: fbm grid 100^3, simplex", count, 5, [&] { noise.FbmGrid(fbm, Vector(), 0.05f, 100, 100, 100, out.data()); });
+}
+
+int main()
+{
+	bench_particles();
+	bench_fma();
+	bench_quantize();
+	bench_color_ramp();
+	bench_morton();
+	bench_spatial_hash();
+	bench_polygon();
+	bench_mesh_normals();
+	bench_vector_codec();
+	bench_point_cloud();
+	bench_text_format();
+	bench_pipeline();
+	bench_bounding_sphere();
+	bench_angles();
+	bench_vector_random();
+	bench_noise();
+}
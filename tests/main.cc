@@ -1,8 +1,38 @@
 #include <iostream>
 #include <cassert>
+#include <algorithm>
+#include <array>
+#include <thread>
+#include <limits>
+#include <bit>
+#include <cstring>
+#include <string_view>
+#include <memory>
 
 #include <vector-class/vector.h>
 #include <vector-class/color.h>
+#include <vector-class/particles.h>
+#include <vector-class/spline.h>
+#include <vector-class/distance.h>
+#include <vector-class/ray.h>
+#include <vector-class/culling.h>
+#include <vector-class/color_space.h>
+#include <vector-class/image.h>
+#include <vector-class/quantize.h>
+#include <vector-class/color_ramp.h>
+#include <vector-class/pixel_format.h>
+#include <vector-class/morton.h>
+#include <vector-class/spatial_hash.h>
+#include <vector-class/polygon.h>
+#include <vector-class/mesh_normals.h>
+#include <vector-class/vector_codec.h>
+#include <vector-class/point_cloud.h>
+#include <vector-class/text_format.h>
+#include <vector-class/pipeline.h>
+#include <vector-class/bounding_sphere.h>
+#include <vector-class/angles.h>
+#include <vector-class/vector_random.h>
+#include <vector-class/noise.h>
 
 int main()
 {
@@ -32,6 +62,1523 @@ int main()
 		assert(clr_special2.r == 255ull && clr_special2.g == 0ull && clr_special2.b == 0ull && clr_special2.a == 255ull);
 	}
 
+	//
+	// constant evaluation
+	//
+	{
+		static_assert(Vector(3.0f, 4.0f, 0.0f).Length() == 5.0f);
+		static_assert(Vector(3.0f, 4.0f, 12.0f).Length2D() == 5.0f);
+		static_assert(Vector2D(1.0f, 1.0f).Distance(Vector2D(4.0f, 5.0f)) == 5.0f);
+		static_assert(Vector(0.0f, 0.0f, 0.0f).Normalize() == Vector(0.0f, 0.0f, 1.0f));
+
+		// table of normalized directions baked at compile time
+		constexpr auto directions = []()
+		{
+			std::array<Vector, 16> out;
+			for (int i = 0; i < 16; i++)
+				out[i] = Vector((float)(i % 4) - 1.5f, (float)(i / 4) - 1.5f, 1.0f).Normalize();
+			return out;
+		}();
+
+		for (int i = 0; i < 16; i++)
+			assert(directions[i] == Vector((float)(i % 4) - 1.5f, (float)(i / 4) - 1.5f, 1.0f).Normalize());
+
+		// compile time square root matches the runtime one for floats
+		for (float f = 1e-30f; f < 1e30f; f *= 1.37f)
+			assert(detail::constexpr_sqrt(f) == sqrtf(f));
+		assert(detail::constexpr_sqrt(0.0f) == 0.0f && detail::constexpr_sqrt(-1.0f) != detail::constexpr_sqrt(-1.0f));
+		assert(fabs(detail::constexpr_sqrt(2.0) - sqrt(2.0)) <= 2.3e-16);
+	}
+
+	//
+	// instrumentation
+	//
+	{
+		Instrumentation::Reset();
+
+		Vector v(1.0f, 2.0f, 3.0f);
+		v.Normalize();
+		v.NormalizeInPlace();
+		(void)v.Distance(Vector());
+		(void)CColor255(1, 2, 3, 4).as_u32();
+
+		std::thread([]() { (void)Vector2D(3.0f, 4.0f).Length(); }).join();
+
+		const auto snapshot = Instrumentation::Snapshot();
+		const uint64_t expected = Instrumentation::k_enabled ? 1 : 0;
+		assert(snapshot[Instrumentation::k_vector_normalize] == expected);
+		assert(snapshot[Instrumentation::k_vector_normalize_in_place] == expected);
+		assert(snapshot[Instrumentation::k_vector_distance] == expected);
+		assert(snapshot[Instrumentation::k_vector_length] == 0);
+		assert(snapshot[Instrumentation::k_color255_as_u32] == expected);
+		assert(snapshot[Instrumentation::k_vector2d_length] == expected);
+
+		Instrumentation::Reset();
+		assert(Instrumentation::Snapshot()[Instrumentation::k_vector_normalize] == 0);
+	}
+
+	//
+	// particles
+	//
+	{
+		ParticleSystem ps;
+		ps.Add(Vector(0.0f, 0.0f, 0.0f), Vector(1.0f, 0.0f, 0.0f), Vector(0.0f, 0.0f, -10.0f));
+		ps.Add(Vector(5.0f, 5.0f, 5.0f));
+
+		// semi-implicit euler matches two MulAdd calls
+		ps.StepEuler(0.5f);
+		Vector vel, pos;
+		vel.MulAdd(Vector(1.0f, 0.0f, 0.0f), Vector(0.0f, 0.0f, -10.0f), 0.5f);
+		pos.MulAdd(Vector(0.0f, 0.0f, 0.0f), vel, 0.5f);
+		assert(ps.GetVelocity(0) == vel && ps.GetPosition(0) == pos);
+		assert(ps.GetPosition(1) == Vector(5.0f, 5.0f, 5.0f));
+
+		// verlet continues with the velocity implied by the last step
+		ps.StepVerlet(0.5f);
+		assert(ps.GetPosition(0).x == 1.0f);
+		assert(ps.GetPosition(0).z == -2.5f + -2.5f + -10.0f * 0.25f);
+
+		Vector out[2];
+		ps.Interpolate(0.5f, out);
+		Vector mid;
+		mid.Lerp(ps.GetPreviousPosition(0), ps.GetPosition(0), 0.5f);
+		assert(out[0] == mid);
+
+		ParticleSystem ps1;
+		ps1.Add(Vector(0.0f, 0.0f, 0.0f), Vector(1.0f, 0.0f, 0.0f));
+		ps1.StepEuler(0.5f, Vector(0.0f, 0.0f, -10.0f));
+		assert(ps1.GetPosition(0) == pos);
+
+		// double systems interpolate without going through float
+		ParticleSystemT<double> psd;
+		psd.Add(VectorT<double>(0.0, 0.0, 0.0), VectorT<double>(1.0, 0.0, 0.0));
+		psd.StepEuler(0.5);
+		VectorT<double> outd;
+		psd.Interpolate(0.1, &outd);
+		assert(outd.x == 0.5 * 0.1);
+	}
+
+	//
+	// splines
+	//
+	{
+		const Vector pts[4] = { { 0.0f, 0.0f, 0.0f }, { 1.0f, 2.0f, 0.0f }, { 3.0f, 2.0f, 1.0f }, { 4.0f, 0.0f, 1.0f } };
+
+		// bezier matches de casteljau built from Lerp
+		Spline bezier = Spline::FromBezier(pts, 4);
+		assert(bezier.SegmentCount() == 1);
+
+		const float t[5] = { -1.0f, 0.0f, 0.25f, 0.5f, 2.0f };
+		Vector out[5];
+		bezier.Evaluate(t, 5, out);
+		assert(out[0] == pts[0] && out[1] == pts[0] && out[4] == pts[3]);
+
+		Vector a, b, c, d, e, f;
+		a.Lerp(pts[0], pts[1], 0.25f); b.Lerp(pts[1], pts[2], 0.25f); c.Lerp(pts[2], pts[3], 0.25f);
+		d.Lerp(a, b, 0.25f); e.Lerp(b, c, 0.25f); f.Lerp(d, e, 0.25f);
+		assert(out[2].Distance(f) < 1e-5f);
+		assert(bezier.Evaluate(0.25f) == out[2]);
+
+		// catmull-rom passes through its points
+		Spline cr = Spline::FromCatmullRom(pts, 4);
+		assert(cr.SegmentCount() == 3);
+		assert(cr.Evaluate(1.0f) == pts[1] && cr.Evaluate(2.0f) == pts[2] && cr.Evaluate(3.0f) == pts[3]);
+
+		// hermite with tangents matching a straight line
+		const Vector2D line[2] = { { 0.0f, 0.0f }, { 10.0f, 0.0f } }, tangents[2] = { { 10.0f, 0.0f }, { 10.0f, 0.0f } };
+		Spline2D hermite = Spline2D::FromHermite(line, tangents, 2);
+		hermite.BuildArcLength(64);
+		assert(fabsf(hermite.ArcLength() - 10.0f) < 1e-4f);
+		assert(fabsf(hermite.ParameterAtDistance(5.0f) - 0.5f) < 1e-4f);
+
+		Vector2D resampled[11];
+		hermite.ResampleUniform(11, resampled);
+		for (int i = 0; i < 11; i++)
+			assert(fabsf(resampled[i].x - (float)i) < 1e-3f);
+	}
+
+	//
+	// pairwise distances
+	//
+	{
+		std::vector<Vector> a, b;
+		for (int i = 0; i < 100; i++)
+			a.push_back(Vector((float)(i % 10), (float)(i / 10), 0.0f));
+		for (int i = 0; i < 1500; i++)
+			b.push_back(Vector((float)(i % 7) * 0.5f, (float)(i % 13), (float)(i % 3)));
+
+		PointSet sa(a.data(), a.size()), sb(b.data(), b.size());
+
+		std::vector<float> matrix(a.size() * b.size());
+		sa.DistanceSqrMatrix(sb, matrix.data());
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			for (size_t j = 0; j < b.size(); j++)
+				assert(fabsf(matrix[i * b.size() + j] - (a[i] - b[j]).LengthSqr()) < 1e-3f);
+		}
+
+		std::vector<PointSet::pair_t> pairs;
+		sa.FindWithin(sb, 1.0f, pairs);
+		size_t expected = 0;
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			for (size_t j = 0; j < b.size(); j++)
+				expected += (a[i] - b[j]).LengthSqr() < 1.0f;
+		}
+		assert(pairs.size() == expected);
+		for (size_t i = 1; i < pairs.size(); i++)
+			assert(pairs[i - 1].i < pairs[i].i || (pairs[i - 1].i == pairs[i].i && pairs[i - 1].j < pairs[i].j));
+
+		std::vector<uint32_t> nearest(a.size() * 3);
+		std::vector<float> nearest_d(a.size() * 3);
+		sa.FindNearest(sb, 3, nearest.data(), nearest_d.data());
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			float best = 1e30f;
+			for (size_t j = 0; j < b.size(); j++)
+				best = std::min(best, (a[i] - b[j]).LengthSqr());
+			assert(fabsf(nearest_d[i * 3] - best) < 1e-3f);
+			assert(nearest_d[i * 3] <= nearest_d[i * 3 + 1] && nearest_d[i * 3 + 1] <= nearest_d[i * 3 + 2]);
+		}
+	}
+
+	//
+	// rays
+	//
+	{
+		const Vector v0(-1.0f, -1.0f, 5.0f), v1(1.0f, -1.0f, 5.0f), v2(-1.0f, 1.0f, 5.0f);
+
+		Ray r(Vector(-0.5f, -0.5f, 0.0f), Vector(0.0f, 0.0f, 1.0f));
+		float t, u, v;
+		assert(r.IntersectTriangle(v0, v1, v2, t, u, v));
+		assert(t == 5.0f && u == 0.25f && v == 0.25f);
+		assert(!r.IntersectTriangle(v0, v1, v2, t, u, v, 4.0f));
+
+		// second triangle is in front of the first one
+		const Vector shift(0.0f, 0.0f, -2.0f);
+
+		TriangleBatch tris;
+		tris.Add(v0, v1, v2);
+		tris.Add(v0 + shift, v1 + shift, v2 + shift);
+
+		// rays in a row, the last ones miss
+		std::vector<Ray> rays;
+		for (int i = 0; i < 13; i++)
+			rays.push_back(Ray(Vector(-0.9f + i * 0.2f, -0.5f, 0.0f), Vector(0.0f, 0.0f, 1.0f)));
+
+		std::vector<RayHit> hits(rays.size());
+		tris.Trace(rays.data(), rays.size(), hits.data());
+		for (size_t i = 0; i < rays.size(); i++)
+		{
+			const bool expected = rays[i].IntersectTriangle(v0 + shift, v1 + shift, v2 + shift, t, u, v);
+			assert(expected == (hits[i].prim == 1));
+			assert(expected || hits[i].prim == UINT32_MAX);
+			assert(!expected || (fabsf(hits[i].t - t) < 1e-5f && fabsf(hits[i].u - u) < 1e-5f && fabsf(hits[i].v - v) < 1e-5f));
+		}
+
+		AABBBatch boxes;
+		boxes.Add(Vector(-1.0f, -1.0f, 2.0f), Vector(1.0f, 1.0f, 4.0f));
+		boxes.Add(Vector(5.0f, 5.0f, 5.0f), Vector(6.0f, 6.0f, 6.0f));
+
+		RayPacket<4> packet;
+		packet.Load(rays.data(), 4);
+
+		float tnear[2 * 4];
+		boxes.Intersect(packet, tnear);
+		for (int i = 0; i < 4; i++)
+			assert(tnear[i] == 2.0f && tnear[4 + i] == INFINITY);
+	}
+
+	//
+	// culling
+	//
+	{
+		Plane p = Plane::FromPoints(Vector(0.0f, 0.0f, 1.0f), Vector(1.0f, 0.0f, 1.0f), Vector(0.0f, 1.0f, 1.0f));
+		assert(p.normal == Vector(0.0f, 0.0f, 1.0f) && p.dist == 1.0f);
+		assert(p.DistanceTo(Vector(5.0f, 5.0f, 3.0f)) == 2.0f);
+
+		Frustum f = Frustum::FromPerspective(Vector(0.0f, 0.0f, 0.0f), Vector(1.0f, 0.0f, 0.0f), Vector(0.0f, -1.0f, 0.0f),
+											 Vector(0.0f, 0.0f, 1.0f), 90.0f, 90.0f, 1.0f, 100.0f);
+		assert(f.PlaneCount() == 6);
+
+		SphereBatch spheres;
+		AABBBatch boxes;
+		for (int i = 0; i < 3000; i++)
+		{
+			const Vector c((float)(i % 200) - 50.0f, (float)(i % 37) - 18.0f, (float)(i % 11) - 5.0f);
+			spheres.Add(c, 1.0f + (float)(i % 3));
+			boxes.Add(c - Vector(1.0f, 2.0f, 3.0f), c + Vector(1.0f, 2.0f, 3.0f));
+		}
+
+		std::vector<uint8_t> cache(spheres.Size());
+		for (int frame = 0; frame < 2; frame++)
+		{
+			std::vector<uint32_t> vis_spheres, vis_boxes;
+			f.CullSpheres(spheres, vis_spheres, cache.data());
+			f.CullBoxes(boxes, vis_boxes);
+
+			size_t n = 0;
+			for (size_t i = 0; i < spheres.Size(); i++)
+			{
+				if (f.IsSphereVisible(spheres.GetCenter(i), spheres.GetRadius(i)))
+					assert(vis_spheres[n++] == i);
+			}
+			assert(n == vis_spheres.size() && n > 0 && n < spheres.Size());
+
+			n = 0;
+			for (size_t i = 0; i < boxes.Size(); i++)
+			{
+				if (f.IsBoxVisible(boxes.GetMins(i), boxes.GetMaxs(i)))
+					assert(vis_boxes[n++] == i);
+			}
+			assert(n == vis_boxes.size());
+		}
+	}
+
+	//
+	// fused multiply-add
+	//
+	{
+		// (1 + 2^-12)^2 = 1 + 2^-11 + 2^-24 rounds to 1 + 2^-11 in float, so
+		// the exact difference of 2^-24 is lost when the product is rounded
+		const float a = 1.0f + 0x1p-12f, c = 1.0f + 0x1p-11f;
+		volatile float ab = a * a;
+		assert(ab - c == 0.0f);
+
+		const float fma = detail::vector_fma(a, a, -c);
+		const float dop = detail::vector_diff_of_products(a, a, c, 1.0f);
+#ifdef VECTORCLASS_FMA
+		assert(fma == 0x1p-24f && dop == 0x1p-24f);
+#else
+		// the compiler may still contract the plain expression
+		assert((fma == 0.0f || fma == 0x1p-24f) && (dop == 0.0f || dop == 0x1p-24f));
+#endif
+
+		// nearly parallel vectors, z of the cross product cancels the same way
+		Vector cross;
+		cross.CrossProduct(Vector(a, 1.0f, 0.0f), Vector(c, a, 0.0f));
+		assert(cross.x == 0.0f && cross.y == 0.0f);
+#ifdef VECTORCLASS_FMA
+		assert(cross.z == 0x1p-24f);
+#endif
+
+		// result may alias either operand
+		const Vector u(1.0f, 2.0f, 3.0f), v(-2.0f, 0.5f, 4.0f);
+		Vector expected;
+		expected.CrossProduct(u, v);
+		assert(expected == Vector(6.5f, -10.0f, 4.5f));
+
+		Vector alias_a = u, alias_b = v;
+		alias_a.CrossProduct(alias_a, v);
+		alias_b.CrossProduct(u, alias_b);
+		assert(alias_a == expected && alias_b == expected);
+
+		Vector self = u;
+		assert(self.CrossProduct(self, self) == Vector(0.0f, 0.0f, 0.0f));
+	}
+
+	//
+	// color spaces
+	//
+	{
+		// pure red, green and blue land on thirds of the hue circle
+		assert(CColorSpace::rgb_to_hsv(CColor(1.0f, 0.0f, 0.0f, 1.0f)).r == 0.0f);
+		assert(fabsf(CColorSpace::rgb_to_hsv(CColor(0.0f, 1.0f, 0.0f, 1.0f)).r - 1.0f / 3.0f) < 1e-6f);
+		assert(fabsf(CColorSpace::rgb_to_hsv(CColor(0.0f, 0.0f, 1.0f, 1.0f)).r - 2.0f / 3.0f) < 1e-6f);
+
+		const CColor hsl = CColorSpace::rgb_to_hsl(CColor(0.0f, 0.5f, 1.0f, 0.25f));
+		assert(fabsf(hsl.r - 7.0f / 12.0f) < 1e-6f && fabsf(hsl.g - 1.0f) < 1e-6f && fabsf(hsl.b - 0.5f) < 1e-6f && hsl.a == 0.25f);
+
+		// round trips over a grid of colors
+		std::vector<CColor> colors, converted(216), back(216);
+		for (int i = 0; i < 216; i++)
+			colors.push_back(CColor((i % 6) / 5.0f, (i / 6 % 6) / 5.0f, (i / 36) / 5.0f, 1.0f));
+
+		auto close = [](const CColor& a, const CColor& b)
+		{
+			return fabsf(a.r - b.r) < 1e-5f && fabsf(a.g - b.g) < 1e-5f && fabsf(a.b - b.b) < 1e-5f && a.a == b.a;
+		};
+
+		CColorSpace::rgb_to_hsv(colors.data(), converted.data(), colors.size());
+		CColorSpace::hsv_to_rgb(converted.data(), back.data(), colors.size());
+		for (size_t i = 0; i < colors.size(); i++)
+			assert(close(colors[i], back[i]) && converted[i].r >= 0.0f && converted[i].r < 1.0f);
+
+		CColorSpace::rgb_to_hsl(colors.data(), converted.data(), colors.size());
+		CColorSpace::hsl_to_rgb(converted.data(), back.data(), colors.size());
+		for (size_t i = 0; i < colors.size(); i++)
+			assert(close(colors[i], back[i]));
+
+		CColorSpace::rgb_to_ycbcr(colors.data(), converted.data(), colors.size());
+		CColorSpace::ycbcr_to_rgb(converted.data(), back.data(), colors.size());
+		for (size_t i = 0; i < colors.size(); i++)
+			assert(close(colors[i], back[i]));
+
+		// fixed point ycbcr stays within one unit of the float path
+		std::vector<CColor255> pixels, ycc(4096), rgb(4096);
+		for (int i = 0; i < 4096; i++)
+			pixels.push_back(CColor255((uint8_t)(i * 37), (uint8_t)(i * 91), (uint8_t)(i * 13), 200));
+
+		CColorSpace::rgb_to_ycbcr(pixels.data(), ycc.data(), pixels.size());
+		CColorSpace::ycbcr_to_rgb(ycc.data(), rgb.data(), pixels.size());
+		for (size_t i = 0; i < pixels.size(); i++)
+		{
+			const CColor ref = CColorSpace::rgb_to_ycbcr(CColor::construct_from_integral(pixels[i].r, pixels[i].g, pixels[i].b, pixels[i].a));
+			assert(fabsf(ycc[i].r - ref.r * 255.0f) <= 1.0f && fabsf(ycc[i].g - ref.g * 255.0f) <= 1.0f && fabsf(ycc[i].b - ref.b * 255.0f) <= 1.0f);
+			assert(abs(rgb[i].r - pixels[i].r) <= 2 && abs(rgb[i].g - pixels[i].g) <= 2 && abs(rgb[i].b - pixels[i].b) <= 2);
+			assert(ycc[i].a == 200 && rgb[i].a == 200);
+		}
+	}
+
+	//
+	// images
+	//
+	{
+		CImage img(100, 50);
+		assert(img.width() == 100 && img.height() == 50 && img.stride() >= 100);
+		assert(reinterpret_cast<uintptr_t>(img.row(1)) % CImage::k_alignment == 0);
+
+		const CColor255 red(255, 0, 0, 255), blue(0, 0, 255, 255);
+		img.fill(red);
+		img.fill_rect(-10, -10, 20, 20, blue);
+		assert(img.at(9, 9) == blue && img.at(10, 9) == red && img.at(0, 10) == red);
+
+		// blit clipped on both sides, then overlapping within the image
+		CImage other(10, 10);
+		other.fill(red);
+		other.blit(img, -5, 0, 20, 20, 0, 0);
+		assert(other.at(4, 0) == red && other.at(5, 0) == blue && other.at(9, 9) == blue);
+
+		img.fill(red);
+		img.at(0, 0) = blue;
+		img.blit(img, 0, 0, 10, 10, 1, 1);
+		assert(img.at(1, 1) == blue && img.at(0, 0) == blue && img.at(2, 2) == red);
+
+		// box downscale of a 2x2 checker averages it
+		CImage checker(64, 64), small(32, 32);
+		for (uint32_t y = 0; y < 64; y++)
+		{
+			for (uint32_t x = 0; x < 64; x++)
+				checker.at(x, y) = ((x ^ y) & 1) ? CColor255(200, 100, 0, 255) : CColor255(0, 50, 100, 255);
+		}
+		checker.resize_box(small);
+		assert(small.at(0, 0) == CColor255(100, 75, 50, 255) && small.at(31, 31) == CColor255(100, 75, 50, 255));
+
+		// more than 2^32 / 255 source pixels per destination pixel, once over
+		// many columns and once over many rows
+		CImage one(1, 1), square(4200, 4200), column(1, 16843010);
+		square.fill(CColor255(255, 255, 255, 255));
+		square.resize_box(one);
+		assert(one.at(0, 0) == CColor255(255, 255, 255, 255));
+
+		column.fill(CColor255(255, 1, 254, 255));
+		column.resize_box(one);
+		assert(one.at(0, 0) == CColor255(255, 1, 254, 255));
+
+		// bilinear keeps constant images constant and interpolates gradients
+		CImage flat(7, 5), big(33, 21);
+		flat.fill(CColor255(10, 20, 30, 40));
+		flat.resize_bilinear(big);
+		assert(big.at(0, 0) == CColor255(10, 20, 30, 40) && big.at(32, 20) == CColor255(10, 20, 30, 40));
+
+		CImage ramp(2, 1), wide(4, 1);
+		ramp.at(0, 0) = CColor255(0, 0, 0, 0);
+		ramp.at(1, 0) = CColor255(200, 200, 200, 200);
+		ramp.resize_bilinear(wide);
+		assert(wide.at(0, 0).r == 0 && wide.at(1, 0).r == 50 && wide.at(2, 0).r == 150 && wide.at(3, 0).r == 200);
+
+		CImage copy(img), moved(std::move(copy));
+		assert(moved.at(1, 1) == blue && copy.is_empty());
+	}
+
+	//
+	// palette quantization
+	//
+	{
+		// four flat quadrants are reproduced exactly
+		const CColor255 quads[4] = { CColor255(255, 0, 0, 255), CColor255(0, 128, 0, 255), CColor255(20, 20, 200, 255), CColor255(250, 250, 250, 255) };
+		CImage img(64, 64);
+		for (uint32_t i = 0; i < 4; i++)
+			img.fill_rect((i & 1) * 32, (i >> 1) * 32, 32, 32, quads[i]);
+
+		for (auto method : { CPaletteQuantizer::k_median_cut, CPaletteQuantizer::k_kmeans })
+		{
+			CPaletteQuantizer q;
+			q.build(img, 16, method);
+			assert(q.size() == 4);
+
+			std::vector<uint8_t> indices(64 * 64);
+			q.map(img, indices.data());
+			for (uint32_t i = 0; i < 4; i++)
+				assert(q.palette()[indices[(i >> 1) * 32 * 64 + (i & 1) * 32]] == quads[i]);
+		}
+
+		// gradient to 16 colors, mapping stays close and does not depend on the
+		// thread count
+		CImage grad(512, 512);
+		for (uint32_t y = 0; y < 512; y++)
+		{
+			for (uint32_t x = 0; x < 512; x++)
+				grad.at(x, y) = CColor255(x / 2, y / 2, 128, 255);
+		}
+
+		CPaletteQuantizer q;
+		q.build(grad, 16);
+		assert(q.size() == 16);
+
+		std::vector<uint8_t> a(512 * 512), b(512 * 512), c(512 * 512);
+		q.map(grad, a.data());
+		detail::parallel_set_max_threads(1);
+		q.map(grad, b.data());
+		detail::parallel_set_max_threads(0);
+		assert(a == b);
+		assert(a[0] == q.nearest(grad.at(0, 0)) && a[511 * 512 + 300] == q.nearest(grad.at(300, 511)));
+
+		for (size_t i = 0; i < a.size(); i += 97)
+		{
+			const CColor255 p = grad.at(i % 512, i / 512), e = q.palette()[a[i]];
+			assert(abs(p.r - e.r) < 72 && abs(p.g - e.g) < 72 && abs(p.b - e.b) < 72);
+		}
+
+		// dither of zero is plain mapping, otherwise neighbours get mixed
+		q.map(grad, c.data(), 0.0f);
+		assert(a == c);
+		q.map(grad, c.data(), 32.0f);
+		assert(a != c);
+
+		std::vector<CColor255> expanded(4);
+		q.expand(a.data(), 4, expanded.data());
+		assert(expanded[0] == q.palette()[a[0]]);
+	}
+
+	//
+	// color ramps
+	//
+	{
+		const CColorRamp::stop_t stops[] =
+		{
+			{ 1.0f, CColor(1.0f, 1.0f, 1.0f, 1.0f) },
+			{ -1.0f, CColor(0.0f, 0.0f, 0.0f, 1.0f) },
+		};
+
+		CColorRamp ramp(stops, 2);
+		assert(ramp.size() == CColorRamp::k_default_size && ramp.stops().front().position == -1.0f);
+		assert(ramp.lookup_u32(-5.0f) == 0xff000000 && ramp.lookup_u32(5.0f) == 0xffffffff);
+		assert(ramp.lookup_u32(std::numeric_limits<float>::quiet_NaN()) == 0xff000000);
+
+		// without stops or build() every lookup is transparent black
+		const CColorRamp empty;
+		assert(empty.size() == CColorRamp::k_default_size && empty.lookup_u32(0.5f) == 0 && empty.lookup(2.0f) == CColor(0.0f, 0.0f, 0.0f, 0.0f));
+		assert(fabsf(ramp.lookup(0.0f).r - 0.5f) < 1e-5f && fabsf(ramp.sample(0.5f).g - 0.75f) < 1e-6f);
+
+		// mixing in linear light gives a brighter middle
+		const CColor mid = CColorRamp(stops, 2, CColorRamp::k_linear).lookup(0.0f);
+		assert(fabsf(mid.r - CColorSpace::linear_to_srgb(0.5f)) < 1e-3f && mid.r > 0.7f);
+
+		// batches match the single lookups
+		std::vector<float> values;
+		for (int i = 0; i < 1000; i++)
+			values.push_back(i / 400.0f - 1.2f);
+
+		std::vector<uint32_t> packed(values.size());
+		std::vector<CColor> colors(values.size());
+		ramp.map(values.data(), values.size(), packed.data());
+		ramp.map(values.data(), values.size(), colors.data());
+		for (size_t i = 0; i < values.size(); i++)
+		{
+			assert(packed[i] == ramp.lookup_u32(values[i]) && colors[i] == ramp.lookup(values[i]));
+			assert(fabsf(colors[i].r - ramp.sample(values[i]).r) < 1e-5f);
+		}
+
+		// stops at the same position make a hard edge
+		CColorRamp edge;
+		edge.add_stop(0.0f, CColor(1.0f, 0.0f, 0.0f, 1.0f));
+		edge.add_stop(0.5f, CColor(1.0f, 0.0f, 0.0f, 1.0f));
+		edge.add_stop(0.5f, CColor(0.0f, 0.0f, 1.0f, 1.0f));
+		edge.add_stop(1.0f, CColor(0.0f, 0.0f, 1.0f, 1.0f));
+		assert(edge.sample(0.49f).r == 1.0f && edge.sample(0.5f).b == 1.0f);
+	}
+
+	//
+	// pixel formats
+	//
+	{
+		const CColor255 c(255, 128, 0, 64);
+		using FromRGBA8 = CPixelConverter<CFormatRGBA8, CFormatRGBA8>;
+		using ToBGRA8 = CPixelConverter<CFormatRGBA8, CFormatBGRA8>;
+		using ToRGB565 = CPixelConverter<CFormatRGBA8, CFormatRGB565>;
+		using ToRGBA4444 = CPixelConverter<CFormatRGBA8, CFormatRGBA4444>;
+		using ToRGB10A2 = CPixelConverter<CFormatRGBA8, CFormatRGB10A2>;
+		using FromRGB565 = CPixelConverter<CFormatRGB565, CFormatRGBA8>;
+
+		static_assert(ToBGRA8::convert(0x400080ffu) == 0x40ff8000u);
+		assert(FromRGBA8::convert(c) == c.as_u32());
+		assert(ToRGB565::convert(c) == (31 << 11 | 32 << 5 | 0));
+		assert(ToRGBA4444::convert(c) == (15 << 12 | 8 << 8 | 0 << 4 | 4));
+		assert(ToRGB10A2::convert(c) == (1023u | 514u << 10 | 0u << 20 | 1u << 30));
+
+		// missing alpha reads back as opaque
+		assert(FromRGB565::convert(uint16_t(0xffff)) == 0xffffffffu);
+
+		// every 16-bit value survives the trip through a wider format
+		std::vector<uint16_t> all(65536), back(65536);
+		std::vector<uint32_t> wide(65536);
+		for (uint32_t i = 0; i < 65536; i++)
+			all[i] = static_cast<uint16_t>(i);
+
+		CPixelConverter<CFormatRGB565, CFormatRGB10A2>::convert(all.data(), wide.data(), all.size());
+		CPixelConverter<CFormatRGB10A2, CFormatRGB565>::convert(wide.data(), back.data(), all.size());
+		assert(all == back);
+
+		CPixelConverter<CFormatRGBA4444, CFormatBGRA8>::convert(all.data(), wide.data(), all.size());
+		CPixelConverter<CFormatBGRA8, CFormatRGBA4444>::convert(wide.data(), back.data(), all.size());
+		assert(all == back);
+
+		// color255 arrays on both ends
+		std::vector<CColor255> colors(256), unpacked(256);
+		std::vector<uint32_t> packed(256);
+		for (int i = 0; i < 256; i++)
+			colors[i] = CColor255((uint8_t)i, (uint8_t)(255 - i), (uint8_t)(i * 7), (uint8_t)(i * 3));
+
+		CPixelConverter<CFormatBGRA8, CFormatBGRA8>::convert(colors.data(), packed.data(), colors.size());
+		assert(packed[10] == 0x1e0af546u);
+		CPixelConverter<CFormatBGRA8, CFormatBGRA8>::convert(packed.data(), unpacked.data(), packed.size());
+		assert(colors == unpacked);
+	}
+
+	//
+	// morton codes and radix sort
+	//
+	{
+		static_assert(Morton::Interleave3(1u, 0u, 0u) == 1 && Morton::Interleave3(0u, 1u, 0u) == 2 && Morton::Interleave3(0u, 0u, 1u) == 4);
+		static_assert(Morton::Interleave2(0xffffu, 0u) == 0x55555555u && Morton::Interleave2(0u, 0xffffu) == 0xaaaaaaaau);
+		assert(Morton::Interleave3(1023u, 0u, 1023u) == 0x2db6db6du && Morton::Interleave3(uint64_t(0x1fffff), uint64_t(0), uint64_t(0)) == 0x1249249249249249ull);
+
+		uint64_t dx, dy, dz;
+		Morton::Deinterleave3(Morton::Interleave3(uint64_t(123456), uint64_t(2000000), uint64_t(77)), dx, dy, dz);
+		assert(dx == 123456 && dy == 2000000 && dz == 77);
+
+		uint32_t ux, uy;
+		Morton::Deinterleave2(Morton::Interleave2(65535u, 12345u), ux, uy);
+		assert(ux == 65535 && uy == 12345);
+
+		// corners of the box land on the first and last code, outside is clamped
+		const Vector corners[] = { Vector(-1.0f, -1.0f, -1.0f), Vector(1.0f, 1.0f, 1.0f), Vector(5.0f, -5.0f, 0.0f) };
+		uint32_t c32[3];
+		uint64_t c64[3];
+		Morton::Encode32(corners, 3, Vector(-1.0f, -1.0f, -1.0f), Vector(1.0f, 1.0f, 1.0f), c32);
+		Morton::Encode64(corners, 3, Vector(-1.0f, -1.0f, -1.0f), Vector(1.0f, 1.0f, 1.0f), c64);
+		assert(c32[0] == 0 && c32[1] == (1u << 30) - 1 && c64[0] == 0 && c64[1] == (1ull << 63) - 1);
+		uint32_t uz;
+		Morton::Deinterleave3(c32[2], ux, uy, uz);
+		assert(ux == 1023 && uy == 0 && uz == 512);
+
+		const Vector2D corners2d[] = { Vector2D(0.0f, 0.0f), Vector2D(1.0f, 1.0f) };
+		uint64_t c2d[2];
+		Morton::Encode64(corners2d, 2, Vector2D(0.0f, 0.0f), Vector2D(1.0f, 1.0f), c2d);
+		assert(c2d[0] == 0 && c2d[1] == ~0ull - 0xffff);
+
+		// radix sort is stable and matches std::stable_sort
+		std::vector<uint32_t> keys(200000), values(200000);
+		uint32_t seed = 7;
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			keys[i] = seed >> 12;
+			values[i] = static_cast<uint32_t>(i);
+		}
+
+		std::vector<std::pair<uint32_t, uint32_t>> reference;
+		for (size_t i = 0; i < keys.size(); i++)
+			reference.push_back({ keys[i], values[i] });
+		std::stable_sort(reference.begin(), reference.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+		detail::radix_sort(keys.data(), values.data(), keys.size(), 20);
+		for (size_t i = 0; i < keys.size(); i++)
+			assert(keys[i] == reference[i].first && values[i] == reference[i].second);
+
+		// sorting points keeps every point together with its payload
+		std::vector<Vector> cloud;
+		std::vector<CColor255> payload;
+		for (int i = 0; i < 4096; i++)
+		{
+			cloud.push_back(Vector((float)(i * 37 % 64), (float)(i * 11 % 64), (float)(i % 64)));
+			payload.push_back(CColor255((uint8_t)cloud.back().x, (uint8_t)cloud.back().y, (uint8_t)cloud.back().z, 255));
+		}
+
+		Morton::Sort(cloud.data(), cloud.size(), payload.data());
+
+		Vector mins, maxs;
+		Morton::Bounds(cloud.data(), cloud.size(), mins, maxs);
+		std::vector<uint32_t> sorted(cloud.size());
+		Morton::Encode32(cloud.data(), cloud.size(), mins, maxs, sorted.data());
+		for (size_t i = 0; i < cloud.size(); i++)
+		{
+			assert(payload[i] == CColor255((uint8_t)cloud[i].x, (uint8_t)cloud[i].y, (uint8_t)cloud[i].z, 255));
+			assert(i == 0 || sorted[i - 1] <= sorted[i]);
+		}
+	}
+
+	//
+	// spatial hash
+	//
+	{
+		SpatialHash grid(1.0f);
+
+		// random walk of objects, pairs have to match a brute force search
+		std::vector<Vector> pos;
+		std::vector<uint32_t> handles;
+		uint32_t seed = 11;
+		auto rnd = [&seed]() { seed = seed * 1664525u + 1013904223u; return (float)(seed >> 8) / 16777216.0f; };
+
+		for (int i = 0; i < 3000; i++)
+		{
+			pos.push_back(Vector(rnd() * 20.0f - 10.0f, rnd() * 20.0f - 10.0f, rnd() * 4.0f));
+			handles.push_back(grid.Insert(pos.back()));
+		}
+
+		auto brute_force = [&](float radius)
+		{
+			std::vector<std::pair<uint32_t, uint32_t>> out;
+			for (size_t i = 0; i < pos.size(); i++)
+			{
+				for (size_t j = i + 1; j < pos.size(); j++)
+				{
+					if (grid.IsValid(handles[i]) && grid.IsValid(handles[j]) && (pos[i] - pos[j]).LengthSqr() < radius * radius)
+						out.push_back({ std::min(handles[i], handles[j]), std::max(handles[i], handles[j]) });
+				}
+			}
+
+			std::sort(out.begin(), out.end());
+			return out;
+		};
+
+		auto query = [&](float radius)
+		{
+			std::vector<SpatialHash::pair_t> pairs;
+			grid.FindPairs(radius, pairs);
+
+			std::vector<std::pair<uint32_t, uint32_t>> out;
+			for (const auto& p : pairs)
+				out.push_back({ p.a, p.b });
+
+			std::sort(out.begin(), out.end());
+			return out;
+		};
+
+		assert(query(0.75f) == brute_force(0.75f) && !query(0.75f).empty());
+
+		for (size_t i = 0; i < pos.size(); i++)
+		{
+			pos[i] += Vector(rnd() - 0.5f, rnd() - 0.5f, rnd() - 0.5f) * 3.0f;
+			grid.Move(handles[i], pos[i]);
+		}
+
+		// remove every third object and put some back, reusing handles
+		for (size_t i = 0; i < pos.size(); i += 3)
+		{
+			grid.Remove(handles[i]);
+			handles[i] = SpatialHash::k_invalid;
+		}
+		for (size_t i = 0; i < pos.size(); i += 6)
+			handles[i] = grid.Insert(pos[i]);
+
+		assert(grid.Size() == 2500 && query(1.0f) == brute_force(1.0f));
+
+		std::vector<uint32_t> near;
+		grid.FindNear(pos[1], 2.5f, near);
+		for (uint32_t h : near)
+			assert((grid.GetPosition(h) - pos[1]).Length() < 2.5f);
+
+		size_t expected = 0;
+		for (size_t i = 0; i < pos.size(); i++)
+			expected += grid.IsValid(handles[i]) && (pos[i] - pos[1]).Length() < 2.5f;
+		assert(near.size() == expected);
+	}
+
+	//
+	// polygons
+	//
+	{
+		static_assert(Vector2D(1.0f, 0.0f).PerpDot(Vector2D(0.0f, 1.0f)) == 1.0f);
+		static_assert(Vector2D(0.0f, 1.0f).PerpDot(Vector2D(1.0f, 0.0f)) == -1.0f);
+
+		// square with points inside, on the edges and repeated corners
+		std::vector<Vector2D> points = { Vector2D(0.0f, 0.0f), Vector2D(2.0f, 0.0f), Vector2D(2.0f, 2.0f), Vector2D(0.0f, 2.0f),
+										 Vector2D(1.0f, 0.0f), Vector2D(2.0f, 1.0f), Vector2D(1.0f, 1.0f), Vector2D(0.0f, 0.0f) };
+		uint32_t seed = 13;
+		auto rnd = [&seed]() { seed = seed * 1664525u + 1013904223u; return (float)(seed >> 8) / 16777216.0f; };
+		for (int i = 0; i < 1000; i++)
+			points.push_back(Vector2D(rnd() * 1.8f + 0.1f, rnd() * 1.8f + 0.1f));
+
+		std::vector<Vector2D> hull, plain;
+		Polygon2D::ConvexHull(points.data(), points.size(), hull);
+		Polygon2D::ConvexHull(points.data(), points.size(), plain, false);
+		assert(hull.size() == 4 && hull == plain);
+		assert(hull[0] == Vector2D(0.0f, 0.0f) && hull[1] == Vector2D(2.0f, 0.0f) && hull[2] == Vector2D(2.0f, 2.0f));
+		assert(Polygon2D::SignedArea(hull.data(), hull.size()) == 4.0f);
+
+		// random cloud, every point is inside or on the hull and the hull is convex
+		std::vector<Vector2D> cloud;
+		for (int i = 0; i < 50000; i++)
+			cloud.push_back(Vector2D(rnd() - 0.5f, rnd() - 0.5f) * (rnd() * 100.0f));
+
+		Polygon2D::ConvexHull(cloud.data(), cloud.size(), hull);
+		Polygon2D::ConvexHull(cloud.data(), cloud.size(), plain, false);
+		assert(hull == plain && hull.size() > 8);
+
+		for (size_t e = 0; e < hull.size(); e++)
+		{
+			const Vector2D a = hull[e], b = hull[(e + 1) % hull.size()];
+			assert((b - a).PerpDot(hull[(e + 2) % hull.size()] - a) > 0.0f);
+			for (size_t i = 0; i < cloud.size(); i += 7)
+				assert((b - a).PerpDot(cloud[i] - a) >= -1e-3f);
+		}
+
+		// degenerate inputs
+		const Vector2D same[] = { Vector2D(1.0f, 1.0f), Vector2D(1.0f, 1.0f), Vector2D(1.0f, 1.0f) };
+		Polygon2D::ConvexHull(same, 3, hull);
+		assert(hull.size() == 1);
+		const Vector2D line[] = { Vector2D(0.0f, 0.0f), Vector2D(2.0f, 2.0f), Vector2D(1.0f, 1.0f) };
+		Polygon2D::ConvexHull(line, 3, hull);
+		assert(hull.size() == 2 && hull[1] == Vector2D(2.0f, 2.0f));
+
+		// concave polygon, single and batched point in polygon
+		const Vector2D arrow[] = { Vector2D(0.0f, 0.0f), Vector2D(4.0f, 0.0f), Vector2D(4.0f, 4.0f), Vector2D(2.0f, 1.0f), Vector2D(0.0f, 4.0f) };
+		assert(Polygon2D::Contains(arrow, 5, Vector2D(1.0f, 0.5f)) && !Polygon2D::Contains(arrow, 5, Vector2D(2.0f, 2.0f)));
+		assert(Polygon2D::Contains(arrow, 5, Vector2D(3.5f, 3.0f)) && !Polygon2D::Contains(arrow, 5, Vector2D(-1.0f, 0.5f)));
+
+		std::vector<Vector2D> queries;
+		for (int i = 0; i < 3000; i++)
+			queries.push_back(Vector2D(rnd() * 6.0f - 1.0f, rnd() * 6.0f - 1.0f));
+
+		std::vector<uint8_t> inside(queries.size());
+		Polygon2D::Contains(arrow, 5, queries.data(), queries.size(), inside.data());
+		for (size_t i = 0; i < queries.size(); i++)
+			assert(inside[i] == Polygon2D::Contains(arrow, 5, queries[i]));
+
+		// areas of packed polygons, clockwise ones are negative
+		const Vector2D packed[] = { Vector2D(0.0f, 0.0f), Vector2D(4.0f, 0.0f), Vector2D(4.0f, 4.0f), Vector2D(2.0f, 1.0f), Vector2D(0.0f, 4.0f),
+									Vector2D(0.0f, 0.0f), Vector2D(0.0f, 1.0f), Vector2D(1.0f, 0.0f) };
+		const uint32_t offsets[] = { 0, 5, 8 };
+		float areas[2];
+		Polygon2D::SignedAreas(packed, offsets, 2, areas);
+		assert(areas[0] == 10.0f && areas[1] == -0.5f);
+	}
+
+	//
+	// mesh normals
+	//
+	{
+		// octahedron, vertex normals point away from the center
+		const Vector corners[] = { Vector(1.0f, 0.0f, 0.0f), Vector(-1.0f, 0.0f, 0.0f), Vector(0.0f, 1.0f, 0.0f),
+								   Vector(0.0f, -1.0f, 0.0f), Vector(0.0f, 0.0f, 1.0f), Vector(0.0f, 0.0f, -1.0f), Vector(5.0f, 5.0f, 5.0f) };
+		const uint32_t faces[] = { 0, 2, 4, 2, 1, 4, 1, 3, 4, 3, 0, 4, 2, 0, 5, 1, 2, 5, 3, 1, 5, 0, 3, 5 };
+
+		MeshNormals mesh(faces, 8, 7);
+		Vector normals[7];
+		mesh.Compute(corners, normals);
+
+		for (int i = 0; i < 6; i++)
+			assert(normals[i].Distance(corners[i]) < 1e-6f);
+		assert(normals[6].IsZero() && mesh.GetFaceNormal(0) == Vector(1.0f, 1.0f, 1.0f));
+
+		// wavy grid against a serial scatter with CrossProduct
+		const uint32_t n = 200;
+		std::vector<Vector> grid;
+		std::vector<uint32_t> indices;
+		for (uint32_t y = 0; y < n; y++)
+		{
+			for (uint32_t x = 0; x < n; x++)
+				grid.push_back(Vector((float)x, (float)y, std::sin(x * 0.1f) * std::cos(y * 0.2f) * 3.0f));
+		}
+
+		for (uint32_t y = 0; y + 1 < n; y++)
+		{
+			for (uint32_t x = 0; x + 1 < n; x++)
+			{
+				const uint32_t i = y * n + x;
+				indices.insert(indices.end(), { i, i + 1, i + n, i + 1, i + n + 1, i + n });
+			}
+		}
+
+		std::vector<Vector> reference(grid.size()), computed(grid.size());
+		for (size_t f = 0; f < indices.size(); f += 3)
+		{
+			Vector c;
+			c.CrossProduct(grid[indices[f + 1]] - grid[indices[f]], grid[indices[f + 2]] - grid[indices[f]]);
+			for (int k = 0; k < 3; k++)
+				reference[indices[f + k]] += c;
+		}
+
+		mesh.SetTopology(indices.data(), indices.size() / 3, grid.size());
+		mesh.Compute(grid.data(), computed.data());
+		for (size_t i = 0; i < grid.size(); i++)
+			assert(computed[i].Distance(reference[i].Normalize()) < 1e-5f && computed[i].z > 0.0f);
+	}
+
+	//
+	// vector codec
+	//
+	{
+		// smooth trajectory, compresses well with the linear predictor
+		std::vector<Vector> path;
+		for (int i = 0; i < 10000; i++)
+			path.push_back(Vector(std::sin(i * 0.01f) * 100.0f, std::cos(i * 0.013f) * 50.0f, i * 0.05f - 200.0f));
+
+		for (auto predictor : { VectorCodec::k_linear, VectorCodec::k_previous })
+		{
+			VectorCodec codec(0.001f, predictor, 1000);
+			assert(codec.ErrorBound() == 0.0005f);
+
+			std::vector<uint8_t> bytes;
+			const float error = codec.Encode(path.data(), path.size(), bytes);
+			assert(error <= codec.ErrorBound() + 2e-5f);
+			assert(bytes.size() < path.size() * sizeof(Vector) / 2);
+
+			std::vector<Vector> decoded;
+			assert(VectorCodec::Decode(bytes.data(), bytes.size(), decoded) && decoded.size() == path.size());
+			for (size_t i = 0; i < path.size(); i++)
+			{
+				for (int k = 0; k < 3; k++)
+					assert(std::abs(decoded[i][k] - path[i][k]) <= error);
+			}
+
+			// the same stream in chunks, one at a time
+			std::vector<uint8_t> streamed;
+			for (size_t lo = 0; lo < path.size(); lo += 333)
+				codec.EncodeChunk(path.data() + lo, std::min<size_t>(333, path.size() - lo), streamed);
+
+			std::vector<Vector> chunk;
+			size_t offset = 0, total = 0, count, size, consumed;
+			while (VectorCodec::PeekChunk(streamed.data() + offset, streamed.size() - offset, count, size))
+			{
+				chunk.resize(count);
+				assert(VectorCodec::DecodeChunk(streamed.data() + offset, streamed.size() - offset, chunk.data(), consumed) == count);
+				assert(consumed == size);
+				for (size_t i = 0; i < count; i++)
+					assert(chunk[i] == decoded[total + i]);
+
+				offset += consumed;
+				total += count;
+			}
+			assert(offset == streamed.size() && total == path.size());
+		}
+
+		// empty and single vector chunks, out of range values are clamped, NaN
+		// becomes zero and halves round away from zero
+		VectorCodec codec(1.0f);
+		std::vector<uint8_t> bytes;
+		const Vector huge[] = { Vector(1e12f, -2.5f, std::numeric_limits<float>::quiet_NaN()) };
+		codec.EncodeChunk(huge, 0, bytes);
+		assert(codec.EncodeChunk(huge, 1, bytes) > 1.0f);
+
+		std::vector<Vector> decoded;
+		assert(VectorCodec::Decode(bytes.data(), bytes.size(), decoded) && decoded.size() == 1);
+		assert(decoded[0] == Vector(2147483520.0f, -3.0f, 0.0f));
+
+		// truncated data keeps only the complete chunks
+		codec.Encode(path.data(), 5000, bytes);
+		decoded.clear();
+		assert(!VectorCodec::Decode(bytes.data(), bytes.size() - 1, decoded) && decoded.size() == 1 + VectorCodec::k_default_chunk);
+
+		// a constant tail ends the data with a block of width 0, which has no
+		// bits to read. the buffer is sized exactly, so reading past it shows
+		// up under a sanitizer.
+		std::vector<Vector> still(300, Vector(1.0f, 2.0f, 3.0f));
+		still[0] = Vector(0.0f, 0.0f, 0.0f);
+		bytes.clear();
+		codec.EncodeChunk(still.data(), still.size(), bytes);
+		assert(bytes.back() == 0);
+
+		const std::unique_ptr<uint8_t[]> exact(new uint8_t[bytes.size()]);
+		std::memcpy(exact.get(), bytes.data(), bytes.size());
+		decoded.clear();
+		assert(VectorCodec::Decode(exact.get(), bytes.size(), decoded) && decoded == still);
+
+		// a count the payload cannot hold is rejected before allocating
+		const uint32_t bogus = 4000000000u;
+		std::memcpy(exact.get(), &bogus, sizeof(bogus));
+		decoded.clear();
+		assert(!VectorCodec::Decode(exact.get(), bytes.size(), decoded) && decoded.empty());
+	}
+
+	//
+	// point cloud files
+	//
+	{
+		const char* path = "point_cloud_test.bin";
+
+		std::vector<Vector> positions;
+		std::vector<CColor255> colors;
+		for (int i = 0; i < 1000; i++)
+		{
+			positions.push_back(Vector(i * 0.5f, -i * 0.25f, (float)(i % 7)));
+			colors.push_back(CColor255(i & 255, (i >> 8) & 255, 7, 255));
+		}
+
+		for (auto layout : { detail::point_cloud::k_aos, detail::point_cloud::k_soa })
+		{
+			// 100 points per chunk become 112
+			PointCloudWriter writer;
+			assert(writer.Open(path, layout, 100));
+			assert(writer.Write(positions[0], colors[0]));
+			assert(writer.Write(positions.data() + 1, colors.data() + 1, positions.size() - 1));
+			assert(writer.Close() && !writer.IsOpen());
+
+			PointCloudReader reader;
+			assert(reader.Open(path) && reader.Layout() == layout);
+			assert(reader.Size() == 1000 && reader.ChunkPoints() == 112 && reader.ChunkCount() == 9 && reader.ChunkSize(8) == 104);
+			assert(reader.GetMins() == Vector(0.0f, -249.75f, 0.0f) && reader.GetMaxs() == Vector(499.5f, 0.0f, 6.0f));
+			assert(reader.GetChunkMins(1) == Vector(56.0f, -55.75f, 0.0f) && reader.GetChunkMaxs(1) == Vector(111.5f, -28.0f, 6.0f));
+
+			size_t at = 0;
+			for (size_t c = 0; c < reader.ChunkCount(); c++)
+			{
+				if (layout == detail::point_cloud::k_aos)
+				{
+					assert(reader.Positions(c).empty() && reader.Colors(c).empty());
+					for (const auto& p : reader.Points(c))
+					{
+						assert(p.position == positions[at] && p.color == colors[at]);
+						at++;
+					}
+				}
+				else
+				{
+					const auto pos = reader.Positions(c);
+					const auto col = reader.Colors(c);
+					assert(reader.Points().empty() && pos.size() == col.size());
+					assert(reinterpret_cast<uintptr_t>(pos.data()) % 64 == 0);
+					for (size_t i = 0; i < pos.size(); i++, at++)
+						assert(pos[i] == positions[at] && col[i] == colors[at]);
+				}
+			}
+			assert(at == positions.size());
+		}
+
+		// empty clouds are valid, truncated files are not
+		{
+			PointCloudWriter writer;
+			assert(writer.Open(path) && writer.Close());
+
+			PointCloudReader reader;
+			assert(reader.Open(path) && reader.Size() == 0 && reader.ChunkCount() == 0);
+		}
+
+		{
+			PointCloudWriter writer;
+			assert(writer.Open(path, detail::point_cloud::k_aos, 16));
+			writer.Write(positions.data(), colors.data(), 100);
+			assert(writer.Close());
+
+			std::FILE* f = std::fopen(path, "r+b");
+			std::vector<uint8_t> bytes(64 + 100 * 16 + 7 * 24);
+			assert(f && std::fread(bytes.data(), 1, bytes.size(), f) == bytes.size() && std::fgetc(f) == EOF);
+			std::fclose(f);
+
+			f = std::fopen(path, "wb");
+			std::fwrite(bytes.data(), 1, bytes.size() - 1, f);
+			std::fclose(f);
+
+			PointCloudReader reader;
+			assert(!reader.Open(path) && !reader.IsOpen());
+			assert(!reader.Open("no_such_point_cloud.bin"));
+		}
+
+		// a count that wraps the chunk arithmetic around is rejected
+		{
+			PointCloudWriter writer;
+			assert(writer.Open(path, detail::point_cloud::k_aos, 16) && writer.Close());
+
+			detail::point_cloud::header_t header;
+			std::FILE* f = std::fopen(path, "rb");
+			assert(f && std::fread(&header, 1, sizeof(header), f) == sizeof(header));
+			std::fclose(f);
+
+			header.point_count = UINT64_MAX;
+			assert(header.chunk_points == 16 && header.directory_offset == 64);
+
+			f = std::fopen(path, "wb");
+			std::fwrite(&header, 1, sizeof(header), f);
+			std::fclose(f);
+
+			PointCloudReader reader;
+			assert(!reader.Open(path) && !reader.IsOpen());
+		}
+
+		std::remove(path);
+	}
+
+	//
+	// text formatting and parsing
+	//
+	{
+		char buffer[256];
+
+		// shortest round trip form
+		const Vector v(0.1f, -2.0f, 1e-30f);
+		char* end = TextFormat::Format(buffer, buffer + sizeof(buffer), v);
+		assert(std::string_view(buffer, end - buffer) == "0.1 -2 1e-30\n");
+
+		end = TextFormat::Format(buffer, buffer + sizeof(buffer), CColor255(255, 0, 12, 128), ',');
+		assert(std::string_view(buffer, end - buffer) == "255,0,12,128\n");
+
+		end = TextFormat::Format(buffer, buffer + sizeof(buffer), Vector2D(1.5f, 3.0f), ' ', ';');
+		assert(std::string_view(buffer, end - buffer) == "1.5 3;");
+
+		// too small buffers write nothing usable, batches write whole values only
+		assert(!TextFormat::Format(buffer, buffer + 12, v) && TextFormat::Format(buffer, buffer + 13, v));
+
+		const Vector batch[] = { Vector(1.0f, 2.0f, 3.0f), Vector(4.0f, 5.0f, 6.0f), Vector(7.0f, 8.0f, 9.0f) };
+		size_t written;
+		end = TextFormat::Format(buffer, buffer + 15, batch, 3, written);
+		assert(written == 2 && std::string_view(buffer, end - buffer) == "1 2 3\n4 5 6\n");
+
+		// mixed separators, CRLF and stray commas
+		const char text[] = " 1.5, -2e3 ,0.25\r\n4;5\t6\n\n7 8 x\n";
+		Vector parsed[4];
+		size_t count;
+		const char* stop = TextFormat::Parse(text, text + sizeof(text) - 1, parsed, 4, count);
+		assert(count == 2 && parsed[0] == Vector(1.5f, -2000.0f, 0.25f) && parsed[1] == Vector(4.0f, 5.0f, 6.0f));
+		assert(*stop == '7');
+
+		CColor255 c;
+		assert(!TextFormat::Parse("1 2 300 4", "1 2 300 4" + 9, c));
+		assert(TextFormat::Parse("1 2 3 4", "1 2 3 4" + 7, c) && c == CColor255(1, 2, 3, 4));
+
+		// random values survive a round trip bit for bit
+		std::vector<Vector> values;
+		std::vector<CColorT<double>> colors;
+		uint32_t seed = 12345;
+		auto next = [&seed] { seed = seed * 1664525u + 1013904223u; return seed; };
+		for (int i = 0; i < 1000; i++)
+		{
+			values.push_back(Vector(std::bit_cast<float>(next() & 0xbf7fffffu), (float)next() / 7.0f, -1.0f / (float)(next() | 1)));
+			colors.push_back(CColorT<double>(next() / 3.0, next() * 1e-300, 1.0 / 3.0, -0.0));
+		}
+
+		std::vector<char> storage(values.size() * TextFormat::MaxChars<Vector>());
+		end = TextFormat::Format(storage.data(), storage.data() + storage.size(), values.data(), values.size(), written);
+		assert(written == values.size());
+
+		std::vector<Vector> back(values.size());
+		stop = TextFormat::Parse(storage.data(), end, back.data(), back.size(), count);
+		assert(stop == end && count == values.size());
+		for (size_t i = 0; i < values.size(); i++)
+			assert(std::memcmp(&back[i], &values[i], sizeof(Vector)) == 0);
+
+		storage.resize(colors.size() * TextFormat::MaxChars<CColorT<double>>());
+		end = TextFormat::Format(storage.data(), storage.data() + storage.size(), colors.data(), colors.size(), written, ',');
+		std::vector<CColorT<double>> colors_back(colors.size());
+		TextFormat::Parse(storage.data(), end, colors_back.data(), colors_back.size(), count);
+		assert(count == colors.size());
+		for (size_t i = 0; i < colors.size(); i++)
+			assert(std::memcmp(&colors_back[i], &colors[i], sizeof(colors[i])) == 0);
+	}
+
+	//
+	// coroutine pipelines
+	//
+	{
+		std::vector<Vector> points;
+		for (int i = 0; i < 10000; i++)
+			points.push_back(Vector((float)i, (float)(i % 10), 1.0f));
+
+		auto scale = [](VectorStream::chunk_t chunk)
+		{
+			for (auto& v : chunk)
+				v *= 2.0f;
+		};
+
+		// nothing runs before the stream is consumed
+		size_t transformed = 0;
+		auto stream = VectorStream::FromArray(points.data(), points.size(), 512)
+			.Transform([&](VectorStream::chunk_t chunk) { transformed += chunk.size(); scale(chunk); })
+			.Filter([](const Vector& v) { return v.y == 0.0f; });
+		assert(transformed == 0);
+
+		const std::vector<Vector> kept = std::move(stream).Collect();
+		assert(transformed == points.size() && kept.size() == 1000);
+		for (size_t i = 0; i < kept.size(); i++)
+			assert(kept[i] == Vector(i * 20.0f, 0.0f, 2.0f));
+
+		// chunks never exceed the requested size, the input is not modified
+		size_t chunks = 0, total = 0;
+		VectorStream::FromArray(points.data(), points.size(), 512).Transform(scale).ForEach([&](VectorStream::chunk_t chunk)
+		{
+			assert(chunk.size() <= 512 && chunk[0] == points[total] * 2.0f);
+			chunks++;
+			total += chunk.size();
+		});
+		assert(chunks == 20 && total == points.size() && points[1] == Vector(1.0f, 1.0f, 1.0f));
+
+		// the parallel stage keeps the order, with any amount of workers
+		for (unsigned threads : { 1u, 3u })
+		{
+			detail::parallel_set_max_threads(threads);
+			const auto parallel = VectorStream::FromArray(points.data(), points.size(), 100).TransformParallel(scale).Collect();
+			assert(parallel.size() == points.size());
+			for (size_t i = 0; i < points.size(); i++)
+				assert(parallel[i] == points[i] * 2.0f);
+		}
+		detail::parallel_set_max_threads(0);
+
+		// generated input, exceptions of a stage reach the consumer
+		int produced = 0;
+		auto counter = [&](VectorStream::chunk_t buffer)
+		{
+			size_t n = 0;
+			for (; n < buffer.size() && produced < 1000; n++)
+				buffer[n] = Vector((float)produced++, 0.0f, 0.0f);
+			return n;
+		};
+		assert(VectorStream::FromFunction(counter, 64).Collect().size() == 1000);
+
+		bool thrown = false;
+		try
+		{
+			VectorStream::FromArray(points.data(), points.size()).Transform([](VectorStream::chunk_t) { throw 1; }).Collect();
+		}
+		catch (int)
+		{
+			thrown = true;
+		}
+		assert(thrown);
+	}
+
+	//
+	// bounding spheres
+	//
+	{
+		auto contains = [](const BoundingSphere::sphere_t& s, const std::vector<Vector>& points)
+		{
+			for (const auto& p : points)
+			{
+				if ((p - s.center).LengthSqr() > s.radius * s.radius * 1.00001f)
+					return false;
+			}
+			return true;
+		};
+
+		// cube corners and its center, the corners are on the minimal sphere
+		std::vector<Vector> cube;
+		for (int i = 0; i < 8; i++)
+			cube.push_back(Vector(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f));
+		cube.push_back(Vector());
+
+		auto exact = BoundingSphere::Welzl(cube.data(), cube.size());
+		assert(exact.center.Length() < 1e-5f && std::abs(exact.radius - std::sqrt(3.0f)) < 1e-5f && contains(exact, cube));
+
+		// square in a plane and points on a line, degenerate support sets
+		const std::vector<Vector> square = { Vector(0.0f, 0.0f, 5.0f), Vector(2.0f, 0.0f, 5.0f), Vector(2.0f, 2.0f, 5.0f), Vector(0.0f, 2.0f, 5.0f) };
+		exact = BoundingSphere::Welzl(square.data(), square.size());
+		assert(exact.center.Distance(Vector(1.0f, 1.0f, 5.0f)) < 1e-5f && std::abs(exact.radius - std::sqrt(2.0f)) < 1e-5f);
+
+		const std::vector<Vector> line = { Vector(1.0f, 1.0f, 1.0f), Vector(3.0f, 3.0f, 3.0f), Vector(2.0f, 2.0f, 2.0f), Vector(-1.0f, -1.0f, -1.0f) };
+		exact = BoundingSphere::Welzl(line.data(), line.size());
+		assert(exact.center.Distance(Vector(1.0f, 1.0f, 1.0f)) < 1e-5f && std::abs(exact.radius - std::sqrt(12.0f)) < 1e-5f);
+
+		const auto single = BoundingSphere::Ritter(line.data(), 1);
+		assert(single.center == line[0] && single.radius == 0.0f && BoundingSphere::Welzl(line.data(), 0).radius == 0.0f);
+
+		// random clusters, Ritter is never smaller than the exact sphere and
+		// both contain every point
+		std::vector<Vector> points;
+		std::vector<uint32_t> offsets = { 0 };
+		uint32_t seed = 7;
+		auto next = [&seed] { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / 16777216.0f; };
+		for (int c = 0; c < 500; c++)
+		{
+			const Vector center(next() * 100.0f, next() * 100.0f, next() * 100.0f);
+			const int n = 1 + c % 40;
+			for (int i = 0; i < n; i++)
+				points.push_back(center + Vector(next() - 0.5f, (next() - 0.5f) * 3.0f, next() * 0.25f));
+			offsets.push_back((uint32_t)points.size());
+		}
+
+		SphereBatch approx, minimal;
+		BoundingSphere::Ritter(points.data(), offsets.data(), offsets.size() - 1, approx);
+		BoundingSphere::Welzl(points.data(), offsets.data(), offsets.size() - 1, minimal);
+		assert(approx.Size() == 500 && minimal.Size() == 500);
+
+		for (size_t c = 0; c + 1 < offsets.size(); c++)
+		{
+			const std::vector<Vector> cluster(points.begin() + offsets[c], points.begin() + offsets[c + 1]);
+			const auto r = BoundingSphere::Ritter(cluster.data(), cluster.size());
+			const auto w = BoundingSphere::Welzl(cluster.data(), cluster.size());
+
+			assert(contains(r, cluster) && contains(w, cluster) && r.radius >= w.radius * 0.9999f);
+			assert(approx.GetCenter(c) == r.center && approx.GetRadius(c) == r.radius);
+			assert(minimal.GetCenter(c) == w.center && minimal.GetRadius(c) == w.radius);
+
+			// no point can be left out of the exact sphere by shrinking it
+			float farthest = 0.0f;
+			for (const auto& p : cluster)
+				farthest = std::max(farthest, p.Distance(w.center));
+			assert(farthest >= w.radius * 0.9999f);
+		}
+	}
+
+	//
+	// euler angles
+	//
+	{
+		auto near = [](const Vector& a, const Vector& b, float eps) { return (a - b).Length() < eps; };
+
+		// engine conventions: x forward, y left, z up, positive pitch looks down
+		Vector forward, right, up;
+		EulerAngles::AngleVectors(Vector(), &forward, &right, &up);
+		assert(near(forward, Vector(1.0f, 0.0f, 0.0f), 1e-6f) && near(right, Vector(0.0f, -1.0f, 0.0f), 1e-6f) && near(up, Vector(0.0f, 0.0f, 1.0f), 1e-6f));
+
+		EulerAngles::AngleVectors(Vector(0.0f, 90.0f, 0.0f), &forward);
+		assert(near(forward, Vector(0.0f, 1.0f, 0.0f), 1e-6f));
+		EulerAngles::AngleVectors(Vector(90.0f, 0.0f, 0.0f), &forward);
+		assert(near(forward, Vector(0.0f, 0.0f, -1.0f), 1e-6f));
+
+		// quadrant boundaries are exact
+		assert(EulerAngles::SinCos(90.0f).sin == 1.0f && EulerAngles::SinCos(-180.0f).cos == -1.0f && EulerAngles::SinCos(720.0f).sin == 0.0f);
+
+		// against the library functions, within the documented bounds
+		for (int i = -20000; i <= 20000; i++)
+		{
+			const double deg = i * 0.0913, rad = deg * 3.14159265358979323846 / 180.0;
+			const double rad_f = (float)deg * 3.14159265358979323846 / 180.0;
+			const auto f = EulerAngles::SinCos((float)deg);
+			const auto d = EulerAnglesT<double>::SinCos(deg);
+			assert(std::abs(f.sin - std::sin(rad_f)) < 0x1p-22 && std::abs(f.cos - std::cos(rad_f)) < 0x1p-22);
+			// the reference converts to radians with a rounding of its own
+			assert(std::abs(d.sin - std::sin(rad)) < 0x1p-46 && std::abs(d.cos - std::cos(rad)) < 0x1p-46);
+
+			const double y = std::sin(i * 0.0173) * 3.0, x = std::cos(i * 0.0041) * 2.0;
+			const double ref = std::atan2(y, x) * 180.0 / 3.14159265358979323846;
+			assert(std::abs(EulerAngles::Atan2((float)y, (float)x) - ref) < 0x1p-15);
+			assert(std::abs(EulerAnglesT<double>::Atan2(y, x) - ref) < 0x1p-43);
+		}
+		assert(EulerAngles::Atan2(0.0f, 0.0f) == 0.0f && EulerAngles::Atan2(1.0f, 0.0f) == 90.0f && EulerAngles::Atan2(0.0f, -1.0f) == 180.0f);
+
+		// straight up and down, and back from the vectors of pitch and yaw
+		assert(near(EulerAngles::VectorAngles(Vector(0.0f, 0.0f, 2.0f)), Vector(270.0f, 0.0f, 0.0f), 1e-6f));
+		assert(near(EulerAngles::VectorAngles(Vector(0.0f, 0.0f, -2.0f)), Vector(90.0f, 0.0f, 0.0f), 1e-6f));
+
+		std::vector<Vector> angles;
+		for (int i = 0; i < 1000; i++)
+			angles.push_back(Vector((i * 37 % 170) - 85.0f, (float)(i * 53 % 360), (float)(i * 11 % 360) - 180.0f));
+
+		std::vector<Vector> f(angles.size()), r(angles.size()), u(angles.size()), back(angles.size());
+		EulerAngles::AngleVectors(angles.data(), angles.size(), f.data(), r.data(), u.data());
+		EulerAngles::VectorAngles(f.data(), f.size(), back.data());
+
+		for (size_t i = 0; i < angles.size(); i++)
+		{
+			// orthonormal and right handed
+			assert(std::abs(f[i].Length() - 1.0f) < 1e-5f && std::abs(r[i].Length() - 1.0f) < 1e-5f && std::abs(f[i].Dot(u[i])) < 1e-5f);
+			Vector cross;
+			cross.CrossProduct(f[i], r[i]);
+			assert(near(cross, -u[i], 1e-5f));
+
+			Vector single;
+			EulerAngles::AngleVectors(angles[i], nullptr, nullptr, &single);
+			assert(single == u[i]);
+
+			const float pitch = angles[i].x < 0.0f ? angles[i].x + 360.0f : angles[i].x;
+			assert(std::abs(back[i].x - pitch) < 1e-3f && back[i].z == 0.0f);
+			assert(std::abs(back[i].y - angles[i].y) < 1e-3f || std::abs(std::abs(back[i].y - angles[i].y) - 360.0f) < 1e-3f);
+		}
+
+		// forward only, and back in place
+		std::vector<Vector> f2(angles.size());
+		EulerAngles::AngleVectors(angles.data(), angles.size(), f2.data());
+		assert(f2 == f);
+		EulerAngles::VectorAngles(f2.data(), f2.size(), f2.data());
+		assert(f2 == back);
+
+		// the horizontal length squared is subnormal here
+		assert(std::abs(EulerAngles::VectorAngles(Vector(3e-20f, 0.0f, -3e-20f)).x - 45.0f) < 1e-3f);
+	}
+
+	//
+	// random vectors
+	//
+	{
+		const size_t count = 100'000;
+		VectorRandom rng(1234);
+
+		// on the sphere, centered, with every axis getting a third of the length
+		std::vector<Vector> dirs(count);
+		rng.OnSphere(dirs.data(), count);
+
+		Vector mean;
+		double z_sqr = 0.0;
+		for (const auto& d : dirs)
+		{
+			assert(std::abs(d.Length() - 1.0f) < 1e-5f);
+			mean += d;
+			z_sqr += d.z * d.z;
+		}
+		assert((mean / (float)count).Length() < 0.02f && std::abs(z_sqr / count - 1.0 / 3.0) < 0.01);
+
+		// mirrored into the hemisphere, the mean cosine is one half
+		const Vector normal = Vector(1.0f, 1.0f, 0.0f) / std::sqrt(2.0f);
+		rng.OnHemisphere(dirs.data(), count, normal);
+
+		double cosine = 0.0;
+		for (const auto& d : dirs)
+		{
+			assert(d.Dot(normal) >= -1e-6f && std::abs(d.Length() - 1.0f) < 1e-5f);
+			cosine += d.Dot(normal);
+		}
+		assert(std::abs(cosine / count - 0.5) < 0.01);
+
+		// a quarter of the disk is within half of its radius
+		std::vector<Vector2D> disk(count);
+		rng.InDisk(disk.data(), count, 2.0f);
+
+		size_t inner = 0;
+		for (const auto& p : disk)
+		{
+			assert(p.Length() <= 2.0f);
+			inner += p.Length() < 1.0f;
+		}
+		assert(std::abs((double)inner / count - 0.25) < 0.01);
+
+		std::vector<Vector> box(count);
+		rng.InBox(box.data(), count, Vector(-1.0f, 2.0f, 3.0f), Vector(1.0f, 4.0f, 7.0f));
+
+		mean = Vector();
+		for (const auto& p : box)
+		{
+			assert(p.x >= -1.0f && p.x <= 1.0f && p.y >= 2.0f && p.y <= 4.0f && p.z >= 3.0f && p.z <= 7.0f);
+			mean += p;
+		}
+		assert((mean / (float)count).Distance(Vector(0.0f, 3.0f, 5.0f)) < 0.02f);
+
+		std::vector<double> unit(1000);
+		VectorRandomT<double>(5).Uniform(unit.data(), unit.size());
+		assert(std::all_of(unit.begin(), unit.end(), [](double u) { return u >= 0.0 && u < 1.0; }));
+
+		// the same seed and stream repeat, other streams do not
+		std::vector<Vector> a(1000), b(1000), c(1000);
+		VectorRandom(7, 3).OnSphere(a.data(), a.size());
+		VectorRandom(7, 3).OnSphere(b.data(), b.size());
+		VectorRandom(7, 4).OnSphere(c.data(), c.size());
+		assert(a == b && a != c);
+
+		// parallel results do not depend on the number of threads
+		auto sphere = [](auto& rng, Vector* out, size_t n) { rng.OnSphere(out, n); };
+		std::vector<Vector> serial(count), parallel(count);
+
+		detail::parallel_set_max_threads(1);
+		VectorRandom::Parallel(99, serial.data(), count, sphere);
+		detail::parallel_set_max_threads(4);
+		VectorRandom::Parallel(99, parallel.data(), count, sphere);
+		detail::parallel_set_max_threads(0);
+
+		// the first block comes from stream 0
+		std::vector<Vector> first(VectorRandom::k_block);
+		VectorRandom(99, 0).OnSphere(first.data(), first.size());
+		assert(serial == parallel && std::equal(first.begin(), first.end(), serial.begin()));
+	}
+
+	//
+	// gradient noise
+	//
+	{
+		const GradientNoise noise(42);
+
+		// perlin noise vanishes on the lattice
+		assert(noise.Perlin(Vector(3.0f, -7.0f, 12.0f)) == 0.0f && noise.Perlin(Vector()) == 0.0f);
+
+		const size_t count = 10'000;
+		std::vector<Vector> points(count);
+		std::vector<float> x(count), y(count), z(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			points[i] = Vector(std::sin(i * 0.37f) * 40.0f, std::cos(i * 0.11f) * 25.0f - 3.0f, (float)i * 0.013f - 60.0f);
+			x[i] = points[i].x;
+			y[i] = points[i].y;
+			z[i] = points[i].z;
+		}
+
+		// bounded, not flat, and continuous
+		double perlin_abs = 0.0, simplex_abs = 0.0;
+		for (const auto& p : points)
+		{
+			const float a = noise.Perlin(p), b = noise.Simplex(p);
+			assert(std::abs(a) <= 1.0f && std::abs(b) <= 1.0f);
+			perlin_abs += std::abs(a);
+			simplex_abs += std::abs(b);
+
+			const Vector q = p + Vector(1e-3f, -1e-3f, 1e-3f);
+			assert(std::abs(noise.Perlin(q) - a) < 0.01f && std::abs(noise.Simplex(q) - b) < 0.02f);
+		}
+		assert(perlin_abs / count > 0.1 && simplex_abs / count > 0.1);
+
+		// the batches give the scalar results bit for bit
+		auto same = [](const std::vector<float>& a, const std::vector<float>& b)
+		{
+			return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+		};
+
+		std::vector<float> scalar(count), batch(count), aos(count);
+		for (size_t i = 0; i < count; i++)
+			scalar[i] = noise.Perlin(points[i]);
+		noise.Perlin(x.data(), y.data(), z.data(), count, batch.data());
+		noise.Perlin(points.data(), count, aos.data());
+		assert(same(scalar, batch) && same(scalar, aos));
+
+		for (size_t i = 0; i < count; i++)
+			scalar[i] = noise.Simplex(points[i]);
+		noise.Simplex(x.data(), y.data(), z.data(), count, batch.data());
+		noise.Simplex(points.data(), count, aos.data());
+		assert(same(scalar, batch) && same(scalar, aos));
+
+		for (const auto kind : { GradientNoise::k_perlin, GradientNoise::k_simplex })
+		{
+			GradientNoise::fbm_t fbm;
+			fbm.kind = kind;
+			fbm.octaves = 4;
+
+			for (size_t i = 0; i < count; i++)
+				scalar[i] = noise.Fbm(fbm, points[i]);
+			noise.Fbm(fbm, x.data(), y.data(), z.data(), count, batch.data());
+			noise.Fbm(fbm, points.data(), count, aos.data());
+			assert(same(scalar, batch) && same(scalar, aos));
+
+			// grids, with any number of threads
+			const size_t nx = 37, ny = 5, nz = 4;
+			const Vector origin(-2.5f, 1.25f, 7.0f);
+			const float step = 0.3f;
+
+			std::vector<float> grid(nx * ny * nz), threaded(nx * ny * nz);
+			detail::parallel_set_max_threads(1);
+			noise.FbmGrid(fbm, origin, step, nx, ny, nz, grid.data());
+			detail::parallel_set_max_threads(3);
+			noise.FbmGrid(fbm, origin, step, nx, ny, nz, threaded.data());
+			detail::parallel_set_max_threads(0);
+			assert(same(grid, threaded));
+
+			for (size_t k = 0, idx = 0; k < nz; k++)
+			{
+				for (size_t j = 0; j < ny; j++)
+				{
+					for (size_t i = 0; i < nx; i++, idx++)
+					{
+						const Vector p(origin.x + i * step, origin.y + j * step, origin.z + k * step);
+						assert(std::bit_cast<uint32_t>(grid[idx]) == std::bit_cast<uint32_t>(noise.Fbm(fbm, p)));
+					}
+				}
+			}
+		}
+
+		// other seeds give other fields
+		const GradientNoise other(43);
+		assert(other.Perlin(points[1]) != noise.Perlin(points[1]) && GradientNoise(42).Simplex(points[1]) == noise.Simplex(points[1]));
+
+		const GradientNoiseT<double> precise(42);
+		assert(std::abs(precise.Simplex(VectorT<double>(0.3, 0.2, 0.1))) <= 1.0);
+	}
+
 	//
 	// TODO: more tests
 	//
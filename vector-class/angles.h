@@ -0,0 +1,346 @@
+//
+// angles.h -- conversions between euler angles and direction vectors
+//
+
+#ifndef ANGLES_CLASS_H
+#define ANGLES_CLASS_H
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "vector.h"
+
+namespace detail
+{
+
+//
+// euler angles are stored in a vector_3d as (pitch, yaw, roll) in degrees,
+// with the usual engine conventions: x forward, y left, z up, positive pitch
+// looks down.
+//
+// sine, cosine and arc tangent are polynomial approximations without branches
+// or library calls, so the batch loops vectorize. sine and cosine are within
+// 2^-23 of the exact value for float and 2^-52 for double, arc tangent within
+// two ulps of 180 degrees (2^-15 and 2^-44 degrees). the reduction to
+// quadrants is exact for angles up to 2^20 degrees in magnitude, beyond that
+// the input itself has no fraction of a degree left. float angles beyond 2^28
+// degrees give unspecified results.
+//
+template <VectorType T> requires(std::is_floating_point_v<T>)
+class euler_angles
+{
+public:
+	struct sincos_t
+	{
+		T sin, cos;
+	};
+
+	//
+	// Scalar building blocks
+	//
+
+	// sine and cosine of an angle in degrees
+	static VECTORCLASS_FORCEINLINE sincos_t SinCos(T degrees) noexcept
+	{
+		// nearest multiple of 90 degrees. adding 1.5 * 2^mantissa rounds to an
+		// integer, whose low bits are then the quadrant.
+		const T shifted = degrees * T(1.0 / 90.0) + k_round;
+		const T k = shifted - k_round;
+		const bits_t quadrant = std::bit_cast<bits_t>(shifted) & 3;
+
+		// exact for |degrees| below 2^20, the result lies in [-45, 45]
+		const T r = (degrees - k * T(90)) * k_deg_to_rad;
+		const T r2 = r * r;
+
+		T s, c;
+		if constexpr (sizeof(T) == 4)
+		{
+			s = vector_fma(vector_fma(vector_fma(T(-1.9515295891e-4), r2, T(8.3321608736e-3)), r2, T(-1.6666654611e-1)), r2 * r, r);
+			c = vector_fma(vector_fma(vector_fma(T(2.443315711809948e-5), r2, T(-1.388731625493765e-3)), r2, T(4.166664568298827e-2)), r2 * r2, T(1) - T(0.5) * r2);
+		}
+		else
+		{
+			s = T(1.58962301576546568060e-10);
+			s = vector_fma(s, r2, T(-2.50507477628578072866e-8));
+			s = vector_fma(s, r2, T(2.75573136213857245213e-6));
+			s = vector_fma(s, r2, T(-1.98412698295895385996e-4));
+			s = vector_fma(s, r2, T(8.33333333332211858878e-3));
+			s = vector_fma(s, r2, T(-1.66666666666666307295e-1));
+			s = vector_fma(s, r2 * r, r);
+
+			c = T(-1.13585365213876817300e-11);
+			c = vector_fma(c, r2, T(2.08757008419747316778e-9));
+			c = vector_fma(c, r2, T(-2.75573141792967388112e-7));
+			c = vector_fma(c, r2, T(2.48015872888517045348e-5));
+			c = vector_fma(c, r2, T(-1.38888888888730564116e-3));
+			c = vector_fma(c, r2, T(4.16666666666665929218e-2));
+			c = vector_fma(c, r2 * r2, T(1) - T(0.5) * r2);
+		}
+
+		// rotate by the quadrant
+		const T sin = vector_select(quadrant & 1, c, s);
+		const T cos = vector_select(quadrant & 1, s, c);
+
+		return { vector_flip_sign(quadrant & 2, sin), vector_flip_sign((quadrant + 1) & 2, cos) };
+	}
+
+	// angle of (x, y) in degrees, in [-180, 180]. atan2(0, 0) is 0, signed
+	// zeros are not told apart.
+	static VECTORCLASS_FORCEINLINE T Atan2(T y, T x) noexcept
+	{
+		const T ax = x < T(0) ? -x : x;
+		const T ay = y < T(0) ? -y : y;
+		const T hi = ax > ay ? ax : ay;
+		const T lo = ax > ay ? ay : ax;
+
+		// lo / hi in [0, 1], or (lo - hi) / (lo + hi) in [-0.34, 0.66] past
+		// the split, which subtracts 45 degrees. lo is zero whenever hi is.
+		//
+		const bool shift = lo > k_atan_split * hi;
+		const T num = lo - vector_keep_if(shift, hi);
+		const T den = hi + vector_keep_if(shift, lo);
+		const T t = num / std::max(den, std::numeric_limits<T>::min());
+
+		const T z = t * t;
+
+		T a;
+		if constexpr (sizeof(T) == 4)
+		{
+			a = vector_fma(vector_fma(vector_fma(vector_fma(T(8.05374449538e-2), z, T(-1.38776856032e-1)),
+				z, T(1.99777106478e-1)), z, T(-3.33329491539e-1)), z * t, t);
+		}
+		else
+		{
+			T p = T(-8.750608600031904122785e-1);
+			p = vector_fma(p, z, T(-1.615753718733365076637e1));
+			p = vector_fma(p, z, T(-7.500855792314704667340e1));
+			p = vector_fma(p, z, T(-1.228866684490136173410e2));
+			p = vector_fma(p, z, T(-6.485021904942025371773e1));
+
+			T q = z + T(2.485846490142306297962e1);
+			q = vector_fma(q, z, T(1.650270098316988542046e2));
+			q = vector_fma(q, z, T(4.328810604912902668951e2));
+			q = vector_fma(q, z, T(4.853903996359136964868e2));
+			q = vector_fma(q, z, T(1.945506571482613964425e2));
+
+			a = vector_fma(t, z * p / q, t);
+		}
+
+		// back to degrees and into the right octant
+		T deg = a * k_rad_to_deg + vector_keep_if(shift, T(45));
+		deg = vector_keep_if(ay > ax, T(90)) + vector_flip_sign(ay > ax, deg);
+		deg = vector_keep_if(x < T(0), T(180)) + vector_flip_sign(x < T(0), deg);
+
+		return vector_flip_sign(y < T(0), deg);
+	}
+
+	//
+	// Single conversions
+	//
+
+	// direction vectors of 'angles', any of the outputs may be nullptr
+	static VECTORCLASS_FORCEINLINE void AngleVectors(const vector_3d<T>& angles, vector_3d<T>* forward, vector_3d<T>* right = nullptr, vector_3d<T>* up = nullptr) noexcept
+	{
+		const sincos_t p = SinCos(angles.x), y = SinCos(angles.y), r = SinCos(angles.z);
+
+		if (forward)
+		{
+			forward->x = p.cos * y.cos;
+			forward->y = p.cos * y.sin;
+			forward->z = -p.sin;
+		}
+
+		if (right)
+		{
+			right->x = -r.sin * p.sin * y.cos + r.cos * y.sin;
+			right->y = -r.sin * p.sin * y.sin - r.cos * y.cos;
+			right->z = -r.sin * p.cos;
+		}
+
+		if (up)
+		{
+			up->x = r.cos * p.sin * y.cos + r.sin * y.sin;
+			up->y = r.cos * p.sin * y.sin - r.sin * y.cos;
+			up->z = r.cos * p.cos;
+		}
+	}
+
+	// pitch and yaw in [0, 360) that look along 'forward', roll is zero.
+	// straight up and down come out as pitch 270 and 90 with yaw 0.
+	static VECTORCLASS_FORCEINLINE vector_3d<T> VectorAngles(const vector_3d<T>& forward) noexcept
+	{
+		T yaw = Atan2(forward.y, forward.x);
+		T pitch = Atan2(-forward.z, Sqrt(forward.x * forward.x + forward.y * forward.y));
+
+		yaw += vector_keep_if(yaw < T(0), T(360));
+		pitch += vector_keep_if(pitch < T(0), T(360));
+
+		return { pitch, yaw, T(0) };
+	}
+
+	//
+	// Batch conversions
+	//
+
+	// AngleVectors() for 'count' angles. outputs that are not needed may be
+	// nullptr, outputs may not alias the input.
+	static inline void AngleVectors(const vector_3d<T>* angles, size_t count, vector_3d<T>* forward,
+									vector_3d<T>* right = nullptr, vector_3d<T>* up = nullptr) noexcept
+	{
+		// sine and cosine of every axis first go into separate streams, so
+		// that neither pass has more than one interleaved access per element
+		T sc[6][k_block];
+
+		for (size_t first = 0; first < count; first += k_block)
+		{
+			const size_t n = std::min(k_block, count - first);
+
+			// roll only matters to right and up
+			for (int axis = 0; axis < (right || up ? 3 : 2); axis++)
+				SinCosRun(&angles[first][axis], n, sc[axis * 2], sc[axis * 2 + 1]);
+
+			// one loop per combination, so that the null checks stay out of them
+			if (forward)
+				ForwardRun(sc[0], sc[1], sc[2], sc[3], n, forward + first);
+
+			if (right)
+				RightRun(sc[0], sc[1], sc[2], sc[3], sc[4], sc[5], n, right + first);
+
+			if (up)
+				UpRun(sc[0], sc[1], sc[2], sc[3], sc[4], sc[5], n, up + first);
+		}
+	}
+
+	// VectorAngles() for 'count' directions, 'angles' may alias 'forward'.
+	static inline void VectorAngles(const vector_3d<T>* forward, size_t count, vector_3d<T>* angles) noexcept
+	{
+		// a block is read in full before any of it is written
+		T xyz[3][k_block];
+
+		for (size_t first = 0; first < count; first += k_block)
+		{
+			const size_t n = std::min(k_block, count - first);
+
+			for (int axis = 0; axis < 3; axis++)
+				GatherRun(&forward[first][axis], n, xyz[axis]);
+
+			AnglesRun(xyz[0], xyz[1], xyz[2], n, angles + first);
+		}
+	}
+
+private:
+	using bits_t = vector_bits_t<T>;
+
+	// angles converted at once by the batch AngleVectors()
+	static constexpr size_t k_block = 256;
+
+	// square root of a finite s >= 0. std::sqrt has to be able to set errno,
+	// which keeps loops around it scalar, so this starts from the classic
+	// exponent halving estimate of 1 / sqrt(s), refines it with Newton steps
+	// and corrects the product once, to within an ulp of std::sqrt.
+	static VECTORCLASS_FORCEINLINE T Sqrt(T s) noexcept
+	{
+		// subnormals would throw off the estimate, scale them up first
+		const bool tiny = s < std::numeric_limits<T>::min();
+		s *= vector_select(tiny, k_sqrt_scale, T(1));
+
+		T r = std::bit_cast<T>(k_rsqrt_magic - (std::bit_cast<bits_t>(s) >> 1));
+		for (int i = 0; i < k_rsqrt_steps; i++)
+			r *= T(1.5) - T(0.5) * s * r * r;
+
+		const T h = s * r;
+		return vector_fma(T(0.5) * r, vector_fma(-h, h, s), h) * vector_select(tiny, k_sqrt_unscale, T(1));
+	}
+
+	// sine and cosine of every third T starting at 'degrees'
+	static inline void SinCosRun(const T* __restrict degrees, size_t n, T* __restrict sin, T* __restrict cos) noexcept
+	{
+		for (size_t i = 0; i < n; i++)
+		{
+			const sincos_t v = SinCos(degrees[i * 3]);
+			sin[i] = v.sin;
+			cos[i] = v.cos;
+		}
+	}
+
+	// every third T starting at 'from'
+	static inline void GatherRun(const T* __restrict from, size_t n, T* __restrict to) noexcept
+	{
+		for (size_t i = 0; i < n; i++)
+			to[i] = from[i * 3];
+	}
+
+	static inline void AnglesRun(const T* __restrict x, const T* __restrict y, const T* __restrict z, size_t n,
+								 vector_3d<T>* __restrict out) noexcept
+	{
+		for (size_t i = 0; i < n; i++)
+			out[i] = VectorAngles({ x[i], y[i], z[i] });
+	}
+
+	// the formulas of AngleVectors() over streams of pitch, yaw and roll
+
+	static inline void ForwardRun(const T* __restrict sp, const T* __restrict cp, const T* __restrict sy, const T* __restrict cy,
+								  size_t n, vector_3d<T>* __restrict out) noexcept
+	{
+		for (size_t i = 0; i < n; i++)
+		{
+			out[i].x = cp[i] * cy[i];
+			out[i].y = cp[i] * sy[i];
+			out[i].z = -sp[i];
+		}
+	}
+
+	static inline void RightRun(const T* __restrict sp, const T* __restrict cp, const T* __restrict sy, const T* __restrict cy,
+								const T* __restrict sr, const T* __restrict cr, size_t n, vector_3d<T>* __restrict out) noexcept
+	{
+		for (size_t i = 0; i < n; i++)
+		{
+			out[i].x = -sr[i] * sp[i] * cy[i] + cr[i] * sy[i];
+			out[i].y = -sr[i] * sp[i] * sy[i] - cr[i] * cy[i];
+			out[i].z = -sr[i] * cp[i];
+		}
+	}
+
+	static inline void UpRun(const T* __restrict sp, const T* __restrict cp, const T* __restrict sy, const T* __restrict cy,
+							 const T* __restrict sr, const T* __restrict cr, size_t n, vector_3d<T>* __restrict out) noexcept
+	{
+		for (size_t i = 0; i < n; i++)
+		{
+			out[i].x = cr[i] * sp[i] * cy[i] + sr[i] * sy[i];
+			out[i].y = cr[i] * sp[i] * sy[i] - sr[i] * cy[i];
+			out[i].z = cr[i] * cp[i];
+		}
+	}
+
+	static constexpr T k_deg_to_rad = T(3.14159265358979323846 / 180.0);
+	static constexpr T k_rad_to_deg = T(180.0 / 3.14159265358979323846);
+
+	static constexpr T k_round = T(1.5) * T(bits_t(1) << (std::numeric_limits<T>::digits - 1));
+
+	// 1 / sqrt estimate, good to 0.2%, which takes 3 or 4 steps to reach T
+	static constexpr bits_t k_rsqrt_magic = sizeof(T) == 4 ? bits_t(0x5f375a86) : bits_t(0x5fe6eb50c7b537a9);
+	static constexpr int k_rsqrt_steps = sizeof(T) == 4 ? 3 : 4;
+
+	static constexpr T k_sqrt_scale = sizeof(T) == 4 ? T(0x1p64) : T(0x1p128);
+	static constexpr T k_sqrt_unscale = sizeof(T) == 4 ? T(0x1p-32) : T(0x1p-64);
+
+	// tan(pi / 8) for float, 0.66 for the rational double approximation
+	static constexpr T k_atan_split = sizeof(T) == 4 ? T(0.4142135623730950) : T(0.66);
+};
+
+} // namespace detail
+
+//
+// type declarations
+//
+
+using EulerAngles = detail::euler_angles<float>;
+
+template<typename T> using EulerAnglesT = detail::euler_angles<T>;
+
+#endif // ANGLES_CLASS_H
@@ -0,0 +1,422 @@
+//
+// bounding_sphere.h -- bounding spheres of point sets, approximate and exact
+//
+
+#ifndef BOUNDING_SPHERE_CLASS_H
+#define BOUNDING_SPHERE_CLASS_H
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "vector.h"
+#include "bounds.h"
+#include "parallel.h"
+
+namespace detail
+{
+
+//
+// Ritter() is a fast approximation, typically 5 to 20 percent larger than the
+// minimal sphere. Welzl() computes the minimal sphere and is meant for small
+// sets, such as the clusters of a mesh.
+//
+// both only compare squared distances, a square root is taken once per growth
+// step and for the final radius. batches of clusters are packed one after
+// another, cluster i spans points [offsets[i], offsets[i + 1]).
+//
+// empty sets get a zero sphere at the origin.
+//
+template <VectorType T> requires(std::is_floating_point_v<T>)
+class bounding_sphere
+{
+public:
+	struct sphere_t
+	{
+		vector_3d<T> center;
+		T radius;
+	};
+
+	// points scanned at once in the vectorized passes
+	static constexpr size_t k_block = 256;
+
+	// clusters handed to one worker at once
+	static constexpr size_t k_grain = 256;
+
+	//
+	// Ritter
+	//
+
+	// starts from the most distant pair of the extreme points along the axes
+	// and grows the sphere by every point outside of it
+	inline static sphere_t Ritter(const vector_3d<T>* points, size_t count) noexcept
+	{
+		if (count == 0)
+			return { {}, T(0) };
+
+		size_t ext[6];
+		FindExtremes(points, count, ext);
+
+		size_t a = ext[0], b = ext[1];
+		T best = (points[b] - points[a]).LengthSqr();
+		for (int axis = 1; axis < 3; axis++)
+		{
+			const T d2 = (points[ext[axis * 2 + 1]] - points[ext[axis * 2]]).LengthSqr();
+			if (d2 > best)
+			{
+				best = d2;
+				a = ext[axis * 2];
+				b = ext[axis * 2 + 1];
+			}
+		}
+
+		sphere_t s = { (points[a] + points[b]) * T(0.5), static_cast<T>(vector_sqrt(best)) * T(0.5) };
+		Grow(points, count, s);
+		return s;
+	}
+
+	inline static void Ritter(const vector_3d<T>* points, const uint32_t* offsets, size_t clusters, sphere_batch<T>& out)
+	{
+		Batch(points, offsets, clusters, out, [](const vector_3d<T>* p, size_t n, auto&) { return Ritter(p, n); });
+	}
+
+	//
+	// Welzl
+	//
+
+	// minimal enclosing sphere with the move-to-front variant of Welzl's
+	// algorithm, expected linear time in the number of points
+	inline static sphere_t Welzl(const vector_3d<T>* points, size_t count)
+	{
+		std::vector<vector_3d<T>> list;
+		return Welzl(points, count, list);
+	}
+
+	inline static void Welzl(const vector_3d<T>* points, const uint32_t* offsets, size_t clusters, sphere_batch<T>& out)
+	{
+		Batch(points, offsets, clusters, out, [](const vector_3d<T>* p, size_t n, auto& list) { return Welzl(p, n, list); });
+	}
+
+private:
+	// squared radius, negative for the empty ball
+	struct ball_t
+	{
+		vector_3d<T> center;
+		T radius_sqr;
+	};
+
+	// as above, the points are shuffled in 'list', which batches reuse from
+	// one cluster to the next
+	inline static sphere_t Welzl(const vector_3d<T>* points, size_t count, std::vector<vector_3d<T>>& list)
+	{
+		if (count == 0)
+			return { {}, T(0) };
+
+		// a fixed shuffle avoids the quadratic case of sorted input and keeps
+		// the result deterministic
+		list.assign(points, points + count);
+		uint32_t seed = 0x9e3779b9u;
+		for (size_t i = count - 1; i > 0; i--)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			std::swap(list[i], list[(static_cast<uint64_t>(seed) * (i + 1)) >> 32]);
+		}
+
+		vector_3d<T> support[4];
+		const ball_t ball = MoveToFront(list, count, support, 0);
+
+		// rounding may leave points just outside, the final pass closes the gap
+		sphere_t s = { ball.center, static_cast<T>(vector_sqrt(std::max(ball.radius_sqr, T(0)))) };
+		Grow(points, count, s);
+		return s;
+	}
+
+	// fn(points, count, scratch) for every cluster, the scratch list is kept
+	// per worker
+	template <typename Fn>
+	inline static void Batch(const vector_3d<T>* points, const uint32_t* offsets, size_t clusters, sphere_batch<T>& out, Fn&& fn)
+	{
+		out.Resize(clusters);
+
+		std::vector<std::vector<vector_3d<T>>> scratch(parallel_worker_count(clusters, k_grain));
+
+		parallel_for(clusters, k_grain, [&](size_t begin, size_t end, unsigned worker)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				const sphere_t s = fn(points + offsets[i], offsets[i + 1] - offsets[i], scratch[worker]);
+				out.Set(i, s.center, s.radius);
+			}
+		});
+	}
+
+	// integers with the same order as the coordinates, integer min and max
+	// reductions vectorize where floating point ones need relaxed rules
+	using key_t = std::conditional_t<sizeof(T) == sizeof(int32_t), int32_t, int64_t>;
+
+	inline static key_t OrderedKey(T v) noexcept
+	{
+		const key_t bits = std::bit_cast<key_t>(v + T(0)); // -0 becomes +0
+		return bits ^ ((bits >> (sizeof(key_t) * 8 - 1)) & std::numeric_limits<key_t>::max());
+	}
+
+	// indices of the minimum and maximum point along x, y and z, ties keep the
+	// lowest index. every block is reduced to its extreme keys first, then to
+	// the first index holding them.
+	inline static void FindExtremes(const vector_3d<T>* points, size_t count, size_t* ext) noexcept
+	{
+		key_t lo[3] = { OrderedKey(points[0].x), OrderedKey(points[0].y), OrderedKey(points[0].z) };
+		key_t hi[3] = { lo[0], lo[1], lo[2] };
+		std::fill(ext, ext + 6, size_t(0));
+
+		key_t keys[3][k_block];
+
+		for (size_t first = 0; first < count; first += k_block)
+		{
+			const size_t n = std::min(k_block, count - first);
+
+			for (size_t i = 0; i < n; i++)
+			{
+				keys[0][i] = OrderedKey(points[first + i].x);
+				keys[1][i] = OrderedKey(points[first + i].y);
+				keys[2][i] = OrderedKey(points[first + i].z);
+			}
+
+			for (int axis = 0; axis < 3; axis++)
+			{
+				const key_t* k = keys[axis];
+				key_t min, max;
+				MinMaxKey(k, n, min, max);
+
+				// earlier blocks win ties
+				if (min < lo[axis])
+				{
+					lo[axis] = min;
+					ext[axis * 2] = first + FirstIndexOf(k, n, min);
+				}
+
+				if (max > hi[axis])
+				{
+					hi[axis] = max;
+					ext[axis * 2 + 1] = first + FirstIndexOf(k, n, max);
+				}
+			}
+		}
+	}
+
+	// compares values rather than going through std::min and std::max, whose
+	// references turn into a branch on which one to load
+	inline static void MinMaxKey(const key_t* __restrict keys, size_t n, key_t& min, key_t& max) noexcept
+	{
+		key_t lo = keys[0], hi = keys[0];
+		for (size_t i = 1; i < n; i++)
+		{
+			lo = keys[i] < lo ? keys[i] : lo;
+			hi = keys[i] > hi ? keys[i] : hi;
+		}
+
+		min = lo;
+		max = hi;
+	}
+
+	inline static uint32_t FirstIndexOf(const key_t* __restrict keys, size_t n, key_t key) noexcept
+	{
+		uint32_t index = UINT32_MAX;
+		for (uint32_t i = 0; i < n; i++)
+		{
+			// i where the key matches, all bits set elsewhere
+			const uint32_t candidate = i | (0u - static_cast<uint32_t>(keys[i] != key));
+			index = candidate < index ? candidate : index;
+		}
+
+		return index;
+	}
+
+	// grows the sphere until it contains all points. every block is first
+	// checked as a whole, only blocks with points outside take the scalar path.
+	inline static void Grow(const vector_3d<T>* points, size_t count, sphere_t& s) noexcept
+	{
+		T r2 = s.radius * s.radius;
+
+		for (size_t first = 0; first < count; first += k_block)
+		{
+			const size_t n = std::min(k_block, count - first);
+			const T cx = s.center.x, cy = s.center.y, cz = s.center.z;
+
+			uint32_t outside = 0;
+			for (size_t i = 0; i < n; i++)
+			{
+				const T dx = points[first + i].x - cx, dy = points[first + i].y - cy, dz = points[first + i].z - cz;
+				outside |= dx * dx + dy * dy + dz * dz > r2;
+			}
+
+			if (!outside)
+				continue;
+
+			for (size_t i = 0; i < n; i++)
+			{
+				const vector_3d<T> d = points[first + i] - s.center;
+				const T d2 = d.LengthSqr();
+				if (d2 <= r2)
+					continue;
+
+				// the new sphere touches the point and the far side of the old one
+				const T dist = static_cast<T>(vector_sqrt(d2));
+				const T radius = (s.radius + dist) * T(0.5);
+				s.center += d * ((radius - s.radius) / dist);
+				s.radius = radius;
+
+				// the center moved by rounded amounts, so the point is made to
+				// fit for sure
+				s.radius = std::max(s.radius, static_cast<T>(vector_sqrt((points[first + i] - s.center).LengthSqr())));
+				r2 = s.radius * s.radius;
+			}
+		}
+	}
+
+	// tolerance of the containment test relative to the squared radius, which
+	// keeps rounding from adding points to the support again and again
+	inline static bool Inside(const ball_t& b, const vector_3d<T>& p) noexcept
+	{
+		return (p - b.center).LengthSqr() <= b.radius_sqr * (T(1) + T(64) * std::numeric_limits<T>::epsilon());
+	}
+
+	// minimal ball of list[0 .. n) with the support points on its boundary.
+	// the recursion depth is at most 4, one level per support point.
+	inline static ball_t MoveToFront(std::vector<vector_3d<T>>& list, size_t n, vector_3d<T>* support, size_t s)
+	{
+		ball_t ball = FromSupport(support, s);
+		if (s == 4)
+			return ball;
+
+		for (size_t i = 0; i < n; i++)
+		{
+			if (Inside(ball, list[i]))
+				continue;
+
+			support[s] = list[i];
+			ball = MoveToFront(list, i, support, s + 1);
+
+			// points that were outside once are likely to be outside again
+			std::rotate(list.begin(), list.begin() + i, list.begin() + i + 1);
+		}
+
+		return ball;
+	}
+
+	// smallest ball with all of the support points on its boundary
+	inline static ball_t FromSupport(const vector_3d<T>* p, size_t s) noexcept
+	{
+		constexpr T eps = T(64) * std::numeric_limits<T>::epsilon();
+
+		switch (s)
+		{
+			case 0:
+				return { {}, T(-1) };
+
+			case 1:
+				return { p[0], T(0) };
+
+			case 2:
+				return { (p[0] + p[1]) * T(0.5), (p[1] - p[0]).LengthSqr() * T(0.25) };
+
+			case 3:
+			{
+				// circumcenter in the plane of the triangle
+				const vector_3d<T> ab = p[1] - p[0], ac = p[2] - p[0];
+				vector_3d<T> n, u, v;
+				n.CrossProduct(ab, ac);
+
+				const T n2 = n.LengthSqr();
+				if (n2 <= eps * ab.LengthSqr() * ac.LengthSqr())
+					return Degenerate(p, 3);
+
+				u.CrossProduct(n, ab);
+				v.CrossProduct(ac, n);
+
+				const vector_3d<T> offset = (u * ac.LengthSqr() + v * ab.LengthSqr()) / (T(2) * n2);
+				return { p[0] + offset, offset.LengthSqr() };
+			}
+
+			default:
+			{
+				const vector_3d<T> u = p[1] - p[0], v = p[2] - p[0], w = p[3] - p[0];
+				vector_3d<T> vw, wu, uv;
+				vw.CrossProduct(v, w);
+				wu.CrossProduct(w, u);
+				uv.CrossProduct(u, v);
+
+				const T det = u.Dot(vw);
+				if (det * det <= eps * u.LengthSqr() * v.LengthSqr() * w.LengthSqr())
+					return Degenerate(p, 4);
+
+				const vector_3d<T> offset = (vw * u.LengthSqr() + wu * v.LengthSqr() + uv * w.LengthSqr()) / (T(2) * det);
+				return { p[0] + offset, offset.LengthSqr() };
+			}
+		}
+	}
+
+	// collinear or coplanar support, the smallest ball through a subset of
+	// the points that contains all of them
+	inline static ball_t Degenerate(const vector_3d<T>* p, size_t s) noexcept
+	{
+		ball_t best = { {}, std::numeric_limits<T>::infinity() };
+
+		auto consider = [&](const ball_t& b)
+		{
+			bool all = b.radius_sqr < best.radius_sqr;
+			for (size_t k = 0; all && k < s; k++)
+				all = Inside(b, p[k]);
+
+			if (all)
+				best = b;
+		};
+
+		for (size_t i = 0; i < s; i++)
+		{
+			for (size_t j = i + 1; j < s; j++)
+			{
+				const vector_3d<T> pair[2] = { p[i], p[j] };
+				consider(FromSupport(pair, 2));
+
+				for (size_t k = j + 1; s == 4 && k < s; k++)
+				{
+					const vector_3d<T> triple[3] = { p[i], p[j], p[k] };
+					consider(FromSupport(triple, 3));
+				}
+			}
+		}
+
+		// no subset fits within the tolerance, the center of the points
+		// with the distance to the farthest one always does
+		if (best.radius_sqr == std::numeric_limits<T>::infinity())
+		{
+			vector_3d<T> center;
+			for (size_t k = 0; k < s; k++)
+				center += p[k];
+
+			best = { center / static_cast<T>(s), T(0) };
+			for (size_t k = 0; k < s; k++)
+				best.radius_sqr = std::max(best.radius_sqr, (p[k] - best.center).LengthSqr());
+		}
+
+		return best;
+	}
+};
+
+} // namespace detail
+
+//
+// type declarations
+//
+
+using BoundingSphere = detail::bounding_sphere<float>;
+
+template<typename T> using BoundingSphereT = detail::bounding_sphere<T>;
+
+#endif // BOUNDING_SPHERE_CLASS_H
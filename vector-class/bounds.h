@@ -0,0 +1,179 @@
+//
+// bounds.h -- batches of bounding volumes stored as structure-of-arrays
+//
+
+#ifndef BOUNDS_CLASS_H
+#define BOUNDS_CLASS_H
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "vector.h"
+
+namespace detail
+{
+
+// see ray.h
+template <VectorType T, size_t N> requires(std::is_floating_point_v<T>)
+struct ray_packet;
+
+//
+// axis aligned boxes, one stream per bound component
+//
+template <VectorType T> requires(std::is_floating_point_v<T>)
+class aabb_batch
+{
+public:
+	inline size_t Size() const noexcept
+	{
+		return m_minx.size();
+	}
+
+	inline void Reserve(size_t count)
+	{
+		for (auto* s : { &m_minx, &m_miny, &m_minz, &m_maxx, &m_maxy, &m_maxz })
+			s->reserve(count);
+	}
+
+	inline void Clear() noexcept
+	{
+		for (auto* s : { &m_minx, &m_miny, &m_minz, &m_maxx, &m_maxy, &m_maxz })
+			s->clear();
+	}
+
+	inline void Add(const vector_3d<T>& mins, const vector_3d<T>& maxs)
+	{
+		m_minx.push_back(mins.x); m_miny.push_back(mins.y); m_minz.push_back(mins.z);
+		m_maxx.push_back(maxs.x); m_maxy.push_back(maxs.y); m_maxz.push_back(maxs.z);
+	}
+
+	inline vector_3d<T> GetMins(size_t i) const noexcept
+	{
+		return { m_minx[i], m_miny[i], m_minz[i] };
+	}
+
+	inline vector_3d<T> GetMaxs(size_t i) const noexcept
+	{
+		return { m_maxx[i], m_maxy[i], m_maxz[i] };
+	}
+
+	// raw streams, for custom kernels
+	inline const T* MinsX() const noexcept { return m_minx.data(); }
+	inline const T* MinsY() const noexcept { return m_miny.data(); }
+	inline const T* MinsZ() const noexcept { return m_minz.data(); }
+	inline const T* MaxsX() const noexcept { return m_maxx.data(); }
+	inline const T* MaxsY() const noexcept { return m_maxy.data(); }
+	inline const T* MaxsZ() const noexcept { return m_maxz.data(); }
+
+	// slab test of all boxes against all lanes of the packet. writes entry
+	// distance for every box and lane (Size() * N values, box major), infinity
+	// when the lane misses the box or enters it beyond 'tmax'. rays starting
+	// inside of a box report zero.
+	template <size_t N>
+	inline void Intersect(const ray_packet<T, N>& p, T* tnear, T tmax = std::numeric_limits<T>::infinity()) const noexcept
+	{
+		constexpr T inf = std::numeric_limits<T>::infinity();
+
+		for (size_t k = 0; k < Size(); k++)
+		{
+			T* __restrict out = tnear + k * N;
+
+			for (size_t i = 0; i < N; i++)
+			{
+				const T x0 = (m_minx[k] - p.ox[i]) * p.inv_dx[i], x1 = (m_maxx[k] - p.ox[i]) * p.inv_dx[i];
+				const T y0 = (m_miny[k] - p.oy[i]) * p.inv_dy[i], y1 = (m_maxy[k] - p.oy[i]) * p.inv_dy[i];
+				const T z0 = (m_minz[k] - p.oz[i]) * p.inv_dz[i], z1 = (m_maxz[k] - p.oz[i]) * p.inv_dz[i];
+
+				const T tn = std::max(std::max(std::min(x0, x1), std::min(y0, y1)), std::max(std::min(z0, z1), T(0)));
+				const T tf = std::min(std::min(std::max(x0, x1), std::max(y0, y1)), std::min(std::max(z0, z1), tmax));
+
+				out[i] = tn <= tf ? tn : inf;
+			}
+		}
+	}
+
+private:
+	std::vector<T> m_minx, m_miny, m_minz;
+	std::vector<T> m_maxx, m_maxy, m_maxz;
+};
+
+//
+// spheres, one stream per center component plus radius
+//
+template <VectorType T> requires(std::is_floating_point_v<T>)
+class sphere_batch
+{
+public:
+	inline size_t Size() const noexcept
+	{
+		return m_cx.size();
+	}
+
+	inline void Reserve(size_t count)
+	{
+		for (auto* s : { &m_cx, &m_cy, &m_cz, &m_r })
+			s->reserve(count);
+	}
+
+	inline void Clear() noexcept
+	{
+		for (auto* s : { &m_cx, &m_cy, &m_cz, &m_r })
+			s->clear();
+	}
+
+	// new spheres are zero
+	inline void Resize(size_t count)
+	{
+		for (auto* s : { &m_cx, &m_cy, &m_cz, &m_r })
+			s->resize(count);
+	}
+
+	inline void Add(const vector_3d<T>& center, T radius)
+	{
+		m_cx.push_back(center.x); m_cy.push_back(center.y); m_cz.push_back(center.z);
+		m_r.push_back(radius);
+	}
+
+	inline vector_3d<T> GetCenter(size_t i) const noexcept
+	{
+		return { m_cx[i], m_cy[i], m_cz[i] };
+	}
+
+	inline T GetRadius(size_t i) const noexcept
+	{
+		return m_r[i];
+	}
+
+	inline void Set(size_t i, const vector_3d<T>& center, T radius) noexcept
+	{
+		m_cx[i] = center.x; m_cy[i] = center.y; m_cz[i] = center.z;
+		m_r[i] = radius;
+	}
+
+	// raw streams, for custom kernels
+	inline const T* CenterX() const noexcept { return m_cx.data(); }
+	inline const T* CenterY() const noexcept { return m_cy.data(); }
+	inline const T* CenterZ() const noexcept { return m_cz.data(); }
+	inline const T* Radius() const noexcept { return m_r.data(); }
+
+private:
+	std::vector<T> m_cx, m_cy, m_cz, m_r;
+};
+
+} // namespace detail
+
+//
+// type declarations
+//
+
+using AABBBatch = detail::aabb_batch<float>;
+using SphereBatch = detail::sphere_batch<float>;
+
+template<typename T> using AABBBatchT = detail::aabb_batch<T>;
+template<typename T> using SphereBatchT = detail::sphere_batch<T>;
+
+#endif // BOUNDS_CLASS_H
@@ -7,8 +7,11 @@
 #pragma once
 
 #include <cmath>
+#include <cstdint>
 #include <type_traits>
 
+#include "instrument.h"
+
 namespace detail
 {
 
@@ -80,6 +83,8 @@ public:
 
 	constexpr inline uint32_t as_u32() const noexcept
 	{
+		VECTORCLASS_COUNT(k_color_as_u32);
+
 		uint32_t out;
 		out = ((uint32_t)f32_to_int8_sat(r)) << 0;
 		out |= ((uint32_t)f32_to_int8_sat(g)) << 8;
@@ -175,6 +180,8 @@ public:
 
 	constexpr inline uint32_t as_u32() const noexcept
 	{
+		VECTORCLASS_COUNT(k_color255_as_u32);
+
 		uint32_t out;
 		out = r << 0;
 		out |= g << 8;
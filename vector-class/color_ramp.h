@@ -0,0 +1,238 @@
+//
+// color_ramp.h -- color gradients baked into lookup tables
+//
+
+#ifndef COLOR_RAMP_CLASS_H
+#define COLOR_RAMP_CLASS_H
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "color.h"
+#include "color_space.h"
+#include "parallel.h"
+
+namespace detail
+{
+
+//
+// piecewise linear gradient between color stops, used to map scalars to
+// colors. build() bakes the gradient into a dense table of colors and their
+// packed as_u32 form, so mapping a scalar is a scale, a clamp and a gather
+// instead of a search over the stops.
+//
+// stop colors are sRGB encoded. the gradient is interpolated either directly
+// on the encoded values or in linear light, which keeps the brightness of
+// blends between saturated colors even.
+//
+template<ColorType T> requires(std::is_floating_point_v<T>)
+class color_ramp
+{
+public:
+	enum space_t
+	{
+		k_srgb,		// interpolate the encoded values
+		k_linear,	// interpolate in linear light
+	};
+
+	struct stop_t
+	{
+		T position;
+		color<T> value;
+	};
+
+	static constexpr size_t k_default_size = 256;
+
+	// scalars handed to one worker at once
+	static constexpr size_t k_grain = 64 * 1024;
+
+	//
+	// Construction and destruction
+	//
+
+	// the table is built right away, as a transparent black ramp without
+	// stops, so lookups are valid before the first build()
+	color_ramp()
+	{
+		build();
+	}
+
+	color_ramp(const stop_t* stops, size_t count, space_t space = k_srgb, size_t size = k_default_size)
+	{
+		for (size_t i = 0; i < count; i++)
+			add_stop(stops[i].position, stops[i].value);
+
+		build(space, size);
+	}
+
+	//
+	// stops
+	//
+
+	// stops are kept sorted, stops at equal positions keep insertion order and
+	// form a hard edge
+	inline void add_stop(T position, const color<T>& value)
+	{
+		auto it = std::upper_bound(m_stops.begin(), m_stops.end(), position, [](T p, const stop_t& s) { return p < s.position; });
+		m_stops.insert(it, { position, value });
+	}
+
+	inline void clear_stops() noexcept
+	{
+		m_stops.clear();
+	}
+
+	inline const std::vector<stop_t>& stops() const noexcept
+	{
+		return m_stops;
+	}
+
+	// exact gradient value, scalars outside of the stops take the end colors
+	inline color<T> sample(T x, space_t space = k_srgb) const noexcept
+	{
+		if (m_stops.empty())
+			return {};
+
+		if (!(x > m_stops.front().position))
+			return m_stops.front().value;
+
+		if (!(x < m_stops.back().position))
+			return m_stops.back().value;
+
+		size_t i = 1;
+		while (m_stops[i].position <= x)
+			i++;
+
+		const stop_t& a = m_stops[i - 1];
+		const stop_t& b = m_stops[i];
+		const T t = (x - a.position) / (b.position - a.position);
+
+		if (space == k_linear)
+		{
+			return color_space<T>::linear_to_srgb(lerp(color_space<T>::srgb_to_linear(a.value), color_space<T>::srgb_to_linear(b.value), t));
+		}
+
+		return lerp(a.value, b.value, t);
+	}
+
+	//
+	// lookup table
+	//
+
+	// bakes 'size' evenly spaced samples between the first and the last stop
+	inline void build(space_t space = k_srgb, size_t size = k_default_size)
+	{
+		size = std::max<size_t>(size, 2);
+
+		m_lut.resize(size);
+		m_packed.resize(size);
+
+		m_min = m_stops.empty() ? T(0) : m_stops.front().position;
+		const T max = m_stops.empty() ? T(1) : m_stops.back().position;
+		const T range = max > m_min ? max - m_min : T(1);
+
+		for (size_t i = 0; i < size; i++)
+		{
+			m_lut[i] = sample(m_min + range * static_cast<T>(i) / static_cast<T>(size - 1), space);
+			m_packed[i] = m_lut[i].as_u32();
+		}
+
+		m_scale = static_cast<T>(size - 1) / range;
+	}
+
+	inline size_t size() const noexcept
+	{
+		return m_lut.size();
+	}
+
+	inline const color<T>* table() const noexcept
+	{
+		return m_lut.data();
+	}
+
+	inline const uint32_t* packed_table() const noexcept
+	{
+		return m_packed.data();
+	}
+
+	// nearest table entry, NaN maps to the first one
+	inline uint32_t lookup_u32(T x) const noexcept
+	{
+		return m_packed[index(x)];
+	}
+
+	// interpolated between the two nearest table entries
+	inline color<T> lookup(T x) const noexcept
+	{
+		const T max = static_cast<T>(m_lut.size() - 1);
+		T s = (x - m_min) * m_scale;
+		s = s > T(0) ? s : T(0);
+		s = s < max ? s : max;
+
+		const size_t i = std::min(static_cast<size_t>(s), m_lut.size() - 2);
+		return lerp(m_lut[i], m_lut[i + 1], s - static_cast<T>(i));
+	}
+
+	//
+	// batch mapping, uses the table of the last build()
+	//
+
+	inline void map(const T* values, size_t count, uint32_t* out) const
+	{
+		parallel_for(count, k_grain, [&](size_t begin, size_t end)
+		{
+			const uint32_t* __restrict lut = m_packed.data();
+
+			for (size_t i = begin; i < end; i++)
+				out[i] = lut[index(values[i])];
+		});
+	}
+
+	inline void map(const T* values, size_t count, color<T>* out) const
+	{
+		parallel_for(count, k_grain, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				out[i] = lookup(values[i]);
+		});
+	}
+
+private:
+	// the comparisons are written so that NaN ends up at zero
+	inline size_t index(T x) const noexcept
+	{
+		const T max = static_cast<T>(m_lut.size() - 1);
+		T s = (x - m_min) * m_scale + T(0.5);
+		s = s > T(0) ? s : T(0);
+		s = s < max ? s : max;
+
+		return static_cast<size_t>(s);
+	}
+
+	static inline color<T> lerp(const color<T>& a, const color<T>& b, T t) noexcept
+	{
+		return { a.r + (b.r - a.r) * t, a.g + (b.g - a.g) * t, a.b + (b.b - a.b) * t, a.a + (b.a - a.a) * t };
+	}
+
+private:
+	std::vector<stop_t> m_stops;
+
+	std::vector<color<T>> m_lut;
+	std::vector<uint32_t> m_packed;
+	T m_min = T(0), m_scale = T(1);
+};
+
+} // namespace detail
+
+//
+// type declarations
+//
+
+using CColorRamp = detail::color_ramp<float>;
+
+template<typename T> using CColorRampT = detail::color_ramp<T>;
+
+#endif // COLOR_RAMP_CLASS_H
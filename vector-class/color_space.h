@@ -0,0 +1,281 @@
+//
+// color_space.h -- HSV, HSL, YCbCr and sRGB conversions for color and color255
+//
+
+#ifndef COLOR_SPACE_CLASS_H
+#define COLOR_SPACE_CLASS_H
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "vector.h"
+#include "color.h"
+
+namespace detail
+{
+
+//
+// color space conversions. converted colors are stored in color<T> as well,
+// with the channels meaning:
+//
+//	hsv:	r = hue, g = saturation, b = value
+//	hsl:	r = hue, g = saturation, b = lightness
+//	ycbcr:	r = Y, g = Cb, b = Cr (bt.601 full range, chroma centered on 0.5)
+//
+// hue is a fraction of the full turn in [0, 1), alpha is passed through.
+// the channel order is resolved with min/max and bit selects instead of
+// branches, so that the batch overloads vectorize.
+//
+template<ColorType T> requires(std::is_floating_point_v<T>)
+class color_space
+{
+public:
+	//
+	// HSV
+	//
+
+	static constexpr inline color<T> rgb_to_hsv(const color<T>& c) noexcept
+	{
+		T h, d, mx;
+		hue_chroma(c, h, d, mx);
+
+		return { h, d / (mx + k_epsilon), mx, c.a };
+	}
+
+	static constexpr inline color<T> hsv_to_rgb(const color<T>& c) noexcept
+	{
+		const T h6 = c.r * T(6), s = c.g, v = c.b;
+
+		// f(n) = v - v * s * clamp(min(k, 4 - k), 0, 1), k = (n + h * 6) mod 6
+		auto f = [=](T n)
+		{
+			const T k = wrap(n + h6, T(6));
+			return v - v * s * clamp(std::min(k, T(4) - k), T(0), T(1));
+		};
+
+		return { f(T(5)), f(T(3)), f(T(1)), c.a };
+	}
+
+	//
+	// HSL
+	//
+
+	static constexpr inline color<T> rgb_to_hsl(const color<T>& c) noexcept
+	{
+		T h, d, mx;
+		hue_chroma(c, h, d, mx);
+
+		const T l = mx - d * T(0.5);
+		const T s = d / (T(1) - abs(T(2) * l - T(1)) + k_epsilon);
+
+		return { h, s, l, c.a };
+	}
+
+	static constexpr inline color<T> hsl_to_rgb(const color<T>& c) noexcept
+	{
+		const T h12 = c.r * T(12), l = c.b;
+		const T a = c.g * std::min(l, T(1) - l);
+
+		// f(n) = l - a * clamp(min(k - 3, 9 - k), -1, 1), k = (n + h * 12) mod 12
+		auto f = [=](T n)
+		{
+			const T k = wrap(n + h12, T(12));
+			return l - a * clamp(std::min(k - T(3), T(9) - k), T(-1), T(1));
+		};
+
+		return { f(T(0)), f(T(8)), f(T(4)), c.a };
+	}
+
+	//
+	// YCbCr
+	//
+
+	static constexpr inline color<T> rgb_to_ycbcr(const color<T>& c) noexcept
+	{
+		return
+		{
+			T(0.299) * c.r + T(0.587) * c.g + T(0.114) * c.b,
+			T(0.5) - T(0.168736) * c.r - T(0.331264) * c.g + T(0.5) * c.b,
+			T(0.5) + T(0.5) * c.r - T(0.418688) * c.g - T(0.081312) * c.b,
+			c.a,
+		};
+	}
+
+	static constexpr inline color<T> ycbcr_to_rgb(const color<T>& c) noexcept
+	{
+		const T y = c.r, cb = c.g - T(0.5), cr = c.b - T(0.5);
+
+		return
+		{
+			y + T(1.402) * cr,
+			y - T(0.344136) * cb - T(0.714136) * cr,
+			y + T(1.772) * cb,
+			c.a,
+		};
+	}
+
+	// 8-bit fixed point variant with 16 fractional bits, matches the float one
+	// within one unit and never leaves the integer domain
+	static constexpr inline color255<uint8_t> rgb_to_ycbcr(const color255<uint8_t>& c) noexcept
+	{
+		const int32_t r = c.r, g = c.g, b = c.b;
+
+		return
+		{
+			clamp_u8((19595 * r + 38470 * g + 7471 * b + 32768) >> 16),
+			clamp_u8((-11059 * r - 21709 * g + 32768 * b + (128 << 16) + 32768) >> 16),
+			clamp_u8((32768 * r - 27439 * g - 5329 * b + (128 << 16) + 32768) >> 16),
+			c.a,
+		};
+	}
+
+	static constexpr inline color255<uint8_t> ycbcr_to_rgb(const color255<uint8_t>& c) noexcept
+	{
+		const int32_t y = c.r, cb = c.g - 128, cr = c.b - 128;
+
+		return
+		{
+			clamp_u8(y + ((91881 * cr + 32768) >> 16)),
+			clamp_u8(y + ((-22554 * cb - 46802 * cr + 32768) >> 16)),
+			clamp_u8(y + ((116130 * cb + 32768) >> 16)),
+			c.a,
+		};
+	}
+
+	//
+	// sRGB transfer function, alpha is passed through
+	//
+
+	static inline color<T> srgb_to_linear(const color<T>& c) noexcept
+	{
+		return { srgb_to_linear(c.r), srgb_to_linear(c.g), srgb_to_linear(c.b), c.a };
+	}
+
+	static inline color<T> linear_to_srgb(const color<T>& c) noexcept
+	{
+		return { linear_to_srgb(c.r), linear_to_srgb(c.g), linear_to_srgb(c.b), c.a };
+	}
+
+	static inline T srgb_to_linear(T x) noexcept
+	{
+		return x <= T(0.04045) ? x / T(12.92) : std::pow((x + T(0.055)) / T(1.055), T(2.4));
+	}
+
+	static inline T linear_to_srgb(T x) noexcept
+	{
+		return x <= T(0.0031308) ? x * T(12.92) : T(1.055) * std::pow(x, T(1.0 / 2.4)) - T(0.055);
+	}
+
+	//
+	// batch variants, 'in' and 'out' may be the same array
+	//
+
+	static inline void rgb_to_hsv(const color<T>* in, color<T>* out, size_t count) noexcept
+	{
+		for (size_t i = 0; i < count; i++)
+			out[i] = rgb_to_hsv(in[i]);
+	}
+
+	static inline void hsv_to_rgb(const color<T>* in, color<T>* out, size_t count) noexcept
+	{
+		for (size_t i = 0; i < count; i++)
+			out[i] = hsv_to_rgb(in[i]);
+	}
+
+	static inline void rgb_to_hsl(const color<T>* in, color<T>* out, size_t count) noexcept
+	{
+		for (size_t i = 0; i < count; i++)
+			out[i] = rgb_to_hsl(in[i]);
+	}
+
+	static inline void hsl_to_rgb(const color<T>* in, color<T>* out, size_t count) noexcept
+	{
+		for (size_t i = 0; i < count; i++)
+			out[i] = hsl_to_rgb(in[i]);
+	}
+
+	static inline void rgb_to_ycbcr(const color<T>* in, color<T>* out, size_t count) noexcept
+	{
+		for (size_t i = 0; i < count; i++)
+			out[i] = rgb_to_ycbcr(in[i]);
+	}
+
+	static inline void ycbcr_to_rgb(const color<T>* in, color<T>* out, size_t count) noexcept
+	{
+		for (size_t i = 0; i < count; i++)
+			out[i] = ycbcr_to_rgb(in[i]);
+	}
+
+	static inline void rgb_to_ycbcr(const color255<uint8_t>* in, color255<uint8_t>* out, size_t count) noexcept
+	{
+		for (size_t i = 0; i < count; i++)
+			out[i] = rgb_to_ycbcr(in[i]);
+	}
+
+	static inline void ycbcr_to_rgb(const color255<uint8_t>* in, color255<uint8_t>* out, size_t count) noexcept
+	{
+		for (size_t i = 0; i < count; i++)
+			out[i] = ycbcr_to_rgb(in[i]);
+	}
+
+private:
+	// keeps saturation finite for black and white
+	static constexpr T k_epsilon = T(1e-10);
+
+	// hue, chroma and max channel, branch-free ordering of the channels
+	// (http://lolengine.net/blog/2013/01/13/fast-rgb-to-hsv)
+	static constexpr inline void hue_chroma(const color<T>& c, T& h, T& d, T& mx) noexcept
+	{
+		const bool gb = c.g < c.b;
+		const T p0 = vector_select(gb, c.b, c.g), p1 = vector_select(gb, c.g, c.b);
+		const T p2 = vector_keep_if(gb, T(-1)), p3 = vector_select(gb, T(2.0 / 3.0), T(-1.0 / 3.0));
+
+		const bool rp = c.r < p0;
+		const T q0 = vector_select(rp, p0, c.r), q1 = p1;
+		const T q2 = vector_select(rp, p3, p2), q3 = vector_select(rp, c.r, p0);
+
+		d = q0 - std::min(q3, q1);
+		h = abs(q2 + (q3 - q1) / (T(6) * d + k_epsilon));
+		mx = q0;
+
+		// hue of exactly one turn is the same as zero
+		h -= vector_keep_if(h >= T(1), T(1));
+	}
+
+	static constexpr inline T wrap(T x, T period) noexcept
+	{
+		return x - vector_keep_if(x >= period, period);
+	}
+
+	// same as std::clamp, whose two compares end up as branches
+	static constexpr inline T clamp(T x, T lo, T hi) noexcept
+	{
+		return vector_select(x < lo, lo, vector_select(hi < x, hi, x));
+	}
+
+	static constexpr inline T abs(T x) noexcept
+	{
+		return vector_flip_sign(x < T(0), x);
+	}
+
+	static constexpr inline uint8_t clamp_u8(int32_t x) noexcept
+	{
+		return static_cast<uint8_t>(x < 0 ? 0 : x > 255 ? 255 : x);
+	}
+};
+
+} // namespace detail
+
+//
+// type declarations
+//
+
+using CColorSpace = detail::color_space<float>;
+
+template<typename T> using CColorSpaceT = detail::color_space<T>;
+
+#endif // COLOR_SPACE_CLASS_H
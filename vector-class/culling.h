@@ -0,0 +1,364 @@
+//
+// culling.h -- plane type and batched frustum culling
+//
+
+#ifndef CULLING_CLASS_H
+#define CULLING_CLASS_H
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "vector.h"
+#include "bounds.h"
+#include "parallel.h"
+
+namespace detail
+{
+
+//
+// plane given by normal and distance from origin, points p with
+// normal.Dot(p) == dist lie on the plane
+//
+template <VectorType T> requires(std::is_floating_point_v<T>)
+class plane
+{
+public:
+	constexpr plane() noexcept :
+		dist(0)
+	{
+	}
+
+	constexpr plane(const vector_3d<T>& _normal, T _dist) noexcept :
+		normal(_normal),
+		dist(_dist)
+	{
+	}
+
+	// plane with given normal going through point
+	constexpr inline static plane FromPointNormal(const vector_3d<T>& point, const vector_3d<T>& _normal) noexcept
+	{
+		return { _normal, _normal.Dot(point) };
+	}
+
+	// plane through three points, counter-clockwise winding faces the normal
+	inline static plane FromPoints(const vector_3d<T>& a, const vector_3d<T>& b, const vector_3d<T>& c) noexcept
+	{
+		vector_3d<T> n;
+		n.CrossProduct(b - a, c - a);
+		return FromPointNormal(a, n.Normalize());
+	}
+
+	// signed distance, positive on the side the normal points to
+	constexpr inline T DistanceTo(const vector_3d<T>& point) const noexcept
+	{
+		return normal.Dot(point) - dist;
+	}
+
+	// rescales the plane to unit normal
+	inline auto& Normalize() noexcept
+	{
+		const T len = normal.Length();
+
+		if (len != T(0))
+		{
+			normal /= len;
+			dist /= len;
+		}
+
+		return *this;
+	}
+
+public:
+	vector_3d<T> normal;
+	T dist;
+};
+
+//
+// convex volume bounded by up to k_max_planes planes facing inwards, culls
+// batches of spheres and boxes into compact lists of visible indices.
+//
+// every object may carry a cached index of the plane that rejected it last
+// time. objects rarely move far between frames, so the cached plane is tested
+// first for the whole block and only the survivors run the full test.
+//
+template <VectorType T> requires(std::is_floating_point_v<T>)
+class frustum
+{
+public:
+	static constexpr size_t k_max_planes = 8;
+
+	// objects processed in one block of the two-pass kernel
+	static constexpr size_t k_block = 1024;
+
+	//
+	// Construction and destruction
+	//
+
+	frustum() noexcept = default;
+
+	frustum(const plane<T>* planes, size_t count) noexcept
+	{
+		for (size_t i = 0; i < count && i < k_max_planes; i++)
+			AddPlane(planes[i]);
+	}
+
+	// perspective view volume looking along 'forward' with given full fov
+	// angles in degrees. forward, right and up are expected to be normalized.
+	inline static frustum FromPerspective(const vector_3d<T>& origin, const vector_3d<T>& forward,
+										  const vector_3d<T>& right, const vector_3d<T>& up,
+										  T fov_x, T fov_y, T znear, T zfar) noexcept
+	{
+		const T tx = static_cast<T>(std::tan(fov_x * T(0.5) * T(3.14159265358979323846) / T(180)));
+		const T ty = static_cast<T>(std::tan(fov_y * T(0.5) * T(3.14159265358979323846) / T(180)));
+
+		frustum f;
+		f.AddPlane(plane<T>::FromPointNormal(origin + forward * znear, forward));
+		f.AddPlane(plane<T>::FromPointNormal(origin + forward * zfar, -forward));
+		f.AddPlane(plane<T>::FromPointNormal(origin, (forward * tx + right).Normalize()));
+		f.AddPlane(plane<T>::FromPointNormal(origin, (forward * tx - right).Normalize()));
+		f.AddPlane(plane<T>::FromPointNormal(origin, (forward * ty + up).Normalize()));
+		f.AddPlane(plane<T>::FromPointNormal(origin, (forward * ty - up).Normalize()));
+		return f;
+	}
+
+	inline void AddPlane(const plane<T>& p) noexcept
+	{
+		if (m_count >= k_max_planes)
+			return;
+
+		m_nx[m_count] = p.normal.x;
+		m_ny[m_count] = p.normal.y;
+		m_nz[m_count] = p.normal.z;
+		m_d[m_count] = p.dist;
+		m_count++;
+	}
+
+	inline plane<T> GetPlane(size_t i) const noexcept
+	{
+		return { { m_nx[i], m_ny[i], m_nz[i] }, m_d[i] };
+	}
+
+	inline size_t PlaneCount() const noexcept
+	{
+		return m_count;
+	}
+
+	//
+	// Single object tests
+	//
+
+	inline bool IsSphereVisible(const vector_3d<T>& center, T radius) const noexcept
+	{
+		for (size_t k = 0; k < m_count; k++)
+		{
+			if (GetPlane(k).DistanceTo(center) + radius < T(0))
+				return false;
+		}
+
+		return true;
+	}
+
+	inline bool IsBoxVisible(const vector_3d<T>& mins, const vector_3d<T>& maxs) const noexcept
+	{
+		for (size_t k = 0; k < m_count; k++)
+		{
+			// box corner furthest along the normal
+			const vector_3d<T> corner(m_nx[k] >= T(0) ? maxs.x : mins.x,
+									  m_ny[k] >= T(0) ? maxs.y : mins.y,
+									  m_nz[k] >= T(0) ? maxs.z : mins.z);
+
+			if (GetPlane(k).DistanceTo(corner) < T(0))
+				return false;
+		}
+
+		return true;
+	}
+
+	//
+	// Batched culling
+	//
+
+	// appends indices of visible spheres to 'visible' in increasing order.
+	// plane_cache is optional, when given it has to hold spheres.Size() bytes
+	// and is kept across frames (zero initialized is fine).
+	inline void CullSpheres(const sphere_batch<T>& spheres, std::vector<uint32_t>& visible, uint8_t* plane_cache = nullptr) const
+	{
+		const T* cx = spheres.CenterX();
+		const T* cy = spheres.CenterY();
+		const T* cz = spheres.CenterZ();
+		const T* rs = spheres.Radius();
+
+		const T* sources[] = { cx, cy, cz, rs };
+
+		Cull(spheres.Size(), visible, plane_cache, sources, [=, this](size_t i, size_t k)
+		{
+			return vector_fma(m_nz[k], cz[i], vector_fma(m_ny[k], cy[i], m_nx[k] * cx[i])) - m_d[k] + rs[i];
+		},
+		[this](size_t k, const bounds_t<4>& b, size_t n, uint8_t* rejected_by)
+		{
+			PlaneRun<true>(b[0], b[1], b[2], b[3], k, n, rejected_by);
+		});
+	}
+
+	// same as above for boxes, the box is projected onto each plane normal
+	inline void CullBoxes(const aabb_batch<T>& boxes, std::vector<uint32_t>& visible, uint8_t* plane_cache = nullptr) const
+	{
+		const T* x0 = boxes.MinsX();
+		const T* y0 = boxes.MinsY();
+		const T* z0 = boxes.MinsZ();
+		const T* x1 = boxes.MaxsX();
+		const T* y1 = boxes.MaxsY();
+		const T* z1 = boxes.MaxsZ();
+
+		const T* sources[] = { x0, y0, z0, x1, y1, z1 };
+
+		Cull(boxes.Size(), visible, plane_cache, sources, [=, this](size_t i, size_t k)
+		{
+			// same as IsBoxVisible
+			const T px = m_nx[k] >= T(0) ? x1[i] : x0[i];
+			const T py = m_ny[k] >= T(0) ? y1[i] : y0[i];
+			const T pz = m_nz[k] >= T(0) ? z1[i] : z0[i];
+			return vector_fma(m_nz[k], pz, vector_fma(m_ny[k], py, m_nx[k] * px)) - m_d[k];
+		},
+		[this](size_t k, const bounds_t<6>& b, size_t n, uint8_t* rejected_by)
+		{
+			// the corner is picked once per plane, by stream
+			PlaneRun<false>(b[m_nx[k] >= T(0) ? 3 : 0], b[m_ny[k] >= T(0) ? 4 : 1], b[m_nz[k] >= T(0) ? 5 : 2], nullptr, k, n, rejected_by);
+		});
+	}
+
+private:
+	// bounds of the survivors of a block, one contiguous stream per source
+	template<size_t N>
+	using bounds_t = std::array<T*, N>;
+
+	// records plane k as the first one rejecting each of the n objects that
+	// reach less than zero in front of it, 'w' is added to the distance
+	template<bool Offset>
+	inline void PlaneRun(const T* __restrict x, const T* __restrict y, const T* __restrict z, const T* __restrict w,
+						 size_t k, size_t n, uint8_t* __restrict rejected_by) const noexcept
+	{
+		const T nx = m_nx[k], ny = m_ny[k], nz = m_nz[k], d = m_d[k];
+		const uint8_t plane = static_cast<uint8_t>(k), none = static_cast<uint8_t>(m_count);
+
+		for (size_t s = 0; s < n; s++)
+		{
+			T margin = vector_fma(nz, z[s], vector_fma(ny, y[s], nx * x[s])) - d;
+			if constexpr (Offset)
+				margin += w[s];
+
+			rejected_by[s] = ((margin < T(0)) & (rejected_by[s] == none)) ? plane : rejected_by[s];
+		}
+	}
+
+	//
+	// 'margin(i, k)' returns how far object i reaches in front of plane k,
+	// negative value means the object is fully behind and thus rejected.
+	//
+	// pass 1 tests the cached plane of every object in the block, pass 2 runs
+	// all planes only for the objects that survived and updates their cache.
+	// pass 2 first gathers the 'sources' streams of the survivors into
+	// contiguous blocks, 'planes(k, bounds, n, rejected_by)' then tests them
+	// against plane k with unit stride.
+	// blocks are spread over workers and their outputs are concatenated in
+	// block order, so the result does not depend on the thread count.
+	//
+	template<size_t N, typename Fn, typename Planes>
+	inline void Cull(size_t count, std::vector<uint32_t>& visible, uint8_t* plane_cache,
+					 const T* const (&sources)[N], Fn margin, Planes planes) const
+	{
+		const size_t first = visible.size();
+		const size_t blocks = (count + k_block - 1) / k_block;
+
+		std::vector<std::vector<uint32_t>> buckets(blocks);
+
+		parallel_for(blocks, 1, [&](size_t begin, size_t end)
+		{
+			uint32_t survivors[k_block];
+			T scratch[N][k_block];
+
+			bounds_t<N> bounds;
+			for (size_t c = 0; c < N; c++)
+				bounds[c] = scratch[c];
+
+			for (size_t b = begin; b < end; b++)
+			{
+				const size_t lo = b * k_block, hi = std::min(lo + k_block, count);
+				size_t n = 0;
+
+				if (plane_cache)
+				{
+					for (size_t i = lo; i < hi; i++)
+					{
+						const size_t k = plane_cache[i] < m_count ? plane_cache[i] : 0;
+
+						survivors[n] = static_cast<uint32_t>(i);
+						n += m_count == 0 || margin(i, k) >= T(0);
+					}
+				}
+				else
+				{
+					for (size_t i = lo; i < hi; i++)
+						survivors[n++] = static_cast<uint32_t>(i);
+				}
+
+				for (size_t c = 0; c < N; c++)
+				{
+					for (size_t s = 0; s < n; s++)
+						scratch[c][s] = sources[c][survivors[s]];
+				}
+
+				// plane major, so that every plane is one branch-free loop over the
+				// survivors which records the first plane rejecting each of them
+				uint8_t rejected_by[k_block];
+				for (size_t s = 0; s < n; s++)
+					rejected_by[s] = static_cast<uint8_t>(m_count);
+
+				for (size_t k = 0; k < m_count; k++)
+					planes(k, bounds, n, rejected_by);
+
+				auto& out = buckets[b];
+
+				for (size_t s = 0; s < n; s++)
+				{
+					if (rejected_by[s] == m_count)
+						out.push_back(survivors[s]);
+					else if (plane_cache)
+						plane_cache[survivors[s]] = rejected_by[s];
+				}
+			}
+		});
+
+		size_t total = first;
+		for (const auto& bucket : buckets)
+			total += bucket.size();
+
+		visible.reserve(total);
+		for (const auto& bucket : buckets)
+			visible.insert(visible.end(), bucket.begin(), bucket.end());
+	}
+
+private:
+	T m_nx[k_max_planes] = {}, m_ny[k_max_planes] = {}, m_nz[k_max_planes] = {}, m_d[k_max_planes] = {};
+	size_t m_count = 0;
+};
+
+} // namespace detail
+
+//
+// type declarations
+//
+
+using Plane = detail::plane<float>;
+using Frustum = detail::frustum<float>;
+
+template<typename T> using PlaneT = detail::plane<T>;
+template<typename T> using FrustumT = detail::frustum<T>;
+
+#endif // CULLING_CLASS_H
@@ -0,0 +1,245 @@
+//
+// distance.h -- all-pairs squared distance kernels over vector_3d sets
+//
+
+#ifndef DISTANCE_CLASS_H
+#define DISTANCE_CLASS_H
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "vector.h"
+#include "parallel.h"
+
+namespace detail
+{
+
+//
+// set of points prepared for all-pairs queries. coordinates are kept as
+// separate streams together with the squared length of every point, so the
+// squared distance can be computed as
+//
+//	|a - b|^2 = |a|^2 + |b|^2 - 2 * a.Dot(b)
+//
+// which is a multiply-add chain over unit-stride streams. note that the
+// expanded form loses precision for points that are very close compared to
+// their distance from the origin, results are clamped to zero.
+//
+template <VectorType T> requires(std::is_floating_point_v<T>)
+class point_set
+{
+public:
+	// columns of the other set processed at once, four streams of this size
+	// stay resident in L1 while a block of rows is swept over them
+	static constexpr size_t k_tile = 1024;
+
+	// rows handed to one worker at once
+	static constexpr size_t k_grain = 64;
+
+	struct pair_t
+	{
+		uint32_t i, j;
+		T dist_sqr;
+	};
+
+	//
+	// Construction and destruction
+	//
+
+	point_set() noexcept = default;
+
+	point_set(const vector_3d<T>* points, size_t count)
+	{
+		Assign(points, count);
+	}
+
+	inline void Assign(const vector_3d<T>* points, size_t count)
+	{
+		m_x.resize(count);
+		m_y.resize(count);
+		m_z.resize(count);
+		m_norm.resize(count);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			m_x[i] = points[i].x;
+			m_y[i] = points[i].y;
+			m_z[i] = points[i].z;
+			m_norm[i] = points[i].LengthSqr();
+		}
+	}
+
+	inline size_t Size() const noexcept
+	{
+		return m_x.size();
+	}
+
+	inline vector_3d<T> GetPoint(size_t i) const noexcept
+	{
+		return { m_x[i], m_y[i], m_z[i] };
+	}
+
+	//
+	// Queries, rows are points of this set and columns points of 'other'
+	//
+
+	// writes full Size() x other.Size() row-major matrix of squared distances
+	inline void DistanceSqrMatrix(const point_set& other, T* out) const
+	{
+		const size_t cols = other.Size();
+
+		parallel_for(Size(), k_grain, [&](size_t begin, size_t end)
+		{
+			for (size_t tile = 0; tile < cols; tile += k_tile)
+			{
+				const size_t tile_end = std::min(tile + k_tile, cols);
+
+				for (size_t i = begin; i < end; i++)
+					RowTile(other, i, tile, tile_end, out + i * cols + tile);
+			}
+		});
+	}
+
+	// collects all pairs closer than 'radius' (pairs exactly at the radius are
+	// not included, as in spatial_hash), ordered by row and column. the matrix
+	// is never materialized, only one tile of a row at a time. indices are
+	// stored as uint32_t, both sets must hold at most UINT32_MAX points.
+	inline void FindWithin(const point_set& other, T radius, std::vector<pair_t>& out) const
+	{
+		const size_t rows = Size(), cols = other.Size();
+		const T radius_sqr = radius * radius;
+
+		assert(rows <= std::numeric_limits<uint32_t>::max() && cols <= std::numeric_limits<uint32_t>::max());
+
+		// one bucket per chunk of rows keeps the output order deterministic
+		std::vector<std::vector<pair_t>> buckets((rows + k_grain - 1) / k_grain);
+
+		parallel_for(rows, k_grain, [&](size_t begin, size_t end)
+		{
+			auto& bucket = buckets[begin / k_grain];
+			T scratch[k_tile];
+
+			// the whole block of rows is swept over one tile, as in
+			// DistanceSqrMatrix, so the pairs come out ordered by tile
+			for (size_t tile = 0; tile < cols; tile += k_tile)
+			{
+				const size_t tile_end = std::min(tile + k_tile, cols);
+
+				for (size_t i = begin; i < end; i++)
+				{
+					RowTile(other, i, tile, tile_end, scratch);
+
+					for (size_t j = tile; j < tile_end; j++)
+					{
+						if (scratch[j - tile] < radius_sqr)
+							bucket.push_back({ static_cast<uint32_t>(i), static_cast<uint32_t>(j), scratch[j - tile] });
+					}
+				}
+			}
+
+			// columns of a row are already ascending across the tiles
+			std::stable_sort(bucket.begin(), bucket.end(), [](const pair_t& a, const pair_t& b)
+			{
+				return a.i < b.i;
+			});
+		});
+
+		out.clear();
+		for (const auto& bucket : buckets)
+			out.insert(out.end(), bucket.begin(), bucket.end());
+	}
+
+	// k nearest points of 'other' for every point of this set, sorted from the
+	// closest. writes Size() * k entries, missing ones are UINT32_MAX / infinity.
+	// 'other' must hold at most UINT32_MAX points.
+	inline void FindNearest(const point_set& other, size_t k, uint32_t* indices, T* dist_sqr) const
+	{
+		if (k == 0)
+			return;
+
+		const size_t cols = other.Size();
+
+		assert(cols <= std::numeric_limits<uint32_t>::max());
+
+		parallel_for(Size(), k_grain, [&](size_t begin, size_t end)
+		{
+			T scratch[k_tile];
+
+			std::fill(indices + begin * k, indices + end * k, std::numeric_limits<uint32_t>::max());
+			std::fill(dist_sqr + begin * k, dist_sqr + end * k, std::numeric_limits<T>::infinity());
+
+			// the whole block of rows is swept over one tile, as in
+			// DistanceSqrMatrix, the k best of every row carry over
+			for (size_t tile = 0; tile < cols; tile += k_tile)
+			{
+				const size_t tile_end = std::min(tile + k_tile, cols);
+
+				for (size_t i = begin; i < end; i++)
+				{
+					uint32_t* best_i = indices + i * k;
+					T* best_d = dist_sqr + i * k;
+
+					RowTile(other, i, tile, tile_end, scratch);
+
+					for (size_t j = tile; j < tile_end; j++)
+					{
+						const T d = scratch[j - tile];
+						if (d >= best_d[k - 1])
+							continue;
+
+						// insertion into the sorted list of k best
+						size_t pos = k - 1;
+						while (pos > 0 && best_d[pos - 1] > d)
+						{
+							best_d[pos] = best_d[pos - 1];
+							best_i[pos] = best_i[pos - 1];
+							pos--;
+						}
+
+						best_d[pos] = d;
+						best_i[pos] = static_cast<uint32_t>(j);
+					}
+				}
+			}
+		});
+	}
+
+private:
+	// squared distances from row i to columns [begin, end) of 'other'
+	inline void RowTile(const point_set& other, size_t i, size_t begin, size_t end, T* __restrict out) const noexcept
+	{
+		const T ax = T(-2) * m_x[i], ay = T(-2) * m_y[i], az = T(-2) * m_z[i], an = m_norm[i];
+
+		const T* __restrict bx = other.m_x.data();
+		const T* __restrict by = other.m_y.data();
+		const T* __restrict bz = other.m_z.data();
+		const T* __restrict bn = other.m_norm.data();
+
+		for (size_t j = begin; j < end; j++)
+		{
+			const T d = vector_fma(az, bz[j], vector_fma(ay, by[j], vector_fma(ax, bx[j], an + bn[j])));
+			out[j - begin] = d > T(0) ? d : T(0);
+		}
+	}
+
+private:
+	std::vector<T> m_x, m_y, m_z, m_norm;
+};
+
+} // namespace detail
+
+//
+// type declarations
+//
+
+using PointSet = detail::point_set<float>;
+
+template<typename T> using PointSetT = detail::point_set<T>;
+
+#endif // DISTANCE_CLASS_H
@@ -0,0 +1,424 @@
+//
+// image.h -- image buffer with row aligned storage
+//
+
+#ifndef IMAGE_CLASS_H
+#define IMAGE_CLASS_H
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "color.h"
+#include "parallel.h"
+
+namespace detail
+{
+
+//
+// two dimensional array of pixels. every row starts on a k_alignment byte
+// boundary, so rows can be processed with aligned vector loads, stride() is
+// the distance between rows in pixels.
+//
+template<typename P> requires(std::is_trivially_copyable_v<P>)
+class image
+{
+public:
+	static constexpr size_t k_alignment = 64;
+
+	// rows handed to one worker at once
+	static constexpr size_t k_grain_rows = 16;
+
+	//
+	// Construction and destruction
+	//
+
+	image() noexcept = default;
+
+	image(uint32_t _width, uint32_t _height)
+	{
+		allocate(_width, _height);
+	}
+
+	image(const image& other)
+	{
+		*this = other;
+	}
+
+	image(image&& other) noexcept
+	{
+		*this = std::move(other);
+	}
+
+	image& operator=(const image& other)
+	{
+		if (this != &other)
+		{
+			allocate(other.m_width, other.m_height);
+			for (uint32_t y = 0; y < m_height; y++)
+				std::memcpy(row(y), other.row(y), m_width * sizeof(P));
+		}
+
+		return *this;
+	}
+
+	image& operator=(image&& other) noexcept
+	{
+		m_pixels = std::move(other.m_pixels);
+		m_width = std::exchange(other.m_width, 0);
+		m_height = std::exchange(other.m_height, 0);
+		m_stride = std::exchange(other.m_stride, 0);
+
+		return *this;
+	}
+
+	//
+	// helpers
+	//
+
+	constexpr inline uint32_t width() const noexcept
+	{
+		return m_width;
+	}
+
+	constexpr inline uint32_t height() const noexcept
+	{
+		return m_height;
+	}
+
+	// distance between rows in pixels
+	constexpr inline size_t stride() const noexcept
+	{
+		return m_stride;
+	}
+
+	constexpr inline bool is_empty() const noexcept
+	{
+		return m_width == 0 || m_height == 0;
+	}
+
+	inline P* row(uint32_t y) noexcept
+	{
+		return m_pixels.get() + y * m_stride;
+	}
+
+	inline const P* row(uint32_t y) const noexcept
+	{
+		return m_pixels.get() + y * m_stride;
+	}
+
+	inline P& at(uint32_t x, uint32_t y) noexcept
+	{
+		return row(y)[x];
+	}
+
+	inline const P& at(uint32_t x, uint32_t y) const noexcept
+	{
+		return row(y)[x];
+	}
+
+	// reallocates the image, contents are undefined afterwards
+	inline void allocate(uint32_t _width, uint32_t _height)
+	{
+		constexpr size_t per_line = k_alignment % sizeof(P) == 0 ? k_alignment / sizeof(P) : 1;
+
+		const size_t stride = (static_cast<size_t>(_width) + per_line - 1) / per_line * per_line;
+		const size_t bytes = stride * _height * sizeof(P);
+
+		m_pixels.reset(bytes ? static_cast<P*>(::operator new(bytes, std::align_val_t(k_alignment))) : nullptr);
+		m_width = _width;
+		m_height = _height;
+		m_stride = stride;
+	}
+
+	//
+	// fill and copy
+	//
+
+	inline void fill(const P& value)
+	{
+		fill_rect(0, 0, m_width, m_height, value);
+	}
+
+	// rectangle is clipped to the image
+	inline void fill_rect(int32_t x, int32_t y, int32_t w, int32_t h, const P& value)
+	{
+		if (!clip(x, y, w, h, m_width, m_height))
+			return;
+
+		for_rows(static_cast<uint32_t>(h), [&](uint32_t r)
+		{
+			std::fill_n(row(static_cast<uint32_t>(y) + r) + x, w, value);
+		});
+	}
+
+	// copies w x h pixels from src at (src_x, src_y) to (dst_x, dst_y), the
+	// rectangle is clipped against both images. src may be this image, in
+	// which case overlapping rectangles are handled.
+	inline void blit(const image& src, int32_t src_x, int32_t src_y, int32_t w, int32_t h, int32_t dst_x, int32_t dst_y)
+	{
+		// clip against source, then against destination, moving both origins
+		int32_t sx = src_x, sy = src_y;
+		if (!clip(sx, sy, w, h, src.m_width, src.m_height))
+			return;
+
+		dst_x += sx - src_x;
+		dst_y += sy - src_y;
+
+		int32_t dx = dst_x, dy = dst_y;
+		if (!clip(dx, dy, w, h, m_width, m_height))
+			return;
+
+		sx += dx - dst_x;
+		sy += dy - dst_y;
+
+		// overlapping copy within one image has to go against the direction of
+		// the move, so rows are copied serially
+		if (&src == this)
+		{
+			const bool down = dy > sy;
+
+			for (int32_t r = 0; r < h; r++)
+			{
+				const int32_t i = down ? h - 1 - r : r;
+				std::memmove(row(dy + i) + dx, src.row(sy + i) + sx, w * sizeof(P));
+			}
+
+			return;
+		}
+
+		for_rows(static_cast<uint32_t>(h), [&](uint32_t r)
+		{
+			std::memcpy(row(dy + r) + dx, src.row(sy + r) + sx, w * sizeof(P));
+		});
+	}
+
+	//
+	// resampling into 'dst', which keeps its own size. only available for
+	// 8-bit rgba pixels, channels are averaged in integer arithmetic.
+	//
+
+	// box filter, every destination pixel is the average of the source pixels
+	// it covers. meant for downscaling.
+	inline void resize_box(image& dst) const requires(std::is_same_v<P, color255<uint8_t>>)
+	{
+		if (is_empty() || dst.is_empty())
+			return;
+
+		// source span of every destination column
+		std::vector<uint32_t> x0(dst.m_width), x1(dst.m_width);
+		for (uint32_t x = 0; x < dst.m_width; x++)
+		{
+			x0[x] = static_cast<uint32_t>(static_cast<uint64_t>(x) * m_width / dst.m_width);
+			x1[x] = std::max(x0[x] + 1, static_cast<uint32_t>(static_cast<uint64_t>(x + 1) * m_width / dst.m_width));
+		}
+
+		// column sums of one destination row take at most this many source rows,
+		// 32 bits are enough for them unless a single row covers more than
+		// 2^32 / 255 source rows
+		const uint64_t span = (static_cast<uint64_t>(m_height) + dst.m_height - 1) / dst.m_height;
+
+		if (span <= std::numeric_limits<uint32_t>::max() / 255)
+			resize_box_rows<uint32_t>(dst, x0, x1);
+		else
+			resize_box_rows<uint64_t>(dst, x0, x1);
+	}
+
+	// bilinear filter with pixel centers aligned, 8-bit fractional weights.
+	// the two source rows are blended first over whole rows, the columns then
+	// only pick from that blend, which gives the same integer result.
+	inline void resize_bilinear(image& dst) const requires(std::is_same_v<P, color255<uint8_t>>)
+	{
+		if (is_empty() || dst.is_empty())
+			return;
+
+		struct tap_t
+		{
+			uint32_t i0, i1, w;
+		};
+
+		auto taps = [](uint32_t src_size, uint32_t dst_size)
+		{
+			std::vector<tap_t> out(dst_size);
+
+			for (uint32_t i = 0; i < dst_size; i++)
+			{
+				const double s = std::clamp((i + 0.5) * src_size / dst_size - 0.5, 0.0, static_cast<double>(src_size - 1));
+				const uint32_t i0 = static_cast<uint32_t>(s);
+
+				out[i] = { i0, std::min(i0 + 1, src_size - 1), static_cast<uint32_t>((s - i0) * 256.0 + 0.5) };
+			}
+
+			return out;
+		};
+
+		const auto tx = taps(m_width, dst.m_width);
+		const auto ty = taps(m_height, dst.m_height);
+
+		const size_t channels = static_cast<size_t>(m_width) * 4;
+
+		dst.for_row_ranges(dst.m_height, [&](uint32_t begin, uint32_t end)
+		{
+			// vertical blend of the source rows, at most 255 * 256
+			std::vector<uint16_t> blend(channels);
+
+			for (uint32_t y = begin; y < end; y++)
+			{
+				blend_channels(reinterpret_cast<const uint8_t*>(row(ty[y].i0)), reinterpret_cast<const uint8_t*>(row(ty[y].i1)),
+							   static_cast<uint16_t>(ty[y].w), blend.data(), channels);
+
+				P* out = dst.row(y);
+				for (uint32_t x = 0; x < dst.m_width; x++)
+				{
+					const uint16_t* left = blend.data() + tx[x].i0 * size_t(4);
+					const uint16_t* right = blend.data() + tx[x].i1 * size_t(4);
+					const uint32_t wx = tx[x].w;
+
+					uint8_t c[4];
+					for (size_t k = 0; k < 4; k++)
+						c[k] = static_cast<uint8_t>((left[k] * (256 - wx) + right[k] * wx + 32768) >> 16);
+
+					out[x] = P(c[0], c[1], c[2], c[3]);
+				}
+			}
+		});
+	}
+
+private:
+	struct aligned_delete
+	{
+		inline void operator()(P* p) const noexcept
+		{
+			::operator delete(p, std::align_val_t(k_alignment));
+		}
+	};
+
+	// clips rectangle to [0, width) x [0, height), false when nothing is left
+	static inline bool clip(int32_t& x, int32_t& y, int32_t& w, int32_t& h, uint32_t width, uint32_t height) noexcept
+	{
+		if (x < 0) { w += x; x = 0; }
+		if (y < 0) { h += y; y = 0; }
+
+		w = std::min<int32_t>(w, static_cast<int32_t>(width) - x);
+		h = std::min<int32_t>(h, static_cast<int32_t>(height) - y);
+
+		return w > 0 && h > 0;
+	}
+
+	// calls fn(row) for rows [0, count), large images are split over workers
+	template<typename Fn>
+	inline void for_rows(uint32_t count, Fn&& fn) const
+	{
+		for_row_ranges(count, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t r = begin; r < end; r++)
+				fn(r);
+		});
+	}
+
+	// calls fn(begin, end) for ranges of rows within [0, count), so that
+	// scratch memory can be set up once per range
+	template<typename Fn>
+	inline void for_row_ranges(uint32_t count, Fn&& fn) const
+	{
+		// not worth waking up threads for small images
+		const size_t grain = static_cast<size_t>(m_width) * count < 256 * 1024 ? count : k_grain_rows;
+
+		parallel_for(count, grain, [&](size_t begin, size_t end)
+		{
+			fn(static_cast<uint32_t>(begin), static_cast<uint32_t>(end));
+		});
+	}
+
+	// rows of resize_box with column sums of type S, x0 and x1 are the source
+	// span of every destination column
+	template<typename S>
+	inline void resize_box_rows(image& dst, const std::vector<uint32_t>& x0, const std::vector<uint32_t>& x1) const
+	{
+		const size_t channels = static_cast<size_t>(m_width) * 4;
+
+		dst.for_row_ranges(dst.m_height, [&](uint32_t begin, uint32_t end)
+		{
+			// column sums of the covered source rows, per channel in memory order
+			std::vector<S> sums(channels);
+
+			for (uint32_t y = begin; y < end; y++)
+			{
+				const uint32_t y0 = static_cast<uint32_t>(static_cast<uint64_t>(y) * m_height / dst.m_height);
+				const uint32_t y1 = std::max(y0 + 1, static_cast<uint32_t>(static_cast<uint64_t>(y + 1) * m_height / dst.m_height));
+
+				std::fill(sums.begin(), sums.end(), S(0));
+				for (uint32_t sy = y0; sy < y1; sy++)
+					add_channels(reinterpret_cast<const uint8_t*>(row(sy)), sums.data(), channels);
+
+				P* out = dst.row(y);
+				for (uint32_t x = 0; x < dst.m_width; x++)
+				{
+					// 64 bits, a destination pixel may cover more than 2^32 / 255
+					// source pixels
+					uint64_t acc[4] = {};
+					for (size_t i = x0[x] * size_t(4); i < x1[x] * size_t(4); i += 4)
+					{
+						for (size_t c = 0; c < 4; c++)
+							acc[c] += sums[i + c];
+					}
+
+					// (acc + n / 2) / n rounded down. done in double, which is exact
+					// for any image that fits in memory: the quotient is at least 1 / n
+					// away from the next integer, far more than its rounding error.
+					const uint64_t n = static_cast<uint64_t>(x1[x] - x0[x]) * (y1 - y0);
+					const double dn = static_cast<double>(n);
+
+					uint8_t c[4];
+					for (size_t k = 0; k < 4; k++)
+						c[k] = static_cast<uint8_t>(static_cast<double>(acc[k] + n / 2) / dn);
+
+					out[x] = P(c[0], c[1], c[2], c[3]);
+				}
+			}
+		});
+	}
+
+	// sums[i] += src[i]
+	template<typename S>
+	static inline void add_channels(const uint8_t* __restrict src, S* __restrict sums, size_t count) noexcept
+	{
+		for (size_t i = 0; i < count; i++)
+			sums[i] += src[i];
+	}
+
+	// out[i] = top[i] * (256 - w) + bottom[i] * w
+	static inline void blend_channels(const uint8_t* __restrict top, const uint8_t* __restrict bottom, uint16_t w,
+									  uint16_t* __restrict out, size_t count) noexcept
+	{
+		const uint16_t w0 = static_cast<uint16_t>(256 - w);
+
+		for (size_t i = 0; i < count; i++)
+			out[i] = static_cast<uint16_t>(top[i] * w0 + bottom[i] * w);
+	}
+
+private:
+	std::unique_ptr<P, aligned_delete> m_pixels;
+	uint32_t m_width = 0, m_height = 0;
+	size_t m_stride = 0;
+};
+
+} // namespace detail
+
+//
+// type declarations
+//
+
+using CImage = detail::image<detail::color255<uint8_t>>;
+
+template<typename P> using CImageT = detail::image<P>;
+
+#endif // IMAGE_CLASS_H
@@ -0,0 +1,203 @@
+//
+// instrument.h -- opt-in call counters for vector and color helpers
+//
+
+#ifndef INSTRUMENT_CLASS_H
+#define INSTRUMENT_CLASS_H
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+#ifdef VECTORCLASS_INSTRUMENT
+#include <atomic>
+#include <mutex>
+#include <vector>
+#endif
+
+namespace detail
+{
+
+//
+// per-operation call counters. compiled only with VECTORCLASS_INSTRUMENT
+// defined, otherwise VECTORCLASS_COUNT expands to nothing and the snapshot
+// is always empty.
+//
+// every thread increments its own block of counters without any locking,
+// Snapshot() sums the blocks of all live threads plus the totals left behind
+// by threads that already exited.
+//
+class instrumentation
+{
+public:
+	enum counter_t : uint32_t
+	{
+		k_vector_length,
+		k_vector_length_2d,
+		k_vector_distance,
+		k_vector_distance_2d,
+		k_vector_normalize,
+		k_vector_normalize_in_place,
+		k_vector2d_length,
+		k_vector2d_distance,
+		k_vector2d_normalize,
+		k_color_as_u32,
+		k_color255_as_u32,
+
+		k_counter_count
+	};
+
+#ifdef VECTORCLASS_INSTRUMENT
+	static constexpr bool k_enabled = true;
+#else
+	static constexpr bool k_enabled = false;
+#endif
+
+	struct snapshot_t
+	{
+		uint64_t counts[k_counter_count] = {};
+
+		inline uint64_t operator[](counter_t c) const noexcept
+		{
+			return counts[c];
+		}
+
+		inline static const char* Name(counter_t c) noexcept
+		{
+			constexpr const char* names[k_counter_count] =
+			{
+				"vector_3d::Length",
+				"vector_3d::Length2D",
+				"vector_3d::Distance",
+				"vector_3d::Distance2D",
+				"vector_3d::Normalize",
+				"vector_3d::NormalizeInPlace",
+				"vector_2d::Length",
+				"vector_2d::Distance",
+				"vector_2d::Normalize",
+				"color::as_u32",
+				"color255::as_u32",
+			};
+
+			return c < k_counter_count ? names[c] : "";
+		}
+	};
+
+#ifdef VECTORCLASS_INSTRUMENT
+	inline static void Add(counter_t c) noexcept
+	{
+		// only the owning thread writes its block, plain load and store is
+		// enough and avoids a locked instruction per call
+		auto& counter = Local().counts[c];
+		counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	// totals since start or since the last Reset()
+	inline static snapshot_t Snapshot()
+	{
+		auto& reg = Registry();
+		std::lock_guard<std::mutex> lock(reg.lock);
+
+		snapshot_t out;
+		for (uint32_t i = 0; i < k_counter_count; i++)
+		{
+			uint64_t total = reg.retired[i];
+			for (const auto* block : reg.live)
+				total += block->counts[i].load(std::memory_order_relaxed);
+
+			out.counts[i] = total - reg.baseline[i];
+		}
+
+		return out;
+	}
+
+	// other threads keep counting into their blocks, so reset only moves the
+	// baseline instead of clearing them
+	inline static void Reset()
+	{
+		const snapshot_t now = Snapshot();
+
+		auto& reg = Registry();
+		std::lock_guard<std::mutex> lock(reg.lock);
+
+		for (uint32_t i = 0; i < k_counter_count; i++)
+			reg.baseline[i] += now.counts[i];
+	}
+#else
+	inline static snapshot_t Snapshot() noexcept
+	{
+		return {};
+	}
+
+	inline static void Reset() noexcept
+	{
+	}
+#endif
+
+#ifdef VECTORCLASS_INSTRUMENT
+private:
+	struct block_t
+	{
+		std::atomic<uint64_t> counts[k_counter_count] = {};
+
+		block_t()
+		{
+			auto& reg = Registry();
+			std::lock_guard<std::mutex> lock(reg.lock);
+			reg.live.push_back(this);
+		}
+
+		~block_t()
+		{
+			auto& reg = Registry();
+			std::lock_guard<std::mutex> lock(reg.lock);
+
+			for (uint32_t i = 0; i < k_counter_count; i++)
+				reg.retired[i] += counts[i].load(std::memory_order_relaxed);
+
+			std::erase(reg.live, this);
+		}
+	};
+
+	struct registry_t
+	{
+		std::mutex lock;
+		std::vector<block_t*> live;
+		uint64_t retired[k_counter_count] = {};
+		uint64_t baseline[k_counter_count] = {};
+	};
+
+	inline static registry_t& Registry()
+	{
+		static registry_t reg;
+		return reg;
+	}
+
+	inline static block_t& Local()
+	{
+		thread_local block_t block;
+		return block;
+	}
+#endif
+};
+
+} // namespace detail
+
+//
+// counting hook used inside of the helpers, skipped during constant evaluation
+//
+
+#ifdef VECTORCLASS_INSTRUMENT
+#define VECTORCLASS_COUNT(counter) \
+	(std::is_constant_evaluated() ? (void)0 : ::detail::instrumentation::Add(::detail::instrumentation::counter))
+#else
+#define VECTORCLASS_COUNT(counter) ((void)0)
+#endif
+
+//
+// type declarations
+//
+
+using Instrumentation = detail::instrumentation;
+
+#endif // INSTRUMENT_CLASS_H
@@ -0,0 +1,179 @@
+//
+// mesh_normals.h -- smooth vertex normals of indexed triangle meshes
+//
+
+#ifndef MESH_NORMALS_CLASS_H
+#define MESH_NORMALS_CLASS_H
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "vector.h"
+#include "parallel.h"
+
+namespace detail
+{
+
+//
+// computes area weighted vertex normals of a triangle mesh, where every
+// triangle is three indices into the vertex positions.
+//
+// instead of scattering face normals into their vertices, which needs atomics
+// or locking when done in parallel, the topology is inverted once into a list
+// of incident triangles per vertex. every vertex then gathers its own sum, so
+// vertices can be split among workers freely and the summation order is
+// fixed. deformed meshes keep their topology, so only Compute() runs per frame.
+//
+template <VectorType T> requires(std::is_floating_point_v<T>)
+class mesh_normals
+{
+public:
+	// triangles or vertices handed to one worker at once
+	static constexpr size_t k_grain = 16 * 1024;
+
+	//
+	// Construction and destruction
+	//
+
+	mesh_normals() noexcept = default;
+
+	mesh_normals(const uint32_t* indices, size_t triangle_count, size_t vertex_count)
+	{
+		SetTopology(indices, triangle_count, vertex_count);
+	}
+
+	// indices out of range of vertex_count are not allowed
+	inline void SetTopology(const uint32_t* indices, size_t triangle_count, size_t vertex_count)
+	{
+		m_indices.assign(indices, indices + triangle_count * 3);
+		m_vertex_count = vertex_count;
+
+		// incident triangles of vertex v are m_faces[m_start[v] .. m_start[v + 1]),
+		// in increasing triangle order
+		m_start.assign(vertex_count + 1, 0);
+		for (size_t i = 0; i < m_indices.size(); i++)
+			m_start[m_indices[i] + 1]++;
+
+		for (size_t v = 0; v < vertex_count; v++)
+			m_start[v + 1] += m_start[v];
+
+		std::vector<uint32_t> fill(m_start.begin(), m_start.end() - 1);
+
+		m_faces.resize(m_indices.size());
+		for (size_t i = 0; i < m_indices.size(); i++)
+			m_faces[fill[m_indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+		m_fx.resize(triangle_count);
+		m_fy.resize(triangle_count);
+		m_fz.resize(triangle_count);
+	}
+
+	inline size_t TriangleCount() const noexcept
+	{
+		return m_fx.size();
+	}
+
+	inline size_t VertexCount() const noexcept
+	{
+		return m_vertex_count;
+	}
+
+	// unnormalized normal of triangle i from the last Compute(), its length is
+	// twice the triangle area
+	inline vector_3d<T> GetFaceNormal(size_t i) const noexcept
+	{
+		return { m_fx[i], m_fy[i], m_fz[i] };
+	}
+
+	//
+	// Computation
+	//
+
+	// writes VertexCount() unit normals, vertices without area get zero
+	inline void Compute(const vector_3d<T>* positions, vector_3d<T>* normals)
+	{
+		ComputeFaceNormals(positions);
+
+		parallel_for(m_vertex_count, k_grain, [&](size_t begin, size_t end)
+		{
+			const uint32_t* __restrict faces = m_faces.data();
+			const T* __restrict fx = m_fx.data();
+			const T* __restrict fy = m_fy.data();
+			const T* __restrict fz = m_fz.data();
+
+			for (size_t v = begin; v < end; v++)
+			{
+				T x = T(0), y = T(0), z = T(0);
+
+				for (uint32_t k = m_start[v]; k < m_start[v + 1]; k++)
+				{
+					x += fx[faces[k]];
+					y += fy[faces[k]];
+					z += fz[faces[k]];
+				}
+
+				const T len_sqr = x * x + y * y + z * z;
+				const T inv = len_sqr > T(0) ? T(1) / static_cast<T>(vector_sqrt(len_sqr)) : T(0);
+
+				normals[v] = vector_3d<T>(x * inv, y * inv, z * inv);
+			}
+		});
+	}
+
+private:
+	// cross products of the triangle edges into the face normal streams. the
+	// loop stays scalar: its cost is in the indexed loads of the corners, and
+	// gathering them into SoA blocks first so that the cross products
+	// vectorize was measured slower, the gathers and the extra pass over the
+	// blocks cost more than the arithmetic they save.
+	inline void ComputeFaceNormals(const vector_3d<T>* positions)
+	{
+		parallel_for(TriangleCount(), k_grain, [&](size_t begin, size_t end)
+		{
+			const uint32_t* __restrict idx = m_indices.data();
+			T* __restrict fx = m_fx.data();
+			T* __restrict fy = m_fy.data();
+			T* __restrict fz = m_fz.data();
+
+			for (size_t f = begin; f < end; f++)
+			{
+				const vector_3d<T>& a = positions[idx[f * 3 + 0]];
+				const vector_3d<T>& b = positions[idx[f * 3 + 1]];
+				const vector_3d<T>& c = positions[idx[f * 3 + 2]];
+
+				const T ux = b.x - a.x, uy = b.y - a.y, uz = b.z - a.z;
+				const T vx = c.x - a.x, vy = c.y - a.y, vz = c.z - a.z;
+
+				fx[f] = vector_diff_of_products(uy, vz, uz, vy);
+				fy[f] = vector_diff_of_products(uz, vx, ux, vz);
+				fz[f] = vector_diff_of_products(ux, vy, uy, vx);
+			}
+		});
+	}
+
+private:
+	std::vector<uint32_t> m_indices;
+	size_t m_vertex_count = 0;
+
+	// vertex to triangle adjacency
+	std::vector<uint32_t> m_start, m_faces;
+
+	// face normals of the last Compute()
+	std::vector<T> m_fx, m_fy, m_fz;
+};
+
+} // namespace detail
+
+//
+// type declarations
+//
+
+using MeshNormals = detail::mesh_normals<float>;
+
+template<typename T> using MeshNormalsT = detail::mesh_normals<T>;
+
+#endif // MESH_NORMALS_CLASS_H
@@ -0,0 +1,389 @@
+//
+// morton.h -- z-order codes and spatial sorting of point sets
+//
+
+#ifndef MORTON_CLASS_H
+#define MORTON_CLASS_H
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+#include "vector.h"
+#include "parallel.h"
+#include "radix_sort.h"
+
+namespace detail
+{
+
+//
+// morton codes interleave the bits of quantized coordinates, so that points
+// close to each other in space mostly get close codes. sorting points by
+// their code gives an order that walks space in a z-shaped curve.
+//
+// code widths:
+//
+//	Encode32(vector_3d):	30 bits, 10 per axis
+//	Encode64(vector_3d):	63 bits, 21 per axis
+//	Encode32(vector_2d):	32 bits, 16 per axis
+//	Encode64(vector_2d):	64 bits, 32 per axis
+//
+// single values use pdep when compiled with BMI2. the batch encoders always
+// use shift and mask spreading, which the compiler vectorizes over points.
+//
+class morton
+{
+public:
+	// points handed to one worker at once
+	static constexpr size_t k_grain = 64 * 1024;
+
+	//
+	// integer interleaving, x takes the lowest bit
+	//
+
+	static constexpr inline uint32_t Interleave3(uint32_t x, uint32_t y, uint32_t z) noexcept
+	{
+#if defined(__BMI2__)
+		if (!std::is_constant_evaluated())
+			return _pdep_u32(x, 0x09249249u) | _pdep_u32(y, 0x12492492u) | _pdep_u32(z, 0x24924924u);
+#endif
+
+		return Spread3(x) | Spread3(y) << 1 | Spread3(z) << 2;
+	}
+
+	static constexpr inline uint64_t Interleave3(uint64_t x, uint64_t y, uint64_t z) noexcept
+	{
+#if defined(__BMI2__) && defined(__x86_64__)
+		if (!std::is_constant_evaluated())
+			return _pdep_u64(x, 0x1249249249249249ull) | _pdep_u64(y, 0x2492492492492492ull) | _pdep_u64(z, 0x4924924924924924ull);
+#endif
+
+		return Spread3(x) | Spread3(y) << 1 | Spread3(z) << 2;
+	}
+
+	static constexpr inline uint32_t Interleave2(uint32_t x, uint32_t y) noexcept
+	{
+#if defined(__BMI2__)
+		if (!std::is_constant_evaluated())
+			return _pdep_u32(x, 0x55555555u) | _pdep_u32(y, 0xaaaaaaaau);
+#endif
+
+		return Spread2(x) | Spread2(y) << 1;
+	}
+
+	static constexpr inline uint64_t Interleave2(uint64_t x, uint64_t y) noexcept
+	{
+#if defined(__BMI2__) && defined(__x86_64__)
+		if (!std::is_constant_evaluated())
+			return _pdep_u64(x, 0x5555555555555555ull) | _pdep_u64(y, 0xaaaaaaaaaaaaaaaaull);
+#endif
+
+		return Spread2(x) | Spread2(y) << 1;
+	}
+
+	static constexpr inline void Deinterleave3(uint32_t code, uint32_t& x, uint32_t& y, uint32_t& z) noexcept
+	{
+		x = Compact3(code);
+		y = Compact3(code >> 1);
+		z = Compact3(code >> 2);
+	}
+
+	static constexpr inline void Deinterleave3(uint64_t code, uint64_t& x, uint64_t& y, uint64_t& z) noexcept
+	{
+		x = Compact3(code);
+		y = Compact3(code >> 1);
+		z = Compact3(code >> 2);
+	}
+
+	static constexpr inline void Deinterleave2(uint32_t code, uint32_t& x, uint32_t& y) noexcept
+	{
+		x = Compact2(code);
+		y = Compact2(code >> 1);
+	}
+
+	static constexpr inline void Deinterleave2(uint64_t code, uint64_t& x, uint64_t& y) noexcept
+	{
+		x = Compact2(code);
+		y = Compact2(code >> 1);
+	}
+
+	//
+	// batch encoding of points quantized into the box [mins, maxs], points
+	// outside of the box are clamped to it
+	//
+
+	template<typename T>
+	static inline void Encode32(const vector_3d<T>* points, size_t count, const vector_3d<T>& mins, const vector_3d<T>& maxs, uint32_t* codes)
+	{
+		Encode<uint32_t, 10>(points, count, mins, maxs, codes);
+	}
+
+	template<typename T>
+	static inline void Encode64(const vector_3d<T>* points, size_t count, const vector_3d<T>& mins, const vector_3d<T>& maxs, uint64_t* codes)
+	{
+		Encode<uint64_t, 21>(points, count, mins, maxs, codes);
+	}
+
+	template<typename T>
+	static inline void Encode32(const vector_2d<T>* points, size_t count, const vector_2d<T>& mins, const vector_2d<T>& maxs, uint32_t* codes)
+	{
+		Encode<uint32_t, 16>(points, count, mins, maxs, codes);
+	}
+
+	template<typename T>
+	static inline void Encode64(const vector_2d<T>* points, size_t count, const vector_2d<T>& mins, const vector_2d<T>& maxs, uint64_t* codes)
+	{
+		Encode<uint64_t, 32>(points, count, mins, maxs, codes);
+	}
+
+	//
+	// bounds and sorting
+	//
+
+	template<typename T>
+	static inline void Bounds(const vector_3d<T>* points, size_t count, vector_3d<T>& mins, vector_3d<T>& maxs) noexcept
+	{
+		mins = vector_3d<T>(std::numeric_limits<T>::max(), std::numeric_limits<T>::max(), std::numeric_limits<T>::max());
+		maxs = -mins;
+
+		for (size_t i = 0; i < count; i++)
+		{
+			mins = vector_3d<T>(std::min(mins.x, points[i].x), std::min(mins.y, points[i].y), std::min(mins.z, points[i].z));
+			maxs = vector_3d<T>(std::max(maxs.x, points[i].x), std::max(maxs.y, points[i].y), std::max(maxs.z, points[i].z));
+		}
+	}
+
+	template<typename T>
+	static inline void Bounds(const vector_2d<T>* points, size_t count, vector_2d<T>& mins, vector_2d<T>& maxs) noexcept
+	{
+		mins = vector_2d<T>(std::numeric_limits<T>::max(), std::numeric_limits<T>::max());
+		maxs = vector_2d<T>(-std::numeric_limits<T>::max(), -std::numeric_limits<T>::max());
+
+		for (size_t i = 0; i < count; i++)
+		{
+			mins = vector_2d<T>(std::min(mins.x, points[i].x), std::min(mins.y, points[i].y));
+			maxs = vector_2d<T>(std::max(maxs.x, points[i].x), std::max(maxs.y, points[i].y));
+		}
+	}
+
+	// reorders points along the z-curve over their bounds, the 32-bit codes
+	// are fine enough for cache locality and need only four sort passes
+	template<typename V>
+	static inline void Sort(V* points, size_t count)
+	{
+		Sort(points, count, static_cast<uint8_t*>(nullptr));
+	}
+
+	// same as above, payload[i] is moved along with points[i] when given
+	template<typename V, typename P>
+	static inline void Sort(V* points, size_t count, P* payload)
+	{
+		if (count < 2)
+			return;
+
+		V mins, maxs;
+		Bounds(points, count, mins, maxs);
+
+		std::vector<uint32_t> codes(count), order(count);
+		Encode32(points, count, mins, maxs, codes.data());
+
+		for (size_t i = 0; i < count; i++)
+			order[i] = static_cast<uint32_t>(i);
+
+		radix_sort(codes.data(), order.data(), count, CodeBits(points));
+
+		Permute(points, order.data(), count);
+		if (payload)
+			Permute(payload, order.data(), count);
+	}
+
+private:
+	// significant bits of the codes from Encode32
+	template<typename T>
+	static constexpr inline uint32_t CodeBits(const vector_3d<T>*) noexcept
+	{
+		return 30;
+	}
+
+	template<typename T>
+	static constexpr inline uint32_t CodeBits(const vector_2d<T>*) noexcept
+	{
+		return 32;
+	}
+
+	//
+	// bit spreading, inserts two or one zero bits after every input bit
+	//
+
+	static constexpr inline uint32_t Spread3(uint32_t v) noexcept
+	{
+		v &= 0x000003ffu;
+		v = (v | v << 16) & 0x030000ffu;
+		v = (v | v << 8) & 0x0300f00fu;
+		v = (v | v << 4) & 0x030c30c3u;
+		v = (v | v << 2) & 0x09249249u;
+		return v;
+	}
+
+	static constexpr inline uint64_t Spread3(uint64_t v) noexcept
+	{
+		v &= 0x00000000001fffffull;
+		v = (v | v << 32) & 0x001f00000000ffffull;
+		v = (v | v << 16) & 0x001f0000ff0000ffull;
+		v = (v | v << 8) & 0x100f00f00f00f00full;
+		v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+		v = (v | v << 2) & 0x1249249249249249ull;
+		return v;
+	}
+
+	static constexpr inline uint32_t Spread2(uint32_t v) noexcept
+	{
+		v &= 0x0000ffffu;
+		v = (v | v << 8) & 0x00ff00ffu;
+		v = (v | v << 4) & 0x0f0f0f0fu;
+		v = (v | v << 2) & 0x33333333u;
+		v = (v | v << 1) & 0x55555555u;
+		return v;
+	}
+
+	static constexpr inline uint64_t Spread2(uint64_t v) noexcept
+	{
+		v &= 0x00000000ffffffffull;
+		v = (v | v << 16) & 0x0000ffff0000ffffull;
+		v = (v | v << 8) & 0x00ff00ff00ff00ffull;
+		v = (v | v << 4) & 0x0f0f0f0f0f0f0f0full;
+		v = (v | v << 2) & 0x3333333333333333ull;
+		v = (v | v << 1) & 0x5555555555555555ull;
+		return v;
+	}
+
+	static constexpr inline uint32_t Compact3(uint32_t v) noexcept
+	{
+		v &= 0x09249249u;
+		v = (v | v >> 2) & 0x030c30c3u;
+		v = (v | v >> 4) & 0x0300f00fu;
+		v = (v | v >> 8) & 0x030000ffu;
+		v = (v | v >> 16) & 0x000003ffu;
+		return v;
+	}
+
+	static constexpr inline uint64_t Compact3(uint64_t v) noexcept
+	{
+		v &= 0x1249249249249249ull;
+		v = (v | v >> 2) & 0x10c30c30c30c30c3ull;
+		v = (v | v >> 4) & 0x100f00f00f00f00full;
+		v = (v | v >> 8) & 0x001f0000ff0000ffull;
+		v = (v | v >> 16) & 0x001f00000000ffffull;
+		v = (v | v >> 32) & 0x00000000001fffffull;
+		return v;
+	}
+
+	static constexpr inline uint32_t Compact2(uint32_t v) noexcept
+	{
+		v &= 0x55555555u;
+		v = (v | v >> 1) & 0x33333333u;
+		v = (v | v >> 2) & 0x0f0f0f0fu;
+		v = (v | v >> 4) & 0x00ff00ffu;
+		v = (v | v >> 8) & 0x0000ffffu;
+		return v;
+	}
+
+	static constexpr inline uint64_t Compact2(uint64_t v) noexcept
+	{
+		v &= 0x5555555555555555ull;
+		v = (v | v >> 1) & 0x3333333333333333ull;
+		v = (v | v >> 2) & 0x0f0f0f0f0f0f0f0full;
+		v = (v | v >> 4) & 0x00ff00ff00ff00ffull;
+		v = (v | v >> 8) & 0x0000ffff0000ffffull;
+		v = (v | v >> 16) & 0x00000000ffffffffull;
+		return v;
+	}
+
+	// cell index of 'v', 'top' is the largest value below the cell count so
+	// that the last cell is not rounded up past the range. NaN goes to the
+	// first cell.
+	template<typename K, typename T>
+	static inline K Quantize(T v, T lo, T scale, T top) noexcept
+	{
+		T q = (v - lo) * scale;
+		q = q > T(0) ? q : T(0);
+		q = q < top ? q : top;
+		return static_cast<K>(q);
+	}
+
+	template<typename K, uint32_t Bits, typename T>
+	static inline void Encode(const vector_3d<T>* points, size_t count, const vector_3d<T>& mins, const vector_3d<T>& maxs, K* codes)
+	{
+		const T cells = static_cast<T>(static_cast<double>(K(1) << Bits));
+		const vector_3d<T> extent = maxs - mins;
+
+		const T sx = extent.x > T(0) ? cells / extent.x : T(0);
+		const T sy = extent.y > T(0) ? cells / extent.y : T(0);
+		const T sz = extent.z > T(0) ? cells / extent.z : T(0);
+		const T top = std::nextafter(cells, T(0));
+
+		parallel_for(count, k_grain, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				const K x = Quantize<K>(points[i].x, mins.x, sx, top);
+				const K y = Quantize<K>(points[i].y, mins.y, sy, top);
+				const K z = Quantize<K>(points[i].z, mins.z, sz, top);
+				codes[i] = Spread3(x) | Spread3(y) << 1 | Spread3(z) << 2;
+			}
+		});
+	}
+
+	template<typename K, uint32_t Bits, typename T>
+	static inline void Encode(const vector_2d<T>* points, size_t count, const vector_2d<T>& mins, const vector_2d<T>& maxs, K* codes)
+	{
+		const T cells = static_cast<T>(static_cast<double>(uint64_t(1) << Bits));
+		const T ex = maxs.x - mins.x, ey = maxs.y - mins.y;
+
+		const T sx = ex > T(0) ? cells / ex : T(0);
+		const T sy = ey > T(0) ? cells / ey : T(0);
+		const T top = std::nextafter(cells, T(0));
+
+		parallel_for(count, k_grain, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				const K x = Quantize<K>(points[i].x, mins.x, sx, top);
+				const K y = Quantize<K>(points[i].y, mins.y, sy, top);
+				codes[i] = Spread2(x) | Spread2(y) << 1;
+			}
+		});
+	}
+
+	// items[i] = items[order[i]], through a scratch copy
+	template<typename P>
+	static inline void Permute(P* items, const uint32_t* order, size_t count)
+	{
+		std::vector<P> scratch(items, items + count);
+
+		parallel_for(count, k_grain, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				items[i] = scratch[order[i]];
+		});
+	}
+};
+
+} // namespace detail
+
+//
+// type declarations
+//
+
+using Morton = detail::morton;
+
+#endif // MORTON_CLASS_H
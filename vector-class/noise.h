@@ -0,0 +1,350 @@
+//
+// noise.h -- perlin and simplex gradient noise over vector_3d positions
+//
+
+#ifndef NOISE_CLASS_H
+#define NOISE_CLASS_H
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "vector.h"
+#include "parallel.h"
+
+namespace detail
+{
+
+//
+// improved perlin noise (2002) and simplex noise in three dimensions, both in
+// [-1, 1], and fractal sums of several octaves of either.
+//
+// the batch functions are loops over the scalar ones, which are written
+// without branches and forced inline, so the compiler vectorizes them: with
+// AVX2 that is 8 float positions per instruction, the permutation lookups
+// becoming gathers. as both paths execute the very same operations, a batch
+// gives bit for bit the results of calling the scalar functions one at a
+// time, with or without VECTORCLASS_FMA. a compiler that fuses multiply-adds
+// on its own (gcc on FMA targets) could in principle do so differently for
+// the two, -ffp-contract=off rules that out.
+//
+// positions have to stay within the range of int32_t.
+//
+template <VectorType T> requires(std::is_floating_point_v<T>)
+class gradient_noise
+{
+public:
+	enum kind_t
+	{
+		k_perlin,	// lattice noise, cheaper per sample
+		k_simplex,	// fewer directional artifacts, four corners instead of eight
+	};
+
+	// fractal sum of octaves, every one at 'lacunarity' times the frequency
+	// and 'gain' times the amplitude of the one before
+	struct fbm_t
+	{
+		kind_t kind = k_perlin;
+		int octaves = 5;
+		T lacunarity = T(2);
+		T gain = T(0.5);
+	};
+
+	// vectors converted to coordinate streams at once
+	static constexpr size_t k_block = 256;
+
+	// rows of a grid handed to one worker at once
+	static constexpr size_t k_grain = 16;
+
+	//
+	// Construction and destruction
+	//
+
+	explicit gradient_noise(uint64_t seed = 0) noexcept
+	{
+		Seed(seed);
+	}
+
+	// shuffles the permutation table, every seed gives a different field
+	inline void Seed(uint64_t seed) noexcept
+	{
+		for (int32_t i = 0; i < 256; i++)
+			m_perm[i] = i;
+
+		uint64_t state = seed;
+		for (int32_t i = 255; i > 0; i--)
+		{
+			// splitmix64
+			uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+			z ^= z >> 31;
+
+			std::swap(m_perm[i], m_perm[z % (i + 1)]);
+		}
+
+		// doubled, so that a lookup plus an offset of up to 255 stays inside
+		for (int32_t i = 0; i < 256; i++)
+			m_perm[256 + i] = m_perm[i];
+	}
+
+	//
+	// Single positions
+	//
+
+	VECTORCLASS_FORCEINLINE T Perlin(T x, T y, T z) const noexcept
+	{
+		const int32_t ix = Floor(x), iy = Floor(y), iz = Floor(z);
+
+		// position inside the cell
+		x -= static_cast<T>(ix);
+		y -= static_cast<T>(iy);
+		z -= static_cast<T>(iz);
+
+		const T u = Fade(x), v = Fade(y), w = Fade(z);
+
+		// hashes of the eight corners
+		const int32_t X = ix & 255, Y = iy & 255, Z = iz & 255;
+		const int32_t A = m_perm[X] + Y, AA = m_perm[A] + Z, AB = m_perm[A + 1] + Z;
+		const int32_t B = m_perm[X + 1] + Y, BA = m_perm[B] + Z, BB = m_perm[B + 1] + Z;
+
+		const T x1 = x - T(1), y1 = y - T(1), z1 = z - T(1);
+
+		return Lerp(w,
+			Lerp(v, Lerp(u, Grad(m_perm[AA], x, y, z), Grad(m_perm[BA], x1, y, z)),
+					Lerp(u, Grad(m_perm[AB], x, y1, z), Grad(m_perm[BB], x1, y1, z))),
+			Lerp(v, Lerp(u, Grad(m_perm[AA + 1], x, y, z1), Grad(m_perm[BA + 1], x1, y, z1)),
+					Lerp(u, Grad(m_perm[AB + 1], x, y1, z1), Grad(m_perm[BB + 1], x1, y1, z1))));
+	}
+
+	VECTORCLASS_FORCEINLINE T Simplex(T x, T y, T z) const noexcept
+	{
+		constexpr T F3 = T(1.0 / 3.0), G3 = T(1.0 / 6.0);
+
+		// skew into the cubic lattice to find the cell
+		const T s = (x + y + z) * F3;
+		const int32_t i = Floor(x + s), j = Floor(y + s), k = Floor(z + s);
+
+		// unskew back, first corner of the tetrahedron
+		const T t = static_cast<T>(i + j + k) * G3;
+		const T x0 = x - (static_cast<T>(i) - t);
+		const T y0 = y - (static_cast<T>(j) - t);
+		const T z0 = z - (static_cast<T>(k) - t);
+
+		// the order of the coordinates tells which of the six tetrahedra of
+		// the cube we are in, the second and third corners step along the
+		// largest and the two largest axes
+		const int32_t xy = x0 >= y0, yz = y0 >= z0, xz = x0 >= z0;
+
+		const int32_t i1 = xy & xz, j1 = (1 - xy) & yz, k1 = (1 - xz) & (1 - yz);
+		const int32_t i2 = xy | xz, j2 = (1 - xy) | yz, k2 = (1 - xz) | (1 - yz);
+
+		const T x1 = x0 - static_cast<T>(i1) + G3, y1 = y0 - static_cast<T>(j1) + G3, z1 = z0 - static_cast<T>(k1) + G3;
+		const T x2 = x0 - static_cast<T>(i2) + T(2) * G3, y2 = y0 - static_cast<T>(j2) + T(2) * G3, z2 = z0 - static_cast<T>(k2) + T(2) * G3;
+		const T x3 = x0 - T(1) + T(3) * G3, y3 = y0 - T(1) + T(3) * G3, z3 = z0 - T(1) + T(3) * G3;
+
+		const int32_t ii = i & 255, jj = j & 255, kk = k & 255;
+
+		const T n0 = Corner(m_perm[ii + m_perm[jj + m_perm[kk]]], x0, y0, z0);
+		const T n1 = Corner(m_perm[ii + i1 + m_perm[jj + j1 + m_perm[kk + k1]]], x1, y1, z1);
+		const T n2 = Corner(m_perm[ii + i2 + m_perm[jj + j2 + m_perm[kk + k2]]], x2, y2, z2);
+		const T n3 = Corner(m_perm[ii + 1 + m_perm[jj + 1 + m_perm[kk + 1]]], x3, y3, z3);
+
+		// scaled to about [-1, 1]
+		return T(76) * (n0 + n1 + n2 + n3);
+	}
+
+	template <kind_t K>
+	VECTORCLASS_FORCEINLINE T Noise(T x, T y, T z) const noexcept
+	{
+		if constexpr (K == k_perlin)
+			return Perlin(x, y, z);
+		else
+			return Simplex(x, y, z);
+	}
+
+	inline T Perlin(const vector_3d<T>& p) const noexcept
+	{
+		return Perlin(p.x, p.y, p.z);
+	}
+
+	inline T Simplex(const vector_3d<T>& p) const noexcept
+	{
+		return Simplex(p.x, p.y, p.z);
+	}
+
+	inline T Fbm(const fbm_t& fbm, const vector_3d<T>& p) const noexcept
+	{
+		T sum = T(0), frequency = T(1), amplitude = T(1);
+
+		for (int octave = 0; octave < fbm.octaves; octave++)
+		{
+			const T x = p.x * frequency, y = p.y * frequency, z = p.z * frequency;
+			sum += amplitude * (fbm.kind == k_perlin ? Noise<k_perlin>(x, y, z) : Noise<k_simplex>(x, y, z));
+
+			frequency *= fbm.lacunarity;
+			amplitude *= fbm.gain;
+		}
+
+		return sum;
+	}
+
+	//
+	// Batches, from separate coordinate streams or from vectors
+	//
+
+	inline void Perlin(const T* x, const T* y, const T* z, size_t count, T* out) const noexcept
+	{
+		for (size_t i = 0; i < count; i++)
+			out[i] = Perlin(x[i], y[i], z[i]);
+	}
+
+	inline void Simplex(const T* x, const T* y, const T* z, size_t count, T* out) const noexcept
+	{
+		for (size_t i = 0; i < count; i++)
+			out[i] = Simplex(x[i], y[i], z[i]);
+	}
+
+	inline void Perlin(const vector_3d<T>* points, size_t count, T* out) const noexcept
+	{
+		for (size_t i = 0; i < count; i++)
+			out[i] = Perlin(points[i].x, points[i].y, points[i].z);
+	}
+
+	inline void Simplex(const vector_3d<T>* points, size_t count, T* out) const noexcept
+	{
+		for (size_t i = 0; i < count; i++)
+			out[i] = Simplex(points[i].x, points[i].y, points[i].z);
+	}
+
+	// the octaves are summed in the same order as in the single position
+	// Fbm(), one pass over the batch per octave
+	inline void Fbm(const fbm_t& fbm, const T* x, const T* y, const T* z, size_t count, T* out) const noexcept
+	{
+		if (fbm.kind == k_perlin)
+			FbmOctaves<k_perlin>(fbm, x, y, z, count, out);
+		else
+			FbmOctaves<k_simplex>(fbm, x, y, z, count, out);
+	}
+
+	inline void Fbm(const fbm_t& fbm, const vector_3d<T>* points, size_t count, T* out) const noexcept
+	{
+		T x[k_block], y[k_block], z[k_block];
+
+		for (size_t first = 0; first < count; first += k_block)
+		{
+			const size_t n = std::min(k_block, count - first);
+
+			for (size_t i = 0; i < n; i++)
+			{
+				x[i] = points[first + i].x;
+				y[i] = points[first + i].y;
+				z[i] = points[first + i].z;
+			}
+
+			Fbm(fbm, x, y, z, n, out + first);
+		}
+	}
+
+	//
+	// Grids
+	//
+
+	// samples the fractal sum at origin + (i, j, k) * step for an nx * ny * nz
+	// grid, written x fastest. rows are spread over the workers, every value
+	// equals the single position Fbm() at the same point.
+	inline void FbmGrid(const fbm_t& fbm, const vector_3d<T>& origin, T step, size_t nx, size_t ny, size_t nz, T* out) const
+	{
+		parallel_for(ny * nz, k_grain, [&](size_t begin, size_t end)
+		{
+			std::vector<T> x(nx), y(nx), z(nx);
+			for (size_t i = 0; i < nx; i++)
+				x[i] = origin.x + static_cast<T>(i) * step;
+
+			for (size_t row = begin; row < end; row++)
+			{
+				std::fill(y.begin(), y.end(), origin.y + static_cast<T>(row % ny) * step);
+				std::fill(z.begin(), z.end(), origin.z + static_cast<T>(row / ny) * step);
+
+				Fbm(fbm, x.data(), y.data(), z.data(), nx, out + row * nx);
+			}
+		});
+	}
+
+private:
+	// floor, exact for the range of int32_t
+	static VECTORCLASS_FORCEINLINE int32_t Floor(T v) noexcept
+	{
+		const int32_t i = static_cast<int32_t>(v);
+		return i - (v < static_cast<T>(i));
+	}
+
+	// 6t^5 - 15t^4 + 10t^3
+	static VECTORCLASS_FORCEINLINE T Fade(T t) noexcept
+	{
+		return t * t * t * vector_fma(t, vector_fma(t, T(6), T(-15)), T(10));
+	}
+
+	static VECTORCLASS_FORCEINLINE T Lerp(T t, T a, T b) noexcept
+	{
+		return vector_fma(t, b - a, a);
+	}
+
+	// dot product with one of the twelve cube edge directions
+	static VECTORCLASS_FORCEINLINE T Grad(int32_t hash, T x, T y, T z) noexcept
+	{
+		const int32_t h = hash & 15;
+
+		// u = h < 8 ? x : y, v = h < 4 ? y : (h == 12 || h == 14 ? x : z) as
+		// masks, as branches on random hashes are mispredicted half the time
+		const int32_t ux = h < 8, vy = h < 4, vx = (1 - vy) & ((h == 12) | (h == 14));
+		const T u = vector_keep_if(ux, x) + vector_keep_if(1 - ux, y);
+		const T v = vector_keep_if(vy, y) + vector_keep_if(vx, x) + vector_keep_if(1 - vy - vx, z);
+
+		return vector_flip_sign(h & 1, u) + vector_flip_sign(h & 2, v);
+	}
+
+	// falloff of one simplex corner, zero beyond a radius of sqrt(0.5). the
+	// often used 0.6 reaches past the neighbouring cells and leaves seams.
+	static VECTORCLASS_FORCEINLINE T Corner(int32_t hash, T x, T y, T z) noexcept
+	{
+		const T t = T(0.5) - x * x - y * y - z * z;
+		const T t2 = t * t;
+
+		return vector_keep_if(t > T(0), t2 * t2 * Grad(hash, x, y, z));
+	}
+
+	template <kind_t K>
+	inline void FbmOctaves(const fbm_t& fbm, const T* x, const T* y, const T* z, size_t count, T* out) const noexcept
+	{
+		std::fill(out, out + count, T(0));
+
+		T frequency = T(1), amplitude = T(1);
+		for (int octave = 0; octave < fbm.octaves; octave++)
+		{
+			for (size_t i = 0; i < count; i++)
+				out[i] += amplitude * Noise<K>(x[i] * frequency, y[i] * frequency, z[i] * frequency);
+
+			frequency *= fbm.lacunarity;
+			amplitude *= fbm.gain;
+		}
+	}
+
+private:
+	int32_t m_perm[512];
+};
+
+} // namespace detail
+
+//
+// type declarations
+//
+
+using GradientNoise = detail::gradient_noise<float>;
+
+template<typename T> using GradientNoiseT = detail::gradient_noise<T>;
+
+#endif // NOISE_CLASS_H
@@ -0,0 +1,218 @@
+//
+// parallel.h -- minimal fork/join helpers shared by the batch kernels
+//
+
+#ifndef PARALLEL_CLASS_H
+#define PARALLEL_CLASS_H
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace detail
+{
+
+//
+// worker configuration
+//
+
+// maximum amount of threads used by parallel_for, 0 means hardware concurrency
+inline std::atomic<unsigned> g_parallel_max_threads = 0;
+
+inline void parallel_set_max_threads(unsigned count) noexcept
+{
+	g_parallel_max_threads.store(count, std::memory_order_relaxed);
+}
+
+// returns amount of workers that parallel_for would spawn for given range
+inline unsigned parallel_worker_count(size_t count, size_t grain) noexcept
+{
+	// hardware_concurrency() reads the system configuration on every call
+	static const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+
+	unsigned threads = g_parallel_max_threads.load(std::memory_order_relaxed);
+	if (threads == 0)
+		threads = hardware;
+
+	grain = std::max<size_t>(grain, 1);
+
+	const size_t chunks = (count + grain - 1) / grain;
+	return static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(threads, chunks)));
+}
+
+//
+// workers that stay alive between calls, so that parallel_for does not start
+// threads for every batch. the pool runs one job at a time, a parallel_for
+// that finds it busy (issued from another thread, or nested inside of a job)
+// starts threads of its own instead.
+//
+class parallel_pool
+{
+public:
+	~parallel_pool()
+	{
+		{
+			std::lock_guard lock(m_mutex);
+			m_stop = true;
+		}
+
+		m_wake.notify_all();
+		for (auto& t : m_threads)
+			t.join();
+	}
+
+	static parallel_pool& Get()
+	{
+		static parallel_pool pool;
+		return pool;
+	}
+
+	// calls job(worker) for every worker in [0, workers), the calling thread
+	// is worker 0. returns false without calling anything when busy.
+	template<typename Job>
+	inline bool Run(unsigned workers, Job& job)
+	{
+		if (m_busy.exchange(true, std::memory_order_acquire))
+			return false;
+
+		{
+			std::lock_guard lock(m_mutex);
+
+			// threads started now see the job as new
+			while (m_threads.size() + 1 < workers)
+				m_threads.emplace_back(&parallel_pool::Work, this, static_cast<unsigned>(m_threads.size() + 1), m_generation);
+
+			m_job = [](void* context, unsigned worker) { (*static_cast<Job*>(context))(worker); };
+			m_context = &job;
+			m_workers = workers;
+			m_pending = workers - 1;
+			m_generation++;
+		}
+
+		m_wake.notify_all();
+		job(0);
+
+		{
+			std::unique_lock lock(m_mutex);
+			m_done.wait(lock, [this] { return m_pending == 0; });
+		}
+
+		m_busy.store(false, std::memory_order_release);
+		return true;
+	}
+
+private:
+	parallel_pool() noexcept = default;
+
+	inline void Work(unsigned index, uint64_t seen)
+	{
+		std::unique_lock lock(m_mutex);
+
+		for (;;)
+		{
+			m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+			if (m_stop)
+				return;
+
+			seen = m_generation;
+			if (index >= m_workers)
+				continue;
+
+			const auto job = m_job;
+			void* const context = m_context;
+
+			lock.unlock();
+			job(context, index);
+			lock.lock();
+
+			if (--m_pending == 0)
+				m_done.notify_one();
+		}
+	}
+
+private:
+	std::atomic<bool> m_busy = false;
+
+	std::mutex m_mutex;
+	std::condition_variable m_wake, m_done;
+	std::vector<std::thread> m_threads;
+
+	// current job, guarded by m_mutex
+	void (*m_job)(void*, unsigned) = nullptr;
+	void* m_context = nullptr;
+	unsigned m_workers = 0, m_pending = 0;
+	uint64_t m_generation = 0;
+	bool m_stop = false;
+};
+
+//
+// splits [0, count) into chunks of 'grain' elements, which are claimed by the
+// workers from a shared counter. threads that finish early keep pulling chunks
+// off the counter, so uneven chunks are balanced out without a scheduler.
+//
+// fn is called either as fn(begin, end) or fn(begin, end, worker), where worker
+// is in range [0, parallel_worker_count(count, grain)).
+//
+template<typename Fn>
+inline void parallel_for(size_t count, size_t grain, Fn&& fn)
+{
+	if (count == 0)
+		return;
+
+	grain = std::max<size_t>(grain, 1);
+
+	auto invoke = [&fn](size_t begin, size_t end, unsigned worker)
+	{
+		if constexpr (std::is_invocable_v<Fn&, size_t, size_t, unsigned>)
+			fn(begin, end, worker);
+		else
+			fn(begin, end);
+	};
+
+	const unsigned workers = parallel_worker_count(count, grain);
+	if (workers == 1)
+	{
+		invoke(0, count, 0);
+		return;
+	}
+
+	std::atomic<size_t> next = 0;
+
+	auto work = [&](unsigned worker)
+	{
+		for (;;)
+		{
+			const size_t begin = next.fetch_add(grain, std::memory_order_relaxed);
+			if (begin >= count)
+				break;
+
+			invoke(begin, std::min(begin + grain, count), worker);
+		}
+	};
+
+	if (parallel_pool::Get().Run(workers, work))
+		return;
+
+	std::vector<std::thread> threads;
+	threads.reserve(workers - 1);
+
+	for (unsigned i = 1; i < workers; i++)
+		threads.emplace_back(work, i);
+
+	// calling thread participates as worker 0
+	work(0);
+
+	for (auto& t : threads)
+		t.join();
+}
+
+} // namespace detail
+
+#endif // PARALLEL_CLASS_H
@@ -0,0 +1,326 @@
+//
+// particles.h -- particle integration over structure-of-arrays state
+//
+
+#ifndef PARTICLES_CLASS_H
+#define PARTICLES_CLASS_H
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+#include "vector.h"
+#include "parallel.h"
+
+namespace detail
+{
+
+//
+// particle state kept as separate x/y/z streams, so that the integration loops
+// below are plain unit-stride loops the compiler is able to vectorize. this is
+// the batched form of what vector_3d::MulAdd and vector_3d::Lerp do for one
+// particle.
+//
+template <VectorType T> requires(std::is_floating_point_v<T>)
+class particle_system
+{
+public:
+	// amount of particles processed by one worker at once
+	static constexpr size_t k_grain = 16384;
+
+	//
+	// Construction and destruction
+	//
+
+	particle_system() noexcept = default;
+
+	explicit particle_system(size_t count)
+	{
+		Resize(count);
+	}
+
+	//
+	// Container helpers
+	//
+
+	inline size_t Size() const noexcept
+	{
+		return m_px.size();
+	}
+
+	inline void Resize(size_t count)
+	{
+		for (auto* stream : Streams())
+			stream->resize(count, T(0));
+	}
+
+	inline void Reserve(size_t count)
+	{
+		for (auto* stream : Streams())
+			stream->reserve(count);
+	}
+
+	inline void Clear() noexcept
+	{
+		for (auto* stream : Streams())
+			stream->clear();
+	}
+
+	// appends new particle, returns its index
+	inline size_t Add(const vector_3d<T>& pos, const vector_3d<T>& vel = {}, const vector_3d<T>& acc = {})
+	{
+		m_px.push_back(pos.x); m_py.push_back(pos.y); m_pz.push_back(pos.z);
+		m_ox.push_back(pos.x); m_oy.push_back(pos.y); m_oz.push_back(pos.z);
+		m_vx.push_back(vel.x); m_vy.push_back(vel.y); m_vz.push_back(vel.z);
+		m_ax.push_back(acc.x); m_ay.push_back(acc.y); m_az.push_back(acc.z);
+
+		SeedHistory(m_px.size() - 1);
+		return m_px.size() - 1;
+	}
+
+	inline vector_3d<T> GetPosition(size_t i) const noexcept
+	{
+		return { m_px[i], m_py[i], m_pz[i] };
+	}
+
+	inline vector_3d<T> GetVelocity(size_t i) const noexcept
+	{
+		return { m_vx[i], m_vy[i], m_vz[i] };
+	}
+
+	inline vector_3d<T> GetAcceleration(size_t i) const noexcept
+	{
+		return { m_ax[i], m_ay[i], m_az[i] };
+	}
+
+	// sets position of the particle, its velocity is kept
+	inline void SetPosition(size_t i, const vector_3d<T>& pos) noexcept
+	{
+		m_px[i] = pos.x;
+		m_py[i] = pos.y;
+		m_pz[i] = pos.z;
+
+		SeedHistory(i);
+	}
+
+	inline void SetVelocity(size_t i, const vector_3d<T>& vel) noexcept
+	{
+		m_vx[i] = vel.x;
+		m_vy[i] = vel.y;
+		m_vz[i] = vel.z;
+
+		SeedHistory(i);
+	}
+
+	inline void SetAcceleration(size_t i, const vector_3d<T>& acc) noexcept
+	{
+		m_ax[i] = acc.x;
+		m_ay[i] = acc.y;
+		m_az[i] = acc.z;
+	}
+
+	// same acceleration for all particles, e.g. gravity
+	inline void SetAcceleration(const vector_3d<T>& acc) noexcept
+	{
+		std::fill(m_ax.begin(), m_ax.end(), acc.x);
+		std::fill(m_ay.begin(), m_ay.end(), acc.y);
+		std::fill(m_az.begin(), m_az.end(), acc.z);
+	}
+
+	// raw streams, for custom kernels
+	inline T* PositionX() noexcept { return m_px.data(); }
+	inline T* PositionY() noexcept { return m_py.data(); }
+	inline T* PositionZ() noexcept { return m_pz.data(); }
+	inline T* VelocityX() noexcept { return m_vx.data(); }
+	inline T* VelocityY() noexcept { return m_vy.data(); }
+	inline T* VelocityZ() noexcept { return m_vz.data(); }
+	inline T* AccelerationX() noexcept { return m_ax.data(); }
+	inline T* AccelerationY() noexcept { return m_ay.data(); }
+	inline T* AccelerationZ() noexcept { return m_az.data(); }
+
+	//
+	// Integration
+	//
+
+	// semi-implicit (symplectic) euler:
+	//	v = MulAdd(v, a, dt)
+	//	p = MulAdd(p, v, dt)
+	// positions are updated in place, the previous position is not stored
+	// since it can be recovered as p - v * dt.
+	inline void StepEuler(T dt)
+	{
+		parallel_for(Size(), k_grain, [this, dt](size_t begin, size_t end)
+		{
+			EulerRange(m_px.data(), m_py.data(), m_pz.data(), m_vx.data(), m_vy.data(), m_vz.data(),
+					   m_ax.data(), m_ay.data(), m_az.data(), begin, end, dt);
+		});
+
+		m_history_valid = false;
+		m_last_dt = dt;
+	}
+
+	// same as above, but with one acceleration for all particles (e.g. gravity),
+	// which saves reading the acceleration streams
+	inline void StepEuler(T dt, const vector_3d<T>& acc)
+	{
+		parallel_for(Size(), k_grain, [this, dt, &acc](size_t begin, size_t end)
+		{
+			EulerRange(m_px.data(), m_py.data(), m_pz.data(), m_vx.data(), m_vy.data(), m_vz.data(), acc, begin, end, dt);
+		});
+
+		m_history_valid = false;
+		m_last_dt = dt;
+	}
+
+	// position verlet:
+	//	p' = p + (p - p_prev) + a * dt^2
+	// velocity is derived from the positions afterwards, so that the two
+	// steppers can be switched between frames.
+	inline void StepVerlet(T dt)
+	{
+		if (dt == T(0))
+			return;
+
+		// coming from euler or fresh particles, seed the history from velocity
+		const bool seed = !m_history_valid;
+
+		parallel_for(Size(), k_grain, [this, dt, seed](size_t begin, size_t end)
+		{
+			VerletRange(m_px.data(), m_ox.data(), m_vx.data(), m_ax.data(), begin, end, dt, seed);
+			VerletRange(m_py.data(), m_oy.data(), m_vy.data(), m_ay.data(), begin, end, dt, seed);
+			VerletRange(m_pz.data(), m_oz.data(), m_vz.data(), m_az.data(), begin, end, dt, seed);
+		});
+
+		m_history_valid = true;
+		m_last_dt = dt;
+	}
+
+	// writes Lerp(previous, current, alpha) of every particle into 'out', which
+	// has to hold Size() elements. used for render interpolation between steps.
+	// computed in T, as vector_3d::Lerp() takes its factor as float.
+	inline void Interpolate(T alpha, vector_3d<T>* out) const
+	{
+		parallel_for(Size(), k_grain, [this, alpha, out](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				const vector_3d<T> a = GetPreviousPosition(i), b = GetPosition(i);
+				out[i] = vector_3d<T>(vector_fma(b.x - a.x, alpha, a.x), vector_fma(b.y - a.y, alpha, a.y), vector_fma(b.z - a.z, alpha, a.z));
+			}
+		});
+	}
+
+	// position before the last step
+	inline vector_3d<T> GetPreviousPosition(size_t i) const noexcept
+	{
+		if (m_history_valid)
+			return { m_ox[i], m_oy[i], m_oz[i] };
+
+		return { vector_fma(m_vx[i], -m_last_dt, m_px[i]), vector_fma(m_vy[i], -m_last_dt, m_py[i]), vector_fma(m_vz[i], -m_last_dt, m_pz[i]) };
+	}
+
+private:
+	inline std::array<std::vector<T>*, 12> Streams() noexcept
+	{
+		return
+		{
+			&m_px, &m_py, &m_pz,
+			&m_ox, &m_oy, &m_oz,
+			&m_vx, &m_vy, &m_vz,
+			&m_ax, &m_ay, &m_az,
+		};
+	}
+
+	// keeps verlet history consistent with the velocity of the particle
+	inline void SeedHistory(size_t i) noexcept
+	{
+		m_ox[i] = m_px[i] - m_vx[i] * m_last_dt;
+		m_oy[i] = m_py[i] - m_vy[i] * m_last_dt;
+		m_oz[i] = m_pz[i] - m_vz[i] * m_last_dt;
+	}
+
+	// all three axes in one pass, so that each stream is read once while it
+	// is in cache
+	static inline void EulerRange(T* __restrict px, T* __restrict py, T* __restrict pz,
+								  T* __restrict vx, T* __restrict vy, T* __restrict vz,
+								  const T* __restrict ax, const T* __restrict ay, const T* __restrict az,
+								  size_t begin, size_t end, T dt) noexcept
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			vx[i] = vector_fma(ax[i], dt, vx[i]);
+			vy[i] = vector_fma(ay[i], dt, vy[i]);
+			vz[i] = vector_fma(az[i], dt, vz[i]);
+
+			px[i] = vector_fma(vx[i], dt, px[i]);
+			py[i] = vector_fma(vy[i], dt, py[i]);
+			pz[i] = vector_fma(vz[i], dt, pz[i]);
+		}
+	}
+
+	static inline void EulerRange(T* __restrict px, T* __restrict py, T* __restrict pz,
+								  T* __restrict vx, T* __restrict vy, T* __restrict vz,
+								  const vector_3d<T>& a, size_t begin, size_t end, T dt) noexcept
+	{
+		const T dvx = a.x * dt, dvy = a.y * dt, dvz = a.z * dt;
+
+		for (size_t i = begin; i < end; i++)
+		{
+			vx[i] = vx[i] + dvx;
+			vy[i] = vy[i] + dvy;
+			vz[i] = vz[i] + dvz;
+
+			px[i] = vector_fma(vx[i], dt, px[i]);
+			py[i] = vector_fma(vy[i], dt, py[i]);
+			pz[i] = vector_fma(vz[i], dt, pz[i]);
+		}
+	}
+
+	static inline void VerletRange(T* __restrict p, T* __restrict o, T* __restrict v, const T* __restrict a,
+								   size_t begin, size_t end, T dt, bool seed) noexcept
+	{
+		const T dt2 = dt * dt, inv_dt = T(1) / dt;
+
+		if (seed)
+		{
+			for (size_t i = begin; i < end; i++)
+				o[i] = vector_fma(-v[i], dt, p[i]);
+		}
+
+		for (size_t i = begin; i < end; i++)
+		{
+			const T cur = p[i];
+			const T next = vector_fma(a[i], dt2, cur + (cur - o[i]));
+
+			o[i] = cur;
+			p[i] = next;
+			v[i] = (next - cur) * inv_dt;
+		}
+	}
+
+private:
+	// current position, previous position, velocity and acceleration
+	std::vector<T> m_px, m_py, m_pz;
+	std::vector<T> m_ox, m_oy, m_oz;
+	std::vector<T> m_vx, m_vy, m_vz;
+	std::vector<T> m_ax, m_ay, m_az;
+
+	// previous position streams are only maintained by the verlet stepper
+	bool m_history_valid = false;
+	T m_last_dt = T(0);
+};
+
+} // namespace detail
+
+//
+// type declarations
+//
+
+using ParticleSystem = detail::particle_system<float>;
+
+template<typename T> using ParticleSystemT = detail::particle_system<T>;
+
+#endif // PARTICLES_CLASS_H
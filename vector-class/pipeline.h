@@ -0,0 +1,281 @@
+//
+// pipeline.h -- lazy coroutine pipelines over chunks of vector_3d
+//
+
+#ifndef PIPELINE_CLASS_H
+#define PIPELINE_CLASS_H
+#pragma once
+
+#include <algorithm>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "vector.h"
+#include "parallel.h"
+
+namespace detail
+{
+
+//
+// a stream is a generator of chunks of vectors. every stage is a coroutine that
+// pulls chunks from the stage before it, so nothing runs until the last stage
+// asks for data, and at no point more than a few chunks are alive, whatever
+// the size of the input.
+//
+// a chunk is a mutable span into a buffer owned by the stage that produced it.
+// it stays valid until the next chunk is requested. stages work on chunks in
+// place where they can, so most stages do not copy at all.
+//
+//	auto visible = vector_stream<float>::FromArray(points, count)
+//		.Transform([](auto chunk) { ... })
+//		.Filter([](const Vector& v) { return v.z > 0.0f; })
+//		.Collect();
+//
+template <VectorType T>
+class vector_stream
+{
+public:
+	using chunk_t = std::span<vector_3d<T>>;
+
+	// chunks sized to stay in L2 together with the output of a stage
+	static constexpr size_t k_chunk_bytes = 128 * 1024;
+	static constexpr size_t k_default_chunk = k_chunk_bytes / sizeof(vector_3d<T>);
+
+	struct promise_type
+	{
+		chunk_t chunk;
+		std::exception_ptr exception;
+
+		vector_stream get_return_object() noexcept
+		{
+			return vector_stream(std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+
+		std::suspend_always initial_suspend() const noexcept { return {}; }
+		std::suspend_always final_suspend() const noexcept { return {}; }
+
+		std::suspend_always yield_value(chunk_t value) noexcept
+		{
+			chunk = value;
+			return {};
+		}
+
+		void return_void() const noexcept {}
+
+		void unhandled_exception() noexcept
+		{
+			exception = std::current_exception();
+		}
+	};
+
+	//
+	// Construction and destruction
+	//
+
+	vector_stream(vector_stream&& other) noexcept :
+		m_handle(std::exchange(other.m_handle, nullptr))
+	{
+	}
+
+	vector_stream& operator=(vector_stream&& other) noexcept
+	{
+		if (this != &other)
+		{
+			if (m_handle)
+				m_handle.destroy();
+			m_handle = std::exchange(other.m_handle, nullptr);
+		}
+		return *this;
+	}
+
+	vector_stream(const vector_stream&) = delete;
+	vector_stream& operator=(const vector_stream&) = delete;
+
+	~vector_stream()
+	{
+		if (m_handle)
+			m_handle.destroy();
+	}
+
+	//
+	// Sources
+	//
+
+	// copies 'data' chunk by chunk, so that later stages may modify it. the
+	// array has to outlive the stream.
+	static vector_stream FromArray(const vector_3d<T>* data, size_t count, size_t chunk = k_default_chunk)
+	{
+		std::vector<vector_3d<T>> buffer(std::max<size_t>(chunk, 1));
+
+		for (size_t lo = 0; lo < count; lo += buffer.size())
+		{
+			const size_t n = std::min(buffer.size(), count - lo);
+			std::copy(data + lo, data + lo + n, buffer.begin());
+			co_yield chunk_t(buffer.data(), n);
+		}
+	}
+
+	// 'fill' is called as fill(chunk_t buffer) and returns how many vectors it
+	// wrote to the buffer, 0 ends the stream
+	template <typename Fn>
+	static vector_stream FromFunction(Fn fill, size_t chunk = k_default_chunk)
+	{
+		std::vector<vector_3d<T>> buffer(std::max<size_t>(chunk, 1));
+
+		while (const size_t n = fill(chunk_t(buffer)))
+			co_yield chunk_t(buffer.data(), std::min(n, buffer.size()));
+	}
+
+	//
+	// Stages, these consume the stream they are called on
+	//
+
+	// fn(chunk_t) modifies every chunk in place
+	template <typename Fn>
+	vector_stream Transform(Fn fn) &&
+	{
+		return TransformStage(std::move(*this), std::move(fn));
+	}
+
+	// like Transform(), but chunks are collected into one batch per worker and
+	// every batch is transformed in parallel. fn has to be safe to call from
+	// several threads at once and must not throw. the order of the chunks is
+	// kept.
+	template <typename Fn>
+	vector_stream TransformParallel(Fn fn) &&
+	{
+		return TransformParallelStage(std::move(*this), std::move(fn), parallel_worker_count(SIZE_MAX, 1));
+	}
+
+	// keeps the vectors for which pred(const vector_3d<T>&) is true, in order.
+	// chunks shrink by the removed vectors, empty chunks are skipped.
+	template <typename Fn>
+	vector_stream Filter(Fn pred) &&
+	{
+		return FilterStage(std::move(*this), std::move(pred));
+	}
+
+	//
+	// Consumption
+	//
+
+	// advances to the next chunk, false at the end of the stream. exceptions
+	// thrown by any stage are rethrown here.
+	inline bool Next()
+	{
+		if (!m_handle || m_handle.done())
+			return false;
+
+		m_handle.resume();
+
+		if (m_handle.promise().exception)
+			std::rethrow_exception(std::exchange(m_handle.promise().exception, nullptr));
+
+		return !m_handle.done();
+	}
+
+	// current chunk, valid after Next() returned true
+	inline chunk_t Chunk() const noexcept
+	{
+		return m_handle.promise().chunk;
+	}
+
+	// runs the pipeline, fn(chunk_t) is called for every chunk
+	template <typename Fn>
+	void ForEach(Fn&& fn) &&
+	{
+		while (Next())
+			fn(Chunk());
+	}
+
+	// runs the pipeline and returns everything that comes out of it
+	std::vector<vector_3d<T>> Collect() &&
+	{
+		std::vector<vector_3d<T>> out;
+		while (Next())
+			out.insert(out.end(), Chunk().begin(), Chunk().end());
+		return out;
+	}
+
+private:
+	explicit vector_stream(std::coroutine_handle<promise_type> handle) noexcept :
+		m_handle(handle)
+	{
+	}
+
+	template <typename Fn>
+	static vector_stream TransformStage(vector_stream upstream, Fn fn)
+	{
+		while (upstream.Next())
+		{
+			fn(upstream.Chunk());
+			co_yield upstream.Chunk();
+		}
+	}
+
+	// the upstream chunks are only valid until the next one is pulled, so a
+	// batch is copied into buffers owned by this stage
+	template <typename Fn>
+	static vector_stream TransformParallelStage(vector_stream upstream, Fn fn, unsigned batch)
+	{
+		std::vector<std::vector<vector_3d<T>>> buffers(batch);
+
+		for (bool more = true; more;)
+		{
+			size_t n = 0;
+			while (n < batch && (more = upstream.Next()))
+			{
+				buffers[n].assign(upstream.Chunk().begin(), upstream.Chunk().end());
+				n++;
+			}
+
+			parallel_for(n, 1, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+					fn(chunk_t(buffers[i]));
+			});
+
+			for (size_t i = 0; i < n; i++)
+				co_yield chunk_t(buffers[i]);
+		}
+	}
+
+	template <typename Fn>
+	static vector_stream FilterStage(vector_stream upstream, Fn pred)
+	{
+		while (upstream.Next())
+		{
+			const chunk_t chunk = upstream.Chunk();
+
+			size_t kept = 0;
+			for (size_t i = 0; i < chunk.size(); i++)
+			{
+				if (pred(static_cast<const vector_3d<T>&>(chunk[i])))
+					chunk[kept++] = chunk[i];
+			}
+
+			if (kept)
+				co_yield chunk.first(kept);
+		}
+	}
+
+private:
+	std::coroutine_handle<promise_type> m_handle;
+};
+
+} // namespace detail
+
+//
+// type declarations
+//
+
+using VectorStream = detail::vector_stream<float>;
+
+template<typename T> using VectorStreamT = detail::vector_stream<T>;
+
+#endif // PIPELINE_CLASS_H
@@ -0,0 +1,160 @@
+//
+// pixel_format.h -- packed pixel formats and conversions between them
+//
+
+#ifndef PIXEL_FORMAT_CLASS_H
+#define PIXEL_FORMAT_CLASS_H
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "color.h"
+#include "parallel.h"
+
+namespace detail
+{
+
+//
+// position of one channel inside of a packed pixel, channels with zero bits
+// are not stored and read back as fully saturated
+//
+struct channel_desc
+{
+	uint32_t shift, bits;
+
+	constexpr inline uint32_t max() const noexcept
+	{
+		return bits ? (1u << bits) - 1 : 0;
+	}
+};
+
+//
+// compile-time description of a packed pixel stored in an unsigned integer,
+// such as the rgba8 layout produced by color255::as_u32
+//
+template<typename S, channel_desc R, channel_desc G, channel_desc B, channel_desc A> requires(std::is_unsigned_v<S>)
+struct pixel_format
+{
+	using storage_t = S;
+
+	static constexpr channel_desc r = R, g = G, b = B, a = A;
+
+	static_assert(R.shift + R.bits <= sizeof(S) * 8 && G.shift + G.bits <= sizeof(S) * 8 &&
+				  B.shift + B.bits <= sizeof(S) * 8 && A.shift + A.bits <= sizeof(S) * 8, "channel outside of storage");
+};
+
+using format_rgba8 = pixel_format<uint32_t, channel_desc{ 0, 8 }, channel_desc{ 8, 8 }, channel_desc{ 16, 8 }, channel_desc{ 24, 8 }>;
+using format_bgra8 = pixel_format<uint32_t, channel_desc{ 16, 8 }, channel_desc{ 8, 8 }, channel_desc{ 0, 8 }, channel_desc{ 24, 8 }>;
+using format_rgb565 = pixel_format<uint16_t, channel_desc{ 11, 5 }, channel_desc{ 5, 6 }, channel_desc{ 0, 5 }, channel_desc{ 0, 0 }>;
+using format_rgba4444 = pixel_format<uint16_t, channel_desc{ 12, 4 }, channel_desc{ 8, 4 }, channel_desc{ 4, 4 }, channel_desc{ 0, 4 }>;
+using format_rgb10a2 = pixel_format<uint32_t, channel_desc{ 0, 10 }, channel_desc{ 10, 10 }, channel_desc{ 20, 10 }, channel_desc{ 30, 2 }>;
+
+//
+// conversion from one pixel format to another. every pair of formats gets its
+// own kernel with all shifts, masks and scales known at compile time, so the
+// batch loop has no per-pixel branches and is left to the compiler to
+// vectorize. channels are rescaled with rounding, so converting to a wider
+// format and back is lossless.
+//
+template<typename From, typename To>
+class pixel_converter
+{
+public:
+	using src_t = typename From::storage_t;
+	using dst_t = typename To::storage_t;
+
+	// pixels handed to one worker at once
+	static constexpr size_t k_grain = 256 * 1024;
+
+	static constexpr inline dst_t convert(src_t p) noexcept
+	{
+		const uint32_t v = static_cast<uint32_t>(p);
+
+		return static_cast<dst_t>(channel<From::r, To::r>(v) | channel<From::g, To::g>(v) |
+								  channel<From::b, To::b>(v) | channel<From::a, To::a>(v));
+	}
+
+	static constexpr inline dst_t convert(const color255<uint8_t>& c) noexcept
+	{
+		return pixel_converter<format_rgba8, To>::convert(c.as_u32());
+	}
+
+	// 'in' and 'out' may only be the same array when both formats have the
+	// same storage size
+	static inline void convert(const src_t* in, dst_t* out, size_t count)
+	{
+		if constexpr (std::is_same_v<From, To>)
+		{
+			if (in != out)
+				std::memmove(out, in, count * sizeof(src_t));
+		}
+		else
+		{
+			parallel_for(count, k_grain, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+					out[i] = convert(in[i]);
+			});
+		}
+	}
+
+	static inline void convert(const color255<uint8_t>* in, dst_t* out, size_t count)
+	{
+		parallel_for(count, k_grain, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				// as_u32 without the instrumentation hook
+				const uint32_t v = in[i].r | in[i].g << 8 | in[i].b << 16 | static_cast<uint32_t>(in[i].a) << 24;
+				out[i] = pixel_converter<format_rgba8, To>::convert(v);
+			}
+		});
+	}
+
+	static inline void convert(const src_t* in, color255<uint8_t>* out, size_t count)
+	{
+		parallel_for(count, k_grain, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				const uint32_t v = pixel_converter<From, format_rgba8>::convert(in[i]);
+				out[i] = color255<uint8_t>(static_cast<uint8_t>(v), static_cast<uint8_t>(v >> 8),
+										   static_cast<uint8_t>(v >> 16), static_cast<uint8_t>(v >> 24));
+			}
+		});
+	}
+
+private:
+	// channel value of 'v' in source layout, placed into the destination layout
+	template<channel_desc S, channel_desc D>
+	static constexpr inline uint32_t channel(uint32_t v) noexcept
+	{
+		if constexpr (D.bits == 0)
+			return 0;
+		else if constexpr (S.bits == 0)
+			return D.max() << D.shift;
+		else if constexpr (S.bits == D.bits)
+			return ((v >> S.shift) & S.max()) << D.shift;
+		else
+			return (((v >> S.shift) & S.max()) * D.max() + S.max() / 2) / S.max() << D.shift;
+	}
+};
+
+} // namespace detail
+
+//
+// type declarations
+//
+
+using CFormatRGBA8 = detail::format_rgba8;
+using CFormatBGRA8 = detail::format_bgra8;
+using CFormatRGB565 = detail::format_rgb565;
+using CFormatRGBA4444 = detail::format_rgba4444;
+using CFormatRGB10A2 = detail::format_rgb10a2;
+
+template<typename From, typename To> using CPixelConverter = detail::pixel_converter<From, To>;
+
+#endif // PIXEL_FORMAT_CLASS_H
@@ -0,0 +1,580 @@
+//
+// point_cloud.h -- memory mapped binary point cloud files of Vector + CColor255
+//
+
+#ifndef POINT_CLOUD_CLASS_H
+#define POINT_CLOUD_CLASS_H
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "vector.h"
+#include "color.h"
+
+namespace detail
+{
+
+//
+// the file is a 64 byte header followed by the points in chunks of a fixed
+// number of points, and a directory with the bounding box of every chunk at
+// the end. everything is little endian and every chunk starts 64 byte aligned
+// relative to the start of the file, so the mapped points can be used in place.
+//
+//	header:
+//		char	magic[8]		"VCCLOUD\0"
+//		uint32	version
+//		uint32	layout			0 = AoS, 1 = SoA
+//		uint64	point count
+//		uint32	points per chunk	multiple of 16
+//		uint32	reserved
+//		uint64	directory offset
+//		float	mins[3], maxs[3]	bounds of all points
+//
+//	AoS chunks:	n records of { float x, y, z; uint8 r, g, b, a }
+//	SoA chunks:	n positions, padded to a full chunk of them, then n colors
+//
+//	directory:	float mins[3], maxs[3] of every chunk
+//
+// in the AoS layout the chunks follow each other without gaps, so all records
+// of the file form one span.
+//
+namespace point_cloud
+{
+	enum layout_t : uint32_t
+	{
+		k_aos,
+		k_soa,
+	};
+
+	static constexpr char k_magic[8] = { 'V', 'C', 'C', 'L', 'O', 'U', 'D', '\0' };
+	static constexpr uint32_t k_version = 1;
+	static constexpr uint32_t k_default_chunk = 64 * 1024;
+
+	struct header_t
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t layout;
+		uint64_t point_count;
+		uint32_t chunk_points;
+		uint32_t reserved;
+		uint64_t directory_offset;
+		float mins[3], maxs[3];
+	};
+
+	struct bounds_t
+	{
+		float mins[3], maxs[3];
+	};
+
+	// one AoS record
+	struct point_t
+	{
+		vector_3d<float> position;
+		color255<uint8_t> color;
+	};
+
+	static_assert(sizeof(header_t) == 64 && sizeof(bounds_t) == 24);
+	static_assert(sizeof(vector_3d<float>) == 12 && sizeof(color255<uint8_t>) == 4 && sizeof(point_t) == 16);
+
+	// mapped chunks are used in place without byte swapping
+	static_assert(std::endian::native == std::endian::little, "point cloud files require a little endian target");
+
+	// offset of chunk 'i' from the start of the file, points of all layouts
+	// take 16 bytes
+	inline constexpr uint64_t chunk_offset(uint32_t chunk_points, size_t i) noexcept
+	{
+		return sizeof(header_t) + static_cast<uint64_t>(i) * chunk_points * sizeof(point_t);
+	}
+
+	inline void grow_bounds(bounds_t& b, const vector_3d<float>* positions, size_t count) noexcept
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			b.mins[0] = std::min(b.mins[0], positions[i].x);
+			b.mins[1] = std::min(b.mins[1], positions[i].y);
+			b.mins[2] = std::min(b.mins[2], positions[i].z);
+			b.maxs[0] = std::max(b.maxs[0], positions[i].x);
+			b.maxs[1] = std::max(b.maxs[1], positions[i].y);
+			b.maxs[2] = std::max(b.maxs[2], positions[i].z);
+		}
+	}
+
+	inline constexpr bounds_t empty_bounds() noexcept
+	{
+		constexpr float inf = std::numeric_limits<float>::infinity();
+		return { { inf, inf, inf }, { -inf, -inf, -inf } };
+	}
+} // namespace point_cloud
+
+//
+// writes points as they come, only one chunk is kept in memory
+//
+class point_cloud_writer
+{
+public:
+	//
+	// Construction and destruction
+	//
+
+	point_cloud_writer() noexcept = default;
+
+	point_cloud_writer(const point_cloud_writer&) = delete;
+	point_cloud_writer& operator=(const point_cloud_writer&) = delete;
+
+	~point_cloud_writer()
+	{
+		Close();
+	}
+
+	// chunk_points is rounded up to a multiple of 16
+	inline bool Open(const char* path, point_cloud::layout_t layout = point_cloud::k_soa,
+					 uint32_t chunk_points = point_cloud::k_default_chunk)
+	{
+		Close();
+
+		m_file = std::fopen(path, "wb");
+		if (!m_file)
+			return false;
+
+		m_layout = layout;
+		m_chunk_points = (std::max<uint32_t>(chunk_points, 1) + 15) / 16 * 16;
+		m_point_count = 0;
+		m_offset = 0;
+		m_good = true;
+		m_bounds = point_cloud::empty_bounds();
+		m_directory.clear();
+		m_positions.clear();
+		m_colors.clear();
+		m_positions.reserve(m_chunk_points);
+		m_colors.reserve(m_chunk_points);
+
+		// the header is rewritten with the final counts on Close()
+		const point_cloud::header_t header = {};
+		return Put(&header, sizeof(header));
+	}
+
+	inline bool IsOpen() const noexcept
+	{
+		return m_file != nullptr;
+	}
+
+	inline bool Write(const vector_3d<float>& position, const color255<uint8_t>& color)
+	{
+		return Write(&position, &color, 1);
+	}
+
+	// false once any write to the file failed
+	inline bool Write(const vector_3d<float>* positions, const color255<uint8_t>* colors, size_t count)
+	{
+		while (m_good && count)
+		{
+			const size_t n = std::min<size_t>(count, m_chunk_points - m_positions.size());
+
+			m_positions.insert(m_positions.end(), positions, positions + n);
+			m_colors.insert(m_colors.end(), colors, colors + n);
+			positions += n;
+			colors += n;
+			count -= n;
+
+			if (m_positions.size() == m_chunk_points)
+				FlushChunk();
+		}
+
+		return m_good;
+	}
+
+	// writes the last chunk, the directory and the header. returns false when
+	// any write failed, the file is not usable then.
+	inline bool Close()
+	{
+		if (!m_file)
+			return false;
+
+		if (!m_positions.empty())
+			FlushChunk();
+
+		point_cloud::header_t header = {};
+		std::memcpy(header.magic, point_cloud::k_magic, sizeof(header.magic));
+		header.version = point_cloud::k_version;
+		header.layout = m_layout;
+		header.point_count = m_point_count;
+		header.chunk_points = m_chunk_points;
+		header.directory_offset = m_offset;
+		std::memcpy(header.mins, m_bounds.mins, sizeof(header.mins));
+		std::memcpy(header.maxs, m_bounds.maxs, sizeof(header.maxs));
+
+		Put(m_directory.data(), m_directory.size() * sizeof(point_cloud::bounds_t));
+
+		m_good = m_good && std::fseek(m_file, 0, SEEK_SET) == 0;
+		Put(&header, sizeof(header));
+
+		m_good = std::fclose(m_file) == 0 && m_good;
+		m_file = nullptr;
+		return m_good;
+	}
+
+private:
+	inline bool Put(const void* data, size_t size)
+	{
+		// an empty directory has no storage to point at
+		if (size == 0)
+			return m_good;
+
+		m_good = m_good && std::fwrite(data, 1, size, m_file) == size;
+		m_offset += size;
+		return m_good;
+	}
+
+	inline void FlushChunk()
+	{
+		const size_t n = m_positions.size();
+
+		point_cloud::bounds_t bounds = point_cloud::empty_bounds();
+		point_cloud::grow_bounds(bounds, m_positions.data(), n);
+		point_cloud::grow_bounds(m_bounds, m_positions.data(), n);
+		m_directory.push_back(bounds);
+
+		if (m_layout == point_cloud::k_aos)
+		{
+			std::vector<point_cloud::point_t> records(n);
+			for (size_t i = 0; i < n; i++)
+				records[i] = { m_positions[i], m_colors[i] };
+
+			Put(records.data(), n * sizeof(point_cloud::point_t));
+		}
+		else
+		{
+			// the colors of a partial last chunk still start after a full
+			// chunk of positions
+			static constexpr uint8_t zeros[sizeof(vector_3d<float>) * 16] = {};
+
+			Put(m_positions.data(), n * sizeof(vector_3d<float>));
+			for (size_t pad = m_chunk_points - n; pad > 0; pad -= std::min<size_t>(pad, 16))
+				Put(zeros, std::min<size_t>(pad, 16) * sizeof(vector_3d<float>));
+			Put(m_colors.data(), n * sizeof(color255<uint8_t>));
+		}
+
+		m_point_count += n;
+		m_positions.clear();
+		m_colors.clear();
+	}
+
+private:
+	std::FILE* m_file = nullptr;
+	bool m_good = false;
+
+	point_cloud::layout_t m_layout = point_cloud::k_soa;
+	uint32_t m_chunk_points = 0;
+	uint64_t m_point_count = 0;
+	uint64_t m_offset = 0;
+
+	point_cloud::bounds_t m_bounds = point_cloud::empty_bounds();
+	std::vector<point_cloud::bounds_t> m_directory;
+
+	// the chunk being filled
+	std::vector<vector_3d<float>> m_positions;
+	std::vector<color255<uint8_t>> m_colors;
+};
+
+//
+// maps a whole file read-only, opening costs the same for any size and the
+// pages are only read once the points are accessed
+//
+class point_cloud_reader
+{
+public:
+	//
+	// Construction and destruction
+	//
+
+	point_cloud_reader() noexcept = default;
+
+	point_cloud_reader(const point_cloud_reader&) = delete;
+	point_cloud_reader& operator=(const point_cloud_reader&) = delete;
+
+	~point_cloud_reader()
+	{
+		Close();
+	}
+
+	// false when the file can not be mapped or is not a valid point cloud
+	inline bool Open(const char* path)
+	{
+		Close();
+
+		if (!Map(path))
+			return false;
+
+		if (!Validate())
+		{
+			Close();
+			return false;
+		}
+
+		return true;
+	}
+
+	inline void Close() noexcept
+	{
+		Unmap();
+		m_header = nullptr;
+		m_directory = nullptr;
+	}
+
+	inline bool IsOpen() const noexcept
+	{
+		return m_header != nullptr;
+	}
+
+	//
+	// Contents
+	//
+
+	inline point_cloud::layout_t Layout() const noexcept
+	{
+		return static_cast<point_cloud::layout_t>(m_header->layout);
+	}
+
+	inline size_t Size() const noexcept
+	{
+		return static_cast<size_t>(m_header->point_count);
+	}
+
+	inline size_t ChunkPoints() const noexcept
+	{
+		return m_header->chunk_points;
+	}
+
+	inline size_t ChunkCount() const noexcept
+	{
+		return (Size() + ChunkPoints() - 1) / ChunkPoints();
+	}
+
+	// number of points in chunk i, only the last chunk may be partial
+	inline size_t ChunkSize(size_t i) const noexcept
+	{
+		return std::min(ChunkPoints(), Size() - i * ChunkPoints());
+	}
+
+	inline vector_3d<float> GetMins() const noexcept
+	{
+		return { m_header->mins[0], m_header->mins[1], m_header->mins[2] };
+	}
+
+	inline vector_3d<float> GetMaxs() const noexcept
+	{
+		return { m_header->maxs[0], m_header->maxs[1], m_header->maxs[2] };
+	}
+
+	inline vector_3d<float> GetChunkMins(size_t i) const noexcept
+	{
+		return { m_directory[i].mins[0], m_directory[i].mins[1], m_directory[i].mins[2] };
+	}
+
+	inline vector_3d<float> GetChunkMaxs(size_t i) const noexcept
+	{
+		return { m_directory[i].maxs[0], m_directory[i].maxs[1], m_directory[i].maxs[2] };
+	}
+
+	//
+	// zero-copy access, the spans stay valid until Close()
+	//
+
+	// all records of an AoS file, empty for SoA
+	inline std::span<const point_cloud::point_t> Points() const noexcept
+	{
+		if (Layout() != point_cloud::k_aos)
+			return {};
+
+		return { reinterpret_cast<const point_cloud::point_t*>(m_data + sizeof(point_cloud::header_t)), Size() };
+	}
+
+	// records of chunk i of an AoS file, empty for SoA
+	inline std::span<const point_cloud::point_t> Points(size_t i) const noexcept
+	{
+		return Points().subspan(i * ChunkPoints(), ChunkSize(i));
+	}
+
+	// positions of chunk i of an SoA file, empty for AoS
+	inline std::span<const vector_3d<float>> Positions(size_t i) const noexcept
+	{
+		if (Layout() != point_cloud::k_soa)
+			return {};
+
+		return { reinterpret_cast<const vector_3d<float>*>(m_data + point_cloud::chunk_offset(m_header->chunk_points, i)), ChunkSize(i) };
+	}
+
+	// colors of chunk i of an SoA file, empty for AoS
+	inline std::span<const color255<uint8_t>> Colors(size_t i) const noexcept
+	{
+		if (Layout() != point_cloud::k_soa)
+			return {};
+
+		const uint64_t offset = point_cloud::chunk_offset(m_header->chunk_points, i) + ChunkPoints() * sizeof(vector_3d<float>);
+		return { reinterpret_cast<const color255<uint8_t>*>(m_data + offset), ChunkSize(i) };
+	}
+
+private:
+	// every offset and size in the header has to lie inside of the mapping
+	inline bool Validate() noexcept
+	{
+		if (m_size < sizeof(point_cloud::header_t))
+			return false;
+
+		const auto* header = reinterpret_cast<const point_cloud::header_t*>(m_data);
+
+		if (std::memcmp(header->magic, point_cloud::k_magic, sizeof(header->magic)) != 0 || header->version != point_cloud::k_version)
+			return false;
+
+		if (header->layout > point_cloud::k_soa || header->chunk_points == 0 || header->chunk_points % 16 != 0)
+			return false;
+
+		// every point takes 16 bytes, bounding the count first keeps the
+		// offsets below from wrapping around
+		if (header->point_count > (m_size - sizeof(point_cloud::header_t)) / sizeof(point_cloud::point_t))
+			return false;
+
+		const uint64_t chunks = header->point_count / header->chunk_points + (header->point_count % header->chunk_points != 0);
+		if (chunks > m_size / sizeof(point_cloud::bounds_t))
+			return false;
+
+		// the last chunk ends where the directory starts
+		const uint64_t last = header->point_count - (chunks ? (chunks - 1) * header->chunk_points : 0);
+		const uint64_t data_end = chunks == 0 ? sizeof(point_cloud::header_t) :
+			point_cloud::chunk_offset(header->chunk_points, chunks - 1) +
+			(header->layout == point_cloud::k_aos ? last * sizeof(point_cloud::point_t) :
+				header->chunk_points * sizeof(vector_3d<float>) + last * sizeof(color255<uint8_t>));
+
+		if (header->directory_offset != data_end || data_end + chunks * sizeof(point_cloud::bounds_t) > m_size)
+			return false;
+
+		m_header = header;
+		m_directory = reinterpret_cast<const point_cloud::bounds_t*>(m_data + header->directory_offset);
+		return true;
+	}
+
+#ifdef _WIN32
+	inline bool Map(const char* path) noexcept
+	{
+		m_handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (m_handle == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(m_handle, &size) || size.QuadPart == 0)
+		{
+			Unmap();
+			return false;
+		}
+
+		m_size = static_cast<size_t>(size.QuadPart);
+		m_mapping = CreateFileMappingA(m_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_mapping)
+			m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+
+		if (!m_data)
+		{
+			Unmap();
+			return false;
+		}
+
+		return true;
+	}
+
+	inline void Unmap() noexcept
+	{
+		if (m_data)
+			UnmapViewOfFile(m_data);
+		if (m_mapping)
+			CloseHandle(m_mapping);
+		if (m_handle != INVALID_HANDLE_VALUE)
+			CloseHandle(m_handle);
+
+		m_data = nullptr;
+		m_size = 0;
+		m_mapping = nullptr;
+		m_handle = INVALID_HANDLE_VALUE;
+	}
+#else
+	inline bool Map(const char* path) noexcept
+	{
+		const int fd = ::open(path, O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		// the mapping stays valid after closing the descriptor
+		struct stat st;
+		void* data = MAP_FAILED;
+		if (::fstat(fd, &st) == 0 && st.st_size > 0)
+			data = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+
+		::close(fd);
+
+		if (data == MAP_FAILED)
+			return false;
+
+		m_data = static_cast<const uint8_t*>(data);
+		m_size = static_cast<size_t>(st.st_size);
+		return true;
+	}
+
+	inline void Unmap() noexcept
+	{
+		if (m_data)
+			::munmap(const_cast<uint8_t*>(m_data), m_size);
+
+		m_data = nullptr;
+		m_size = 0;
+	}
+#endif
+
+private:
+	const uint8_t* m_data = nullptr;
+	size_t m_size = 0;
+
+#ifdef _WIN32
+	HANDLE m_handle = INVALID_HANDLE_VALUE;
+	HANDLE m_mapping = nullptr;
+#endif
+
+	// inside of the mapping, null while closed
+	const point_cloud::header_t* m_header = nullptr;
+	const point_cloud::bounds_t* m_directory = nullptr;
+};
+
+} // namespace detail
+
+//
+// type declarations
+//
+
+using PointCloudWriter = detail::point_cloud_writer;
+using PointCloudReader = detail::point_cloud_reader;
+using PointCloudPoint = detail::point_cloud::point_t;
+
+#endif // POINT_CLOUD_CLASS_H
@@ -0,0 +1,300 @@
+//
+// polygon.h -- convex hulls and batched polygon queries over vector_2d
+//
+
+#ifndef POLYGON_CLASS_H
+#define POLYGON_CLASS_H
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "vector.h"
+#include "parallel.h"
+#include "radix_sort.h"
+
+namespace detail
+{
+
+//
+// polygons are given as arrays of vertices, the closing edge from the last
+// vertex back to the first one is implied. batches of polygons are packed one
+// after another, polygon i spans vertices [offsets[i], offsets[i + 1]).
+//
+template <VectorType T> requires(std::is_floating_point_v<T>)
+class polygon_2d
+{
+public:
+	// points handed to one worker at once
+	static constexpr size_t k_grain = 16 * 1024;
+
+	// points tested against one polygon edge at once
+	static constexpr size_t k_block = 256;
+
+	//
+	// Convex hull
+	//
+
+	// convex hull in counter-clockwise order without collinear points, starting
+	// at the lowest point by x and then y. 'prefilter' first drops points
+	// inside of the octagon spanned by the extreme points (Akl-Toussaint),
+	// which for most inputs leaves only a small part of them for sorting.
+	inline static void ConvexHull(const vector_2d<T>* points, size_t count, std::vector<vector_2d<T>>& hull, bool prefilter = true)
+	{
+		hull.clear();
+
+		std::vector<vector_2d<T>> candidates;
+		if (prefilter && count > 8)
+			Prefilter(points, count, candidates);
+		else
+			candidates.assign(points, points + count);
+
+		SortPoints(candidates);
+
+		const size_t n = candidates.size();
+		if (n < 3)
+		{
+			hull = std::move(candidates);
+			if (hull.size() == 2 && hull[0] == hull[1])
+				hull.pop_back();
+			return;
+		}
+
+		// andrew's monotone chain, lower hull left to right then upper hull back
+		hull.resize(2 * n);
+		size_t k = 0;
+
+		for (size_t i = 0; i < n; i++)
+		{
+			while (k >= 2 && Orientation(hull[k - 2], hull[k - 1], candidates[i]) <= T(0))
+				k--;
+			hull[k++] = candidates[i];
+		}
+
+		for (size_t i = n - 1, lower = k + 1; i-- > 0;)
+		{
+			while (k >= lower && Orientation(hull[k - 2], hull[k - 1], candidates[i]) <= T(0))
+				k--;
+			hull[k++] = candidates[i];
+		}
+
+		// last point is the first one again, all points equal leave two copies
+		hull.resize(k - 1);
+		if (hull.size() == 2 && hull[0] == hull[1])
+			hull.pop_back();
+	}
+
+	//
+	// Area
+	//
+
+	// positive for counter-clockwise polygons, shoelace formula
+	inline static T SignedArea(const vector_2d<T>* vertices, size_t count) noexcept
+	{
+		if (count < 3)
+			return T(0);
+
+		// relative to the first vertex, which keeps the products small
+		T sum = T(0);
+		for (size_t i = 1; i + 1 < count; i++)
+			sum += (vertices[i] - vertices[0]).PerpDot(vertices[i + 1] - vertices[0]);
+
+		return sum * T(0.5);
+	}
+
+	inline static void SignedAreas(const vector_2d<T>* vertices, const uint32_t* offsets, size_t polygons, T* out)
+	{
+		parallel_for(polygons, k_grain / 16, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				out[i] = SignedArea(vertices + offsets[i], offsets[i + 1] - offsets[i]);
+		});
+	}
+
+	//
+	// Point in polygon
+	//
+
+	// even-odd rule, works for concave and self-intersecting polygons. points
+	// exactly on an edge may land on either side.
+	inline static bool Contains(const vector_2d<T>* vertices, size_t count, const vector_2d<T>& point) noexcept
+	{
+		uint8_t inside;
+		ContainsBlock(vertices, count, &point.x, &point.y, 1, &inside);
+		return inside != 0;
+	}
+
+	// inside[i] is 1 for points inside of the polygon, 0 otherwise
+	inline static void Contains(const vector_2d<T>* vertices, size_t count, const vector_2d<T>* points, size_t point_count, uint8_t* inside)
+	{
+		parallel_for(point_count, k_grain, [&](size_t begin, size_t end)
+		{
+			T px[k_block], py[k_block];
+
+			for (size_t lo = begin; lo < end; lo += k_block)
+			{
+				const size_t n = std::min(k_block, end - lo);
+
+				for (size_t i = 0; i < n; i++)
+				{
+					px[i] = points[lo + i].x;
+					py[i] = points[lo + i].y;
+				}
+
+				ContainsBlock(vertices, count, px, py, n, inside + lo);
+			}
+		});
+	}
+
+private:
+	// > 0 when c is to the left of the line from a to b
+	inline static T Orientation(const vector_2d<T>& a, const vector_2d<T>& b, const vector_2d<T>& c) noexcept
+	{
+		return (b - a).PerpDot(c - a);
+	}
+
+	// crossing number test, edge major so that every edge is one branch-free
+	// pass over the block of points
+	inline static void ContainsBlock(const vector_2d<T>* vertices, size_t count, const T* __restrict px, const T* __restrict py,
+									 size_t n, uint8_t* __restrict out) noexcept
+	{
+		uint8_t parity[k_block] = {};
+
+		for (size_t e = 0, prev = count - 1; e < count; prev = e++)
+		{
+			const T ax = vertices[prev].x, ay = vertices[prev].y;
+			const T bx = vertices[e].x, by = vertices[e].y;
+
+			// edge spans the horizontal line through the point, and the point is
+			// left of the crossing. the side test is multiplied out by the sign
+			// of the edge direction, so that no division is needed.
+			const T dx = bx - ax, dy = by - ay;
+			const T sign = dy < T(0) ? T(-1) : T(1);
+
+			for (size_t i = 0; i < n; i++)
+			{
+				const T x = px[i], y = py[i];
+				const bool spans = (ay > y) != (by > y);
+				const bool left = (x - ax) * dy * sign < dx * (y - ay) * sign;
+				parity[i] ^= static_cast<uint8_t>(spans & left);
+			}
+		}
+
+		for (size_t i = 0; i < n; i++)
+			out[i] = parity[i];
+	}
+
+	// lexicographic order by x then y. for float the coordinates are mapped to
+	// unsigned integers with the same order and radix sorted in parallel.
+	inline static void SortPoints(std::vector<vector_2d<T>>& points)
+	{
+		const size_t n = points.size();
+
+		if constexpr (sizeof(T) == sizeof(uint32_t))
+		{
+			std::vector<uint64_t> keys(n);
+			std::vector<vector_2d<T>> sorted(n);
+			std::vector<uint32_t> order(n);
+
+			for (size_t i = 0; i < n; i++)
+			{
+				keys[i] = static_cast<uint64_t>(OrderedBits(points[i].x)) << 32 | OrderedBits(points[i].y);
+				order[i] = static_cast<uint32_t>(i);
+			}
+
+			radix_sort(keys.data(), order.data(), n);
+
+			for (size_t i = 0; i < n; i++)
+				sorted[i] = points[order[i]];
+
+			points = std::move(sorted);
+		}
+		else
+		{
+			std::sort(points.begin(), points.end(), [](const vector_2d<T>& a, const vector_2d<T>& b)
+			{
+				return a.x < b.x || (a.x == b.x && a.y < b.y);
+			});
+		}
+	}
+
+	// flips the sign bit of positive values and all bits of negative ones
+	inline static uint32_t OrderedBits(T v) noexcept
+	{
+		const uint32_t bits = std::bit_cast<uint32_t>(v + T(0)); // -0 becomes +0
+		return bits ^ ((bits >> 31) ? 0xffffffffu : 0x80000000u);
+	}
+
+	// keeps points that are not strictly inside of the octagon through the
+	// extreme points along the axes and the diagonals
+	inline static void Prefilter(const vector_2d<T>* points, size_t count, std::vector<vector_2d<T>>& out)
+	{
+		// left, bottom-left, bottom, bottom-right, right, top-right, top, top-left,
+		// which is counter-clockwise order
+		size_t ext[8] = {};
+		for (size_t i = 1; i < count; i++)
+		{
+			const vector_2d<T>& p = points[i];
+			if (p.x < points[ext[0]].x) ext[0] = i;
+			if (p.x + p.y < points[ext[1]].x + points[ext[1]].y) ext[1] = i;
+			if (p.y < points[ext[2]].y) ext[2] = i;
+			if (p.x - p.y > points[ext[3]].x - points[ext[3]].y) ext[3] = i;
+			if (p.x > points[ext[4]].x) ext[4] = i;
+			if (p.x + p.y > points[ext[5]].x + points[ext[5]].y) ext[5] = i;
+			if (p.y > points[ext[6]].y) ext[6] = i;
+			if (p.x - p.y < points[ext[7]].x - points[ext[7]].y) ext[7] = i;
+		}
+
+		// the same point may be extreme in several directions
+		std::vector<vector_2d<T>> octagon;
+		for (size_t k = 0; k < 8; k++)
+		{
+			if (octagon.empty() || (octagon.back() != points[ext[k]] && octagon.front() != points[ext[k]]))
+				octagon.push_back(points[ext[k]]);
+		}
+
+		if (octagon.size() < 3)
+		{
+			out.assign(points, points + count);
+			return;
+		}
+
+		const size_t chunks = (count + k_grain - 1) / k_grain;
+		std::vector<std::vector<vector_2d<T>>> buckets(chunks);
+
+		parallel_for(count, k_grain, [&](size_t begin, size_t end)
+		{
+			auto& bucket = buckets[begin / k_grain];
+
+			for (size_t i = begin; i < end; i++)
+			{
+				bool inside = true;
+				for (size_t e = 0, prev = octagon.size() - 1; e < octagon.size(); prev = e++)
+					inside &= Orientation(octagon[prev], octagon[e], points[i]) > T(0);
+
+				if (!inside)
+					bucket.push_back(points[i]);
+			}
+		});
+
+		out.clear();
+		for (const auto& bucket : buckets)
+			out.insert(out.end(), bucket.begin(), bucket.end());
+	}
+};
+
+} // namespace detail
+
+//
+// type declarations
+//
+
+using Polygon2D = detail::polygon_2d<float>;
+
+template<typename T> using Polygon2DT = detail::polygon_2d<T>;
+
+#endif // POLYGON_CLASS_H
@@ -0,0 +1,491 @@
+//
+// quantize.h -- palette quantization of color255 images
+//
+
+#ifndef QUANTIZE_CLASS_H
+#define QUANTIZE_CLASS_H
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "color.h"
+#include "color_space.h"
+#include "image.h"
+#include "parallel.h"
+
+namespace detail
+{
+
+//
+// builds palettes of up to 256 colors and maps 8-bit rgb pixels to palette
+// indices. alpha is ignored, palette entries are opaque.
+//
+// colors are compared in ycbcr space with luma weighted twice as much as
+// chroma, which follows perceived differences much closer than plain rgb.
+// the palette is kept as separate coordinate streams, so the nearest entry
+// search runs over a block of pixels per palette entry without branches.
+//
+// palettes are built from a 15-bit histogram of the pixels, so building is
+// independent of the thread count and cheap even for 4K images.
+//
+class palette_quantizer
+{
+public:
+	using pixel_t = color255<uint8_t>;
+
+	enum method_t
+	{
+		k_median_cut,	// split the box with the largest variance at its median
+		k_kmeans,		// median cut refined with lloyd iterations
+	};
+
+	static constexpr size_t k_max_colors = 256;
+
+	// pixels searched at once, coordinate streams of this size stay in L1
+	static constexpr size_t k_block = 256;
+
+	// pixels handed to one worker at once
+	static constexpr size_t k_grain = 64 * 1024;
+
+	//
+	// Construction and destruction
+	//
+
+	palette_quantizer() noexcept = default;
+
+	palette_quantizer(const pixel_t* colors, size_t count)
+	{
+		set_palette(colors, count);
+	}
+
+	//
+	// palette
+	//
+
+	inline void set_palette(const pixel_t* colors, size_t count)
+	{
+		count = std::min(count, k_max_colors);
+
+		m_palette.resize(count);
+		m_y.resize(count);
+		m_cb.resize(count);
+		m_cr.resize(count);
+
+		for (size_t k = 0; k < count; k++)
+		{
+			m_palette[k] = pixel_t(colors[k].r, colors[k].g, colors[k].b, 255);
+			to_space(colors[k].r, colors[k].g, colors[k].b, m_y[k], m_cb[k], m_cr[k]);
+		}
+	}
+
+	inline const std::vector<pixel_t>& palette() const noexcept
+	{
+		return m_palette;
+	}
+
+	inline size_t size() const noexcept
+	{
+		return m_palette.size();
+	}
+
+	// builds a palette of at most 'colors' entries, fewer when the pixels
+	// contain fewer distinct colors
+	inline void build(const pixel_t* pixels, size_t count, size_t colors, method_t method = k_kmeans, uint32_t iterations = 8)
+	{
+		std::vector<bin_t> bins = histogram(pixels, count);
+
+		std::vector<pixel_t> out = median_cut(bins, std::clamp<size_t>(colors, 1, k_max_colors));
+		set_palette(out.data(), out.size());
+
+		if (method == k_kmeans)
+			refine(bins, iterations);
+	}
+
+	inline void build(const image<pixel_t>& img, size_t colors, method_t method = k_kmeans, uint32_t iterations = 8)
+	{
+		// rows are not contiguous, so they are gathered first
+		std::vector<pixel_t> pixels(static_cast<size_t>(img.width()) * img.height());
+		for (uint32_t y = 0; y < img.height(); y++)
+			std::copy_n(img.row(y), img.width(), pixels.data() + static_cast<size_t>(y) * img.width());
+
+		build(pixels.data(), pixels.size(), colors, method, iterations);
+	}
+
+	//
+	// mapping
+	//
+
+	inline uint8_t nearest(const pixel_t& c) const noexcept
+	{
+		float y, cb, cr;
+		to_space(c.r, c.g, c.b, y, cb, cr);
+
+		uint8_t index;
+		search(&y, &cb, &cr, 1, &index);
+		return index;
+	}
+
+	inline void map(const pixel_t* pixels, size_t count, uint8_t* indices) const
+	{
+		if (m_palette.empty())
+			return;
+
+		parallel_for(count, k_grain, [&](size_t begin, size_t end)
+		{
+			float y[k_block], cb[k_block], cr[k_block];
+
+			for (size_t lo = begin; lo < end; lo += k_block)
+			{
+				const size_t n = std::min(k_block, end - lo);
+
+				for (size_t i = 0; i < n; i++)
+					to_space(pixels[lo + i].r, pixels[lo + i].g, pixels[lo + i].b, y[i], cb[i], cr[i]);
+
+				search(y, cb, cr, n, indices + lo);
+			}
+		});
+	}
+
+	// writes width * height indices row by row. 'dither' is the amplitude of
+	// the ordered 8x8 bayer dither in 8-bit units, 0 disables dithering.
+	inline void map(const image<pixel_t>& img, uint8_t* indices, float dither = 0.0f) const
+	{
+		if (m_palette.empty() || img.is_empty())
+			return;
+
+		const uint32_t width = img.width();
+		const size_t grain = std::max<size_t>(1, k_grain / width);
+
+		parallel_for(img.height(), grain, [&](size_t begin, size_t end)
+		{
+			float y[k_block], cb[k_block], cr[k_block];
+
+			for (size_t row = begin; row < end; row++)
+			{
+				const pixel_t* src = img.row(static_cast<uint32_t>(row));
+				uint8_t* dst = indices + row * width;
+				const uint8_t* rank = k_bayer[row & 7];
+
+				for (uint32_t lo = 0; lo < width; lo += k_block)
+				{
+					const size_t n = std::min<size_t>(k_block, width - lo);
+
+					for (size_t i = 0; i < n; i++)
+					{
+						// threshold centered on zero, in (-0.5, 0.5)
+						const float offset = ((rank[(lo + i) & 7] + 0.5f) / 64.0f - 0.5f) * dither;
+						to_space(dither_channel(src[lo + i].r, offset), dither_channel(src[lo + i].g, offset),
+								 dither_channel(src[lo + i].b, offset), y[i], cb[i], cr[i]);
+					}
+
+					search(y, cb, cr, n, dst + lo);
+				}
+			}
+		});
+	}
+
+	// palette lookup of previously mapped indices
+	inline void expand(const uint8_t* indices, size_t count, pixel_t* out) const noexcept
+	{
+		for (size_t i = 0; i < count; i++)
+			out[i] = m_palette[indices[i]];
+	}
+
+private:
+	struct bin_t
+	{
+		uint64_t count, r, g, b;
+		float y, cb, cr;
+	};
+
+	static constexpr int k_histogram_bits = 5;
+	static constexpr size_t k_histogram_size = size_t(1) << (3 * k_histogram_bits);
+
+	// luma scale, squared distances then weight luma twice as much as chroma
+	static constexpr float k_luma_scale = 1.41421356f;
+
+	// 8x8 bayer matrix, ranks of the thresholds
+	static constexpr uint8_t k_bayer[8][8] =
+	{
+		{  0, 32,  8, 40,  2, 34, 10, 42 },
+		{ 48, 16, 56, 24, 50, 18, 58, 26 },
+		{ 12, 44,  4, 36, 14, 46,  6, 38 },
+		{ 60, 28, 52, 20, 62, 30, 54, 22 },
+		{  3, 35, 11, 43,  1, 33,  9, 41 },
+		{ 51, 19, 59, 27, 49, 17, 57, 25 },
+		{ 15, 47,  7, 39, 13, 45,  5, 37 },
+		{ 63, 31, 55, 23, 61, 29, 53, 21 },
+	};
+
+	static inline void to_space(float r, float g, float b, float& y, float& cb, float& cr) noexcept
+	{
+		const color<float> c = color_space<float>::rgb_to_ycbcr(color<float>(r, g, b, 1.0f));
+
+		y = c.r * k_luma_scale;
+		cb = c.g;
+		cr = c.b;
+	}
+
+	static inline float dither_channel(uint8_t c, float offset) noexcept
+	{
+		return std::clamp(c + offset, 0.0f, 255.0f);
+	}
+
+	static inline pixel_t bin_mean(const bin_t& bin) noexcept
+	{
+		const uint64_t n = bin.count, h = n / 2;
+		return pixel_t(static_cast<uint8_t>((bin.r + h) / n), static_cast<uint8_t>((bin.g + h) / n), static_cast<uint8_t>((bin.b + h) / n), 255);
+	}
+
+	// nearest palette entry for n points given by coordinate streams, ties go
+	// to the lower index
+	inline void search(const float* __restrict y, const float* __restrict cb, const float* __restrict cr,
+					   size_t n, uint8_t* __restrict out) const noexcept
+	{
+		float best[k_block];
+		uint32_t index[k_block];
+
+		for (size_t i = 0; i < n; i++)
+		{
+			best[i] = std::numeric_limits<float>::max();
+			index[i] = 0;
+		}
+
+		for (size_t k = 0; k < m_palette.size(); k++)
+		{
+			const float ky = m_y[k], kcb = m_cb[k], kcr = m_cr[k];
+			const uint32_t kk = static_cast<uint32_t>(k);
+
+			for (size_t i = 0; i < n; i++)
+			{
+				const float dy = y[i] - ky, dcb = cb[i] - kcb, dcr = cr[i] - kcr;
+				const float d = dy * dy + dcb * dcb + dcr * dcr;
+
+				// index is selected through a mask, a conditional store would
+				// keep the loop from being vectorized
+				const bool closer = d < best[i];
+				index[i] += (kk - index[i]) & (0u - closer);
+				best[i] = closer ? d : best[i];
+			}
+		}
+
+		for (size_t i = 0; i < n; i++)
+			out[i] = static_cast<uint8_t>(index[i]);
+	}
+
+	// non-empty bins of a 5-bit per channel histogram, every worker fills its
+	// own table which are then merged
+	static inline std::vector<bin_t> histogram(const pixel_t* pixels, size_t count)
+	{
+		constexpr int shift = 8 - k_histogram_bits;
+
+		std::vector<std::vector<bin_t>> tables(parallel_worker_count(count, k_grain));
+
+		parallel_for(count, k_grain, [&](size_t begin, size_t end, unsigned worker)
+		{
+			auto& table = tables[worker];
+			if (table.empty())
+				table.resize(k_histogram_size, bin_t{});
+
+			for (size_t i = begin; i < end; i++)
+			{
+				const pixel_t& p = pixels[i];
+				bin_t& bin = table[(p.r >> shift) << (2 * k_histogram_bits) | (p.g >> shift) << k_histogram_bits | (p.b >> shift)];
+
+				bin.count++;
+				bin.r += p.r;
+				bin.g += p.g;
+				bin.b += p.b;
+			}
+		});
+
+		std::vector<bin_t> out;
+		for (size_t i = 0; i < k_histogram_size; i++)
+		{
+			bin_t sum{};
+			for (const auto& table : tables)
+			{
+				if (table.empty())
+					continue;
+
+				sum.count += table[i].count;
+				sum.r += table[i].r;
+				sum.g += table[i].g;
+				sum.b += table[i].b;
+			}
+
+			if (sum.count == 0)
+				continue;
+
+			const pixel_t mean = bin_mean(sum);
+			to_space(mean.r, mean.g, mean.b, sum.y, sum.cb, sum.cr);
+			out.push_back(sum);
+		}
+
+		return out;
+	}
+
+	// splits boxes of bins until there are 'colors' of them, reorders bins
+	static inline std::vector<pixel_t> median_cut(std::vector<bin_t>& bins, size_t colors)
+	{
+		struct box_t
+		{
+			size_t begin, end;
+			int axis;
+			double score;
+		};
+
+		static constexpr float bin_t::* axes[3] = { &bin_t::y, &bin_t::cb, &bin_t::cr };
+
+		// axis with the largest weighted variance and the variance itself
+		auto measure = [&](box_t& box)
+		{
+			box.axis = 0;
+			box.score = 0.0;
+
+			if (box.end - box.begin < 2)
+				return;
+
+			for (int a = 0; a < 3; a++)
+			{
+				double n = 0.0, sum = 0.0, sum_sqr = 0.0;
+				for (size_t i = box.begin; i < box.end; i++)
+				{
+					const double v = bins[i].*axes[a], w = static_cast<double>(bins[i].count);
+					n += w;
+					sum += w * v;
+					sum_sqr += w * v * v;
+				}
+
+				const double score = sum_sqr - sum * sum / n;
+				if (score > box.score)
+				{
+					box.axis = a;
+					box.score = score;
+				}
+			}
+		};
+
+		std::vector<box_t> boxes;
+		if (!bins.empty())
+		{
+			boxes.push_back({ 0, bins.size(), 0, 0.0 });
+			measure(boxes.back());
+		}
+
+		while (boxes.size() < colors)
+		{
+			auto it = std::max_element(boxes.begin(), boxes.end(), [](const box_t& a, const box_t& b) { return a.score < b.score; });
+			if (it == boxes.end() || it->score <= 0.0)
+				break;
+
+			box_t box = *it;
+			const auto axis = axes[box.axis];
+
+			std::stable_sort(bins.begin() + box.begin, bins.begin() + box.end, [axis](const bin_t& a, const bin_t& b) { return a.*axis < b.*axis; });
+
+			// first bin past half of the pixels, both halves keep at least one
+			uint64_t total = 0, acc = 0;
+			for (size_t i = box.begin; i < box.end; i++)
+				total += bins[i].count;
+
+			size_t split = box.begin + 1;
+			for (size_t i = box.begin; i < box.end - 1; i++)
+			{
+				acc += bins[i].count;
+				split = i + 1;
+				if (acc * 2 >= total)
+					break;
+			}
+
+			box_t lo = { box.begin, split, 0, 0.0 }, hi = { split, box.end, 0, 0.0 };
+			measure(lo);
+			measure(hi);
+
+			*it = lo;
+			boxes.push_back(hi);
+		}
+
+		std::vector<pixel_t> out;
+		for (const auto& box : boxes)
+		{
+			bin_t sum{};
+			for (size_t i = box.begin; i < box.end; i++)
+			{
+				sum.count += bins[i].count;
+				sum.r += bins[i].r;
+				sum.g += bins[i].g;
+				sum.b += bins[i].b;
+			}
+
+			out.push_back(bin_mean(sum));
+		}
+
+		return out;
+	}
+
+	// lloyd iterations over the histogram bins, every bin weighted by its
+	// pixel count. stops early once the palette settles.
+	inline void refine(const std::vector<bin_t>& bins, uint32_t iterations)
+	{
+		std::vector<float> y(bins.size()), cb(bins.size()), cr(bins.size());
+		for (size_t i = 0; i < bins.size(); i++)
+		{
+			y[i] = bins[i].y;
+			cb[i] = bins[i].cb;
+			cr[i] = bins[i].cr;
+		}
+
+		std::vector<uint8_t> assigned(bins.size());
+
+		for (uint32_t it = 0; it < iterations; it++)
+		{
+			parallel_for(bins.size(), k_block * 16, [&](size_t begin, size_t end)
+			{
+				for (size_t lo = begin; lo < end; lo += k_block)
+					search(&y[lo], &cb[lo], &cr[lo], std::min(k_block, end - lo), &assigned[lo]);
+			});
+
+			std::vector<bin_t> sums(m_palette.size(), bin_t{});
+			for (size_t i = 0; i < bins.size(); i++)
+			{
+				bin_t& sum = sums[assigned[i]];
+				sum.count += bins[i].count;
+				sum.r += bins[i].r;
+				sum.g += bins[i].g;
+				sum.b += bins[i].b;
+			}
+
+			// empty clusters keep their previous color
+			std::vector<pixel_t> next = m_palette;
+			for (size_t k = 0; k < next.size(); k++)
+			{
+				if (sums[k].count)
+					next[k] = bin_mean(sums[k]);
+			}
+
+			if (next == m_palette)
+				break;
+
+			set_palette(next.data(), next.size());
+		}
+	}
+
+private:
+	std::vector<pixel_t> m_palette;
+	std::vector<float> m_y, m_cb, m_cr;
+};
+
+} // namespace detail
+
+//
+// type declarations
+//
+
+using CPaletteQuantizer = detail::palette_quantizer;
+
+#endif // QUANTIZE_CLASS_H
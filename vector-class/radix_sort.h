@@ -0,0 +1,121 @@
+//
+// radix_sort.h -- parallel LSD radix sort of key/value pairs
+//
+
+#ifndef RADIX_SORT_CLASS_H
+#define RADIX_SORT_CLASS_H
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "parallel.h"
+
+namespace detail
+{
+
+// elements counted and scattered by one task
+inline constexpr size_t k_radix_grain = 64 * 1024;
+
+//
+// sorts 'keys' in ascending order and moves 'values' along, equal keys keep
+// their relative order. only the low 'bits' bits of the keys are looked at.
+//
+// every pass handles 8 bits. the input is cut into fixed chunks that are
+// counted and scattered in parallel, chunk offsets come from a prefix sum in
+// chunk order, so the result does not depend on the thread count. passes
+// where all keys share the same digit are skipped.
+//
+template<typename K, typename V> requires(std::is_unsigned_v<K> && std::is_trivially_copyable_v<V>)
+inline void radix_sort(K* keys, V* values, size_t count, uint32_t bits = sizeof(K) * 8)
+{
+	constexpr size_t radix = 256;
+
+	if (count < 2)
+		return;
+
+	const size_t chunks = (count + k_radix_grain - 1) / k_radix_grain;
+
+	std::vector<K> key_scratch(count);
+	std::vector<V> value_scratch(count);
+	std::vector<size_t> offsets(chunks * radix);
+
+	K* src_keys = keys;
+	V* src_values = values;
+	K* dst_keys = key_scratch.data();
+	V* dst_values = value_scratch.data();
+
+	bits = std::min<uint32_t>(bits, sizeof(K) * 8);
+
+	for (uint32_t shift = 0; shift < bits; shift += 8)
+	{
+		// digit histogram of every chunk
+		parallel_for(chunks, 1, [&](size_t begin, size_t end)
+		{
+			for (size_t c = begin; c < end; c++)
+			{
+				size_t* hist = &offsets[c * radix];
+				std::fill(hist, hist + radix, size_t(0));
+
+				const size_t hi = std::min(count, (c + 1) * k_radix_grain);
+				for (size_t i = c * k_radix_grain; i < hi; i++)
+					hist[(src_keys[i] >> shift) & (radix - 1)]++;
+			}
+		});
+
+		// turn the counts into output positions, digit major then chunk
+		size_t sum = 0;
+		bool trivial = false;
+
+		for (size_t d = 0; d < radix; d++)
+		{
+			const size_t first = sum;
+
+			for (size_t c = 0; c < chunks; c++)
+			{
+				const size_t n = offsets[c * radix + d];
+				offsets[c * radix + d] = sum;
+				sum += n;
+			}
+
+			trivial |= sum - first == count;
+		}
+
+		if (trivial)
+			continue;
+
+		parallel_for(chunks, 1, [&](size_t begin, size_t end)
+		{
+			for (size_t c = begin; c < end; c++)
+			{
+				size_t* pos = &offsets[c * radix];
+
+				const size_t hi = std::min(count, (c + 1) * k_radix_grain);
+				for (size_t i = c * k_radix_grain; i < hi; i++)
+				{
+					const size_t at = pos[(src_keys[i] >> shift) & (radix - 1)]++;
+					dst_keys[at] = src_keys[i];
+					dst_values[at] = src_values[i];
+				}
+			}
+		});
+
+		std::swap(src_keys, dst_keys);
+		std::swap(src_values, dst_values);
+	}
+
+	// odd amount of passes left the result in the scratch buffers
+	if (src_keys != keys)
+	{
+		std::copy_n(src_keys, count, keys);
+		std::copy_n(src_values, count, values);
+	}
+}
+
+} // namespace detail
+
+#endif // RADIX_SORT_CLASS_H
@@ -0,0 +1,272 @@
+//
+// ray.h -- ray type and packet intersection kernels
+//
+
+#ifndef RAY_CLASS_H
+#define RAY_CLASS_H
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "vector.h"
+#include "bounds.h"
+#include "parallel.h"
+
+namespace detail
+{
+
+//
+// ray with origin and direction, direction does not have to be normalized,
+// hit distances are then expressed in multiples of its length
+//
+template <VectorType T> requires(std::is_floating_point_v<T>)
+class ray
+{
+public:
+	constexpr ray() noexcept = default;
+
+	constexpr ray(const vector_3d<T>& _origin, const vector_3d<T>& _direction) noexcept :
+		origin(_origin),
+		direction(_direction)
+	{
+	}
+
+	constexpr inline vector_3d<T> PointAt(T t) const noexcept
+	{
+		return origin + direction * t;
+	}
+
+	// scalar moller-trumbore, returns true when the triangle is hit in front of
+	// the origin closer than 'tmax'. fills distance and barycentrics on hit.
+	constexpr inline bool IntersectTriangle(const vector_3d<T>& v0, const vector_3d<T>& v1, const vector_3d<T>& v2,
+											T& t, T& u, T& v, T tmax = std::numeric_limits<T>::infinity()) const noexcept
+	{
+		const vector_3d<T> e1 = v1 - v0, e2 = v2 - v0;
+
+		vector_3d<T> pvec;
+		pvec.CrossProduct(direction, e2);
+
+		const T det = e1.Dot(pvec);
+		if (det > -k_epsilon && det < k_epsilon)
+			return false;
+
+		const T inv_det = T(1) / det;
+		const vector_3d<T> tvec = origin - v0;
+
+		u = tvec.Dot(pvec) * inv_det;
+		if (u < T(0) || u > T(1))
+			return false;
+
+		vector_3d<T> qvec;
+		qvec.CrossProduct(tvec, e1);
+
+		v = direction.Dot(qvec) * inv_det;
+		if (v < T(0) || u + v > T(1))
+			return false;
+
+		t = e2.Dot(qvec) * inv_det;
+		return t > T(0) && t < tmax;
+	}
+
+public:
+	// determinant threshold under which the ray is considered parallel
+	static constexpr T k_epsilon = T(1e-8);
+
+	vector_3d<T> origin, direction;
+};
+
+//
+// closest hit record, prim is UINT32_MAX when nothing was hit
+//
+template <VectorType T>
+struct ray_hit
+{
+	T t = std::numeric_limits<T>::infinity(), u = T(0), v = T(0);
+	uint32_t prim = std::numeric_limits<uint32_t>::max();
+};
+
+//
+// N rays stored lane by lane, so that every kernel below is a loop over N
+// lanes the compiler turns into 4-wide (N = 4) or 8-wide (N = 8) vector code
+//
+template <VectorType T, size_t N> requires(std::is_floating_point_v<T>)
+struct ray_packet
+{
+	T ox[N], oy[N], oz[N];
+	T dx[N], dy[N], dz[N];
+	T inv_dx[N], inv_dy[N], inv_dz[N];
+
+	// number of valid lanes, the rest replicate the last valid ray
+	size_t count = 0;
+
+	// fills packet from up to N rays
+	inline void Load(const ray<T>* rays, size_t n) noexcept
+	{
+		count = std::min(n, N);
+		if (count == 0)
+			return;
+
+		for (size_t i = 0; i < N; i++)
+		{
+			const auto& r = rays[std::min(i, count - 1)];
+
+			ox[i] = r.origin.x; oy[i] = r.origin.y; oz[i] = r.origin.z;
+			dx[i] = r.direction.x; dy[i] = r.direction.y; dz[i] = r.direction.z;
+
+			inv_dx[i] = T(1) / dx[i];
+			inv_dy[i] = T(1) / dy[i];
+			inv_dz[i] = T(1) / dz[i];
+		}
+	}
+};
+
+template <VectorType T, size_t N>
+struct hit_packet
+{
+	T t[N], u[N], v[N];
+	uint32_t prim[N];
+
+	// resets lanes to no hit, limited to distance 'tmax'
+	inline void Reset(T tmax = std::numeric_limits<T>::infinity()) noexcept
+	{
+		for (size_t i = 0; i < N; i++)
+		{
+			t[i] = tmax;
+			u[i] = v[i] = T(0);
+			prim[i] = std::numeric_limits<uint32_t>::max();
+		}
+	}
+};
+
+//
+// triangles stored as first vertex and two edges, one stream per component
+//
+template <VectorType T> requires(std::is_floating_point_v<T>)
+class triangle_batch
+{
+public:
+	inline size_t Size() const noexcept
+	{
+		return m_v0x.size();
+	}
+
+	inline void Reserve(size_t count)
+	{
+		for (auto* s : { &m_v0x, &m_v0y, &m_v0z, &m_e1x, &m_e1y, &m_e1z, &m_e2x, &m_e2y, &m_e2z })
+			s->reserve(count);
+	}
+
+	inline void Add(const vector_3d<T>& v0, const vector_3d<T>& v1, const vector_3d<T>& v2)
+	{
+		const vector_3d<T> e1 = v1 - v0, e2 = v2 - v0;
+
+		m_v0x.push_back(v0.x); m_v0y.push_back(v0.y); m_v0z.push_back(v0.z);
+		m_e1x.push_back(e1.x); m_e1y.push_back(e1.y); m_e1z.push_back(e1.z);
+		m_e2x.push_back(e2.x); m_e2y.push_back(e2.y); m_e2z.push_back(e2.z);
+	}
+
+	// moller-trumbore of all triangles against all lanes of the packet, keeps
+	// the closest hit per lane in 'hits'. the lane loop has no branches: the
+	// tests are combined with '&' rather than '&&' and the hit is blended in
+	// with bit masks, as compares and selects around arithmetic would turn
+	// into jumps under trapping math and keep the loop scalar.
+	template <size_t N>
+	inline void Intersect(const ray_packet<T, N>& p, hit_packet<T, N>& hits) const noexcept
+	{
+		T* __restrict hit_t = hits.t;
+		T* __restrict hit_u = hits.u;
+		T* __restrict hit_v = hits.v;
+		uint32_t* __restrict hit_prim = hits.prim;
+
+		for (size_t k = 0; k < Size(); k++)
+		{
+			const T v0x = m_v0x[k], v0y = m_v0y[k], v0z = m_v0z[k];
+			const T e1x = m_e1x[k], e1y = m_e1y[k], e1z = m_e1z[k];
+			const T e2x = m_e2x[k], e2y = m_e2y[k], e2z = m_e2z[k];
+
+			for (size_t i = 0; i < N; i++)
+			{
+				// pvec = dir x e2
+				const T px = vector_diff_of_products(p.dy[i], e2z, p.dz[i], e2y);
+				const T py = vector_diff_of_products(p.dz[i], e2x, p.dx[i], e2z);
+				const T pz = vector_diff_of_products(p.dx[i], e2y, p.dy[i], e2x);
+
+				const T det = vector_fma(e1z, pz, vector_fma(e1y, py, e1x * px));
+				const T inv_det = T(1) / det;
+
+				// tvec = origin - v0
+				const T tx = p.ox[i] - v0x, ty = p.oy[i] - v0y, tz = p.oz[i] - v0z;
+				const T u = vector_fma(tz, pz, vector_fma(ty, py, tx * px)) * inv_det;
+
+				// qvec = tvec x e1
+				const T qx = vector_diff_of_products(ty, e1z, tz, e1y);
+				const T qy = vector_diff_of_products(tz, e1x, tx, e1z);
+				const T qz = vector_diff_of_products(tx, e1y, ty, e1x);
+
+				const T v = vector_fma(p.dz[i], qz, vector_fma(p.dy[i], qy, p.dx[i] * qx)) * inv_det;
+				const T t = vector_fma(e2z, qz, vector_fma(e2y, qy, e2x * qx)) * inv_det;
+
+				const bool hit = ((det > ray<T>::k_epsilon) | (det < -ray<T>::k_epsilon)) &
+					(u >= T(0)) & (v >= T(0)) & (u + v <= T(1)) & (t > T(0)) & (t < hit_t[i]);
+
+				hit_t[i] = vector_keep_if(hit, t) + vector_keep_if(!hit, hit_t[i]);
+				hit_u[i] = vector_keep_if(hit, u) + vector_keep_if(!hit, hit_u[i]);
+				hit_v[i] = vector_keep_if(hit, v) + vector_keep_if(!hit, hit_v[i]);
+				hit_prim[i] ^= (hit_prim[i] ^ static_cast<uint32_t>(k)) & (0u - hit);
+			}
+		}
+	}
+
+	// closest hit for every ray, rays are packed by eight and the packets are
+	// distributed over worker threads
+	inline void Trace(const ray<T>* rays, size_t count, ray_hit<T>* out) const
+	{
+		constexpr size_t N = 8;
+
+		parallel_for((count + N - 1) / N, 256, [&](size_t begin, size_t end)
+		{
+			ray_packet<T, N> packet;
+			hit_packet<T, N> hits;
+
+			for (size_t b = begin; b < end; b++)
+			{
+				const size_t first = b * N;
+
+				packet.Load(rays + first, count - first);
+				hits.Reset();
+				Intersect(packet, hits);
+
+				for (size_t i = 0; i < packet.count; i++)
+					out[first + i] = { hits.t[i], hits.u[i], hits.v[i], hits.prim[i] };
+			}
+		});
+	}
+
+private:
+	std::vector<T> m_v0x, m_v0y, m_v0z;
+	std::vector<T> m_e1x, m_e1y, m_e1z;
+	std::vector<T> m_e2x, m_e2y, m_e2z;
+};
+
+} // namespace detail
+
+//
+// type declarations
+//
+
+using Ray = detail::ray<float>;
+using RayHit = detail::ray_hit<float>;
+using TriangleBatch = detail::triangle_batch<float>;
+
+template<size_t N> using RayPacket = detail::ray_packet<float, N>;
+template<size_t N> using HitPacket = detail::hit_packet<float, N>;
+
+template<typename T> using RayT = detail::ray<T>;
+template<typename T> using TriangleBatchT = detail::triangle_batch<T>;
+
+#endif // RAY_CLASS_H
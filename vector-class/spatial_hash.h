@@ -0,0 +1,456 @@
+//
+// spatial_hash.h -- uniform hash grid broadphase for vector_3d positions
+//
+
+#ifndef SPATIAL_HASH_CLASS_H
+#define SPATIAL_HASH_CLASS_H
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "vector.h"
+#include "parallel.h"
+
+namespace detail
+{
+
+//
+// objects are bucketed into cubic cells of 'cell size' by their position.
+// occupied cells live in an open addressing table keyed by the packed cell
+// coordinates, every cell links its objects into a list, so inserting,
+// moving and removing an object never allocates once the tables have grown.
+//
+// FindPairs() reports every pair of objects closer than the given radius,
+// which must not exceed the cell size. each cell is paired with itself and
+// with 13 of its 26 neighbours, so every pair of cells is visited once.
+//
+template <VectorType T> requires(std::is_floating_point_v<T>)
+class spatial_hash
+{
+public:
+	static constexpr uint32_t k_invalid = UINT32_MAX;
+
+	// table slots handed to one worker at once
+	static constexpr size_t k_grain = 1024;
+
+	struct pair_t
+	{
+		uint32_t a, b;	// a < b
+	};
+
+	//
+	// Construction and destruction
+	//
+
+	spatial_hash(T cell_size = T(1)) noexcept :
+		m_cell_size(cell_size),
+		m_inv_cell_size(T(1) / cell_size)
+	{
+	}
+
+	inline T CellSize() const noexcept
+	{
+		return m_cell_size;
+	}
+
+	// objects currently in the grid
+	inline size_t Size() const noexcept
+	{
+		return m_size;
+	}
+
+	inline bool IsValid(uint32_t handle) const noexcept
+	{
+		return handle < m_cell.size() && m_cell[handle] != k_invalid;
+	}
+
+	inline const vector_3d<T>& GetPosition(uint32_t handle) const noexcept
+	{
+		return m_pos[handle];
+	}
+
+	//
+	// Objects
+	//
+
+	// returns handle of the new object, handles of removed objects are reused
+	inline uint32_t Insert(const vector_3d<T>& pos)
+	{
+		uint32_t handle;
+		if (!m_free.empty())
+		{
+			handle = m_free.back();
+			m_free.pop_back();
+		}
+		else
+		{
+			handle = static_cast<uint32_t>(m_pos.size());
+			m_pos.emplace_back();
+			m_cell.push_back(k_invalid);
+			m_next.push_back(k_invalid);
+			m_prev.push_back(k_invalid);
+		}
+
+		m_pos[handle] = pos;
+		Link(handle, Acquire(CellKey(pos)));
+		m_size++;
+
+		return handle;
+	}
+
+	inline void Move(uint32_t handle, const vector_3d<T>& pos)
+	{
+		m_pos[handle] = pos;
+
+		const uint64_t key = CellKey(pos);
+		if (m_slots[m_cell[handle]].key == key)
+			return;
+
+		// the object is out of the grid while the cell is acquired, in case
+		// the table gets rebuilt
+		Unlink(handle);
+		m_cell[handle] = k_invalid;
+		Link(handle, Acquire(key));
+	}
+
+	inline void Remove(uint32_t handle)
+	{
+		Unlink(handle);
+		m_cell[handle] = k_invalid;
+		m_free.push_back(handle);
+		m_size--;
+	}
+
+	inline void Clear() noexcept
+	{
+		m_pos.clear();
+		m_cell.clear();
+		m_next.clear();
+		m_prev.clear();
+		m_free.clear();
+		m_slots.clear();
+		m_occupied = 0;
+		m_size = 0;
+	}
+
+	//
+	// Queries
+	//
+
+	// handles of all objects closer than 'radius' to 'point'
+	inline void FindNear(const vector_3d<T>& point, T radius, std::vector<uint32_t>& out) const
+	{
+		out.clear();
+		if (m_slots.empty())
+			return;
+
+		const int32_t cx = Coord(point.x), cy = Coord(point.y), cz = Coord(point.z);
+		const int32_t reach = static_cast<int32_t>(std::ceil(radius * m_inv_cell_size));
+		const T radius_sqr = radius * radius;
+
+		for (int32_t z = cz - reach; z <= cz + reach; z++)
+		{
+			for (int32_t y = cy - reach; y <= cy + reach; y++)
+			{
+				for (int32_t x = cx - reach; x <= cx + reach; x++)
+				{
+					const uint32_t slot = Find(PackKey(x, y, z));
+					if (slot == k_invalid)
+						continue;
+
+					for (uint32_t i = m_slots[slot].head; i != k_invalid; i = m_next[i])
+					{
+						if ((m_pos[i] - point).LengthSqr() < radius_sqr)
+							out.push_back(i);
+					}
+				}
+			}
+		}
+	}
+
+	// all pairs closer than 'radius' (at most the cell size), sorted by the
+	// cell of the first object. the order only depends on the grid contents,
+	// not on the thread count.
+	inline void FindPairs(T radius, std::vector<pair_t>& out) const
+	{
+		// the half stencil only reaches the neighbouring cells
+		assert(radius <= m_cell_size);
+
+		out.clear();
+
+		const size_t slots = m_slots.size();
+		const size_t chunks = (slots + k_grain - 1) / k_grain;
+		const T radius_sqr = radius * radius;
+
+		// the lists are scattered over memory, so the objects are first copied
+		// cell by cell into packed arrays. start[s] is the first object of slot
+		// s, the cell pair loops then run over contiguous ranges.
+		std::vector<uint32_t> start(slots + 1, 0);
+
+		parallel_for(slots, k_grain, [&](size_t begin, size_t end)
+		{
+			for (size_t s = begin; s < end; s++)
+			{
+				for (uint32_t i = m_slots[s].head; i != k_invalid; i = m_next[i])
+					start[s + 1]++;
+			}
+		});
+
+		for (size_t s = 0; s < slots; s++)
+			start[s + 1] += start[s];
+
+		std::vector<vector_3d<T>> pos(m_size);
+		std::vector<uint32_t> handle(m_size);
+
+		parallel_for(slots, k_grain, [&](size_t begin, size_t end)
+		{
+			for (size_t s = begin; s < end; s++)
+			{
+				uint32_t at = start[s];
+				for (uint32_t i = m_slots[s].head; i != k_invalid; i = m_next[i], at++)
+				{
+					pos[at] = m_pos[i];
+					handle[at] = i;
+				}
+			}
+		});
+
+		std::vector<std::vector<pair_t>> buckets(chunks);
+
+		parallel_for(slots, k_grain, [&](size_t begin, size_t end)
+		{
+			auto& bucket = buckets[begin / k_grain];
+
+			auto test = [&](uint32_t i, uint32_t j)
+			{
+				if ((pos[i] - pos[j]).LengthSqr() < radius_sqr)
+					bucket.push_back({ std::min(handle[i], handle[j]), std::max(handle[i], handle[j]) });
+			};
+
+			for (size_t s = begin; s < end; s++)
+			{
+				const uint32_t lo = start[s], hi = start[s + 1];
+				if (lo == hi)
+					continue;
+
+				// within the cell
+				for (uint32_t i = lo; i < hi; i++)
+				{
+					for (uint32_t j = i + 1; j < hi; j++)
+						test(i, j);
+				}
+
+				int32_t cx, cy, cz;
+				UnpackKey(m_slots[s].key, cx, cy, cz);
+
+				for (const auto& d : k_half_neighbours)
+				{
+					const uint32_t other = Find(PackKey(cx + d[0], cy + d[1], cz + d[2]));
+					if (other == k_invalid)
+						continue;
+
+					for (uint32_t i = lo; i < hi; i++)
+					{
+						for (uint32_t j = start[other]; j < start[other + 1]; j++)
+							test(i, j);
+					}
+				}
+			}
+		});
+
+		size_t total = 0;
+		for (const auto& bucket : buckets)
+			total += bucket.size();
+
+		out.reserve(total);
+		for (const auto& bucket : buckets)
+			out.insert(out.end(), bucket.begin(), bucket.end());
+	}
+
+private:
+	struct slot_t
+	{
+		uint64_t key = k_empty;
+		uint32_t head = k_invalid;
+	};
+
+	// cell coordinates are packed into 21 bits each, the top bit is never set
+	static constexpr uint64_t k_empty = UINT64_MAX;
+	static constexpr int32_t k_coord_limit = (1 << 20) - 1;
+
+	// neighbour offsets with the first nonzero component positive, together
+	// with their mirror images they cover all 26 neighbours
+	static constexpr int32_t k_half_neighbours[13][3] =
+	{
+		{ 1, -1, -1 }, { 1, -1, 0 }, { 1, -1, 1 },
+		{ 1, 0, -1 }, { 1, 0, 0 }, { 1, 0, 1 },
+		{ 1, 1, -1 }, { 1, 1, 0 }, { 1, 1, 1 },
+		{ 0, 1, -1 }, { 0, 1, 0 }, { 0, 1, 1 },
+		{ 0, 0, 1 },
+	};
+
+	// cells far from the origin are clamped, positions there share border cells
+	inline int32_t Coord(T v) const noexcept
+	{
+		T c = std::floor(v * m_inv_cell_size);
+		c = c > T(-k_coord_limit) ? c : T(-k_coord_limit);
+		c = c < T(k_coord_limit) ? c : T(k_coord_limit);
+		return static_cast<int32_t>(c);
+	}
+
+	inline uint64_t CellKey(const vector_3d<T>& pos) const noexcept
+	{
+		return PackKey(Coord(pos.x), Coord(pos.y), Coord(pos.z));
+	}
+
+	static inline uint64_t PackKey(int32_t x, int32_t y, int32_t z) noexcept
+	{
+		constexpr uint64_t mask = (1ull << 21) - 1;
+		return (static_cast<uint64_t>(x) & mask) | (static_cast<uint64_t>(y) & mask) << 21 | (static_cast<uint64_t>(z) & mask) << 42;
+	}
+
+	static inline void UnpackKey(uint64_t key, int32_t& x, int32_t& y, int32_t& z) noexcept
+	{
+		// sign extension of the 21 bit fields
+		x = static_cast<int32_t>(static_cast<uint32_t>(key << 11) & 0xfffff800u) >> 11;
+		y = static_cast<int32_t>(static_cast<uint32_t>(key >> 10) & 0xfffff800u) >> 11;
+		z = static_cast<int32_t>(static_cast<uint32_t>(key >> 31) & 0xfffff800u) >> 11;
+	}
+
+	inline size_t Hash(uint64_t key) const noexcept
+	{
+		return static_cast<size_t>((key * 0x9e3779b97f4a7c15ull) >> 32) & (m_slots.size() - 1);
+	}
+
+	// slot of the cell or k_invalid, linear probing
+	inline uint32_t Find(uint64_t key) const noexcept
+	{
+		for (size_t s = Hash(key);; s = (s + 1) & (m_slots.size() - 1))
+		{
+			if (m_slots[s].key == key)
+				return static_cast<uint32_t>(s);
+
+			if (m_slots[s].key == k_empty)
+				return k_invalid;
+		}
+	}
+
+	// slot of the cell, created when missing. empty cells keep their slot
+	// until the table grows, which keeps the probe chains intact.
+	inline uint32_t Acquire(uint64_t key)
+	{
+		if (!m_slots.empty())
+		{
+			const uint32_t slot = Find(key);
+			if (slot != k_invalid)
+				return slot;
+		}
+
+		// keep the load factor at most one half
+		if ((m_occupied + 1) * 2 > m_slots.size())
+			Rehash();
+
+		size_t s = Hash(key);
+		while (m_slots[s].key != k_empty)
+			s = (s + 1) & (m_slots.size() - 1);
+
+		m_slots[s].key = key;
+		m_slots[s].head = k_invalid;
+		m_occupied++;
+
+		return static_cast<uint32_t>(s);
+	}
+
+	// rebuilds the table from the objects, dropping empty cells and growing
+	// when the live cells need it
+	inline void Rehash()
+	{
+		size_t live = 1;
+		for (const auto& slot : m_slots)
+			live += slot.head != k_invalid;
+
+		size_t capacity = 64;
+		while (capacity < live * 4)
+			capacity *= 2;
+
+		m_slots.assign(capacity, slot_t{});
+		m_occupied = 0;
+
+		for (uint32_t i = 0; i < m_cell.size(); i++)
+		{
+			if (m_cell[i] == k_invalid)
+				continue;
+
+			const uint64_t key = CellKey(m_pos[i]);
+
+			size_t s = Hash(key);
+			while (m_slots[s].key != k_empty && m_slots[s].key != key)
+				s = (s + 1) & (capacity - 1);
+
+			if (m_slots[s].key == k_empty)
+			{
+				m_slots[s].key = key;
+				m_occupied++;
+			}
+
+			m_cell[i] = k_invalid;
+			Link(i, static_cast<uint32_t>(s));
+		}
+	}
+
+	inline void Link(uint32_t handle, uint32_t slot) noexcept
+	{
+		slot_t& cell = m_slots[slot];
+
+		m_cell[handle] = slot;
+		m_prev[handle] = k_invalid;
+		m_next[handle] = cell.head;
+
+		if (cell.head != k_invalid)
+			m_prev[cell.head] = handle;
+
+		cell.head = handle;
+	}
+
+	inline void Unlink(uint32_t handle) noexcept
+	{
+		if (m_prev[handle] != k_invalid)
+			m_next[m_prev[handle]] = m_next[handle];
+		else
+			m_slots[m_cell[handle]].head = m_next[handle];
+
+		if (m_next[handle] != k_invalid)
+			m_prev[m_next[handle]] = m_prev[handle];
+	}
+
+private:
+	T m_cell_size, m_inv_cell_size;
+
+	// per object
+	std::vector<vector_3d<T>> m_pos;
+	std::vector<uint32_t> m_cell, m_next, m_prev;
+	std::vector<uint32_t> m_free;
+	size_t m_size = 0;
+
+	// open addressing cell table, capacity is a power of two
+	std::vector<slot_t> m_slots;
+	size_t m_occupied = 0;
+};
+
+} // namespace detail
+
+//
+// type declarations
+//
+
+using SpatialHash = detail::spatial_hash<float>;
+
+template<typename T> using SpatialHashT = detail::spatial_hash<T>;
+
+#endif // SPATIAL_HASH_CLASS_H
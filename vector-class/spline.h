@@ -0,0 +1,350 @@
+//
+// spline.h -- piecewise cubic curves over vector_2d/vector_3d
+//
+
+#ifndef SPLINE_CLASS_H
+#define SPLINE_CLASS_H
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+#include "vector.h"
+
+namespace detail
+{
+
+//
+// piecewise cubic curve stored in power basis, one polynomial per segment:
+//
+//	P(u) = c0 + u * (c1 + u * (c2 + u * c3)),  u in [0, 1]
+//
+// bezier, catmull-rom and hermite control points are converted to this form
+// once, so evaluation is a single Horner chain instead of the six lerps of
+// de casteljau. the curve parameter t runs from 0 to SegmentCount().
+//
+template <typename V>
+class cubic_spline
+{
+public:
+	using T = std::remove_cvref_t<decltype(V().x)>;
+
+	static_assert(std::is_floating_point_v<T>, "cubic_spline requires floating point vectors");
+
+	struct segment_t
+	{
+		V c0, c1, c2, c3;
+	};
+
+	//
+	// Construction and destruction
+	//
+
+	cubic_spline() noexcept = default;
+
+	// cubic bezier chain, points are { P0, P1, P2, P3, P4, P5, P6, ... } where
+	// every segment shares its last point with the next one (3n + 1 points).
+	inline static cubic_spline FromBezier(const V* points, size_t count)
+	{
+		cubic_spline spline;
+
+		for (size_t i = 0; i + 3 < count; i += 3)
+		{
+			const V& p0 = points[i];
+			const V& p1 = points[i + 1];
+			const V& p2 = points[i + 2];
+			const V& p3 = points[i + 3];
+
+			spline.m_segments.push_back(
+				{
+					p0,
+					(p1 - p0) * T(3),
+					(p0 - p1 * T(2) + p2) * T(3),
+					p3 - p0 + (p1 - p2) * T(3),
+				});
+		}
+
+		spline.ResetArcLength();
+		return spline;
+	}
+
+	// uniform catmull-rom through all of the points, end points are duplicated
+	// so that the curve starts at the first and ends at the last point.
+	inline static cubic_spline FromCatmullRom(const V* points, size_t count)
+	{
+		cubic_spline spline;
+
+		for (size_t i = 0; i + 1 < count; i++)
+		{
+			const V& p0 = points[i == 0 ? 0 : i - 1];
+			const V& p1 = points[i];
+			const V& p2 = points[i + 1];
+			const V& p3 = points[i + 2 < count ? i + 2 : count - 1];
+
+			spline.m_segments.push_back(
+				{
+					p1,
+					(p2 - p0) * T(0.5),
+					(p0 * T(2) - p1 * T(5) + p2 * T(4) - p3) * T(0.5),
+					(p1 * T(3) - p0 - p2 * T(3) + p3) * T(0.5),
+				});
+		}
+
+		spline.ResetArcLength();
+		return spline;
+	}
+
+	// hermite curve through points with given tangents (count of each)
+	inline static cubic_spline FromHermite(const V* points, const V* tangents, size_t count)
+	{
+		cubic_spline spline;
+
+		for (size_t i = 0; i + 1 < count; i++)
+		{
+			const V& p0 = points[i];
+			const V& m0 = tangents[i];
+			const V& p1 = points[i + 1];
+			const V& m1 = tangents[i + 1];
+
+			spline.m_segments.push_back(
+				{
+					p0,
+					m0,
+					(p1 - p0) * T(3) - m0 * T(2) - m1,
+					(p0 - p1) * T(2) + m0 + m1,
+				});
+		}
+
+		spline.ResetArcLength();
+		return spline;
+	}
+
+	//
+	// Evaluation
+	//
+
+	inline size_t SegmentCount() const noexcept
+	{
+		return m_segments.size();
+	}
+
+	inline const segment_t& GetSegment(size_t i) const noexcept
+	{
+		return m_segments[i];
+	}
+
+	// point at curve parameter t, clamped to [0, SegmentCount()]
+	inline V Evaluate(T t) const noexcept
+	{
+		if (m_segments.empty())
+			return V();
+
+		T u;
+		const auto& s = m_segments[Locate(t, u)];
+		return s.c0 + (s.c1 + (s.c2 + s.c3 * u) * u) * u;
+	}
+
+	// first derivative at curve parameter t
+	inline V Tangent(T t) const noexcept
+	{
+		if (m_segments.empty())
+			return V();
+
+		T u;
+		const auto& s = m_segments[Locate(t, u)];
+		return s.c1 + (s.c2 * T(2) + s.c3 * (T(3) * u)) * u;
+	}
+
+	// evaluates the curve for whole array of parameters. the segment lookup is
+	// hoisted out of the inner loop while consecutive parameters stay in one
+	// segment, leaving a branch-free Horner loop over the run, which works on
+	// the components one by one so that it vectorizes over the parameters.
+	inline void Evaluate(const T* t, size_t count, V* out) const noexcept
+	{
+		if (m_segments.empty())
+		{
+			std::fill(out, out + count, V());
+			return;
+		}
+
+		for (size_t i = 0; i < count; )
+		{
+			// first parameter of the run may be out of range and gets clamped
+			T u;
+			const size_t seg = Locate(t[i], u);
+			const auto& s = m_segments[seg];
+
+			out[i] = s.c0 + (s.c1 + (s.c2 + s.c3 * u) * u) * u;
+
+			// length of the run of parameters falling into this segment
+			const T lo = static_cast<T>(seg), hi = lo + T(1);
+			const bool last = seg + 1 == m_segments.size();
+
+			size_t end = i + 1;
+			while (end < count && t[end] >= lo && (t[end] < hi || (last && t[end] <= hi)))
+				end++;
+
+			EvaluateRun(s, lo, t + i + 1, end - i - 1, out + i + 1);
+			i = end;
+		}
+	}
+
+	//
+	// Arc-length reparameterization
+	//
+
+	// samples the curve at 'samples' points per segment and stores cumulative
+	// chord lengths. afterwards distance along the curve can be mapped back to
+	// the curve parameter with a binary search and one linear interpolation.
+	inline void BuildArcLength(size_t samples = 32)
+	{
+		samples = std::max<size_t>(samples, 1);
+
+		const size_t n = m_segments.size() * samples;
+
+		m_lut_t.resize(n + 1);
+		m_lut_s.resize(n + 1);
+
+		for (size_t i = 0; i <= n; i++)
+			m_lut_t[i] = static_cast<T>(i) / static_cast<T>(samples);
+
+		std::vector<V> pts(n + 1);
+		Evaluate(m_lut_t.data(), n + 1, pts.data());
+
+		m_lut_s[0] = T(0);
+		for (size_t i = 1; i <= n; i++)
+			m_lut_s[i] = m_lut_s[i - 1] + pts[i].Distance(pts[i - 1]);
+	}
+
+	// total length of the curve, requires BuildArcLength()
+	inline T ArcLength() const noexcept
+	{
+		return m_lut_s.empty() ? T(0) : m_lut_s.back();
+	}
+
+	// curve parameter at given distance from the start, requires BuildArcLength()
+	inline T ParameterAtDistance(T s) const noexcept
+	{
+		if (m_lut_s.size() < 2)
+			return T(0);
+
+		const auto it = std::upper_bound(m_lut_s.begin(), m_lut_s.end(), s);
+		if (it == m_lut_s.begin())
+			return m_lut_t.front();
+		if (it == m_lut_s.end())
+			return m_lut_t.back();
+
+		return ParameterInInterval(static_cast<size_t>(it - m_lut_s.begin()) - 1, s);
+	}
+
+	// writes 'count' points spaced evenly along the curve, requires BuildArcLength().
+	// target distances increase monotonically, so the table is walked linearly.
+	inline void ResampleUniform(size_t count, V* out) const
+	{
+		if (count == 0)
+			return;
+
+		if (m_lut_s.size() < 2)
+		{
+			std::fill(out, out + count, Evaluate(T(0)));
+			return;
+		}
+
+		std::vector<T> t(count);
+
+		const T step = count > 1 ? ArcLength() / static_cast<T>(count - 1) : T(0);
+		size_t k = 0;
+
+		for (size_t i = 0; i < count; i++)
+		{
+			const T s = step * static_cast<T>(i);
+
+			while (k + 2 < m_lut_s.size() && m_lut_s[k + 1] < s)
+				k++;
+
+			t[i] = ParameterInInterval(k, s);
+		}
+
+		Evaluate(t.data(), count, out);
+	}
+
+private:
+	// maps curve parameter to segment index and local parameter
+	inline size_t Locate(T t, T& u) const noexcept
+	{
+		const T last = static_cast<T>(m_segments.size());
+
+		if (!(t > T(0)))
+		{
+			u = T(0);
+			return 0;
+		}
+
+		if (t >= last)
+		{
+			u = T(1);
+			return m_segments.size() - 1;
+		}
+
+		const size_t seg = static_cast<size_t>(t);
+		u = t - static_cast<T>(seg);
+		return seg;
+	}
+
+	// c0 + u * (c1 + u * (c2 + u * c3)) of one component
+	static VECTORCLASS_FORCEINLINE T Horner(T c0, T c1, T c2, T c3, T u) noexcept
+	{
+		return c0 + (c1 + (c2 + c3 * u) * u) * u;
+	}
+
+	// 'count' parameters within segment 's', which starts at 'lo'
+	static inline void EvaluateRun(const segment_t& s, T lo, const T* __restrict t, size_t count, V* __restrict out) noexcept
+	{
+		for (size_t j = 0; j < count; j++)
+		{
+			const T u = t[j] - lo;
+
+			out[j].x = Horner(s.c0.x, s.c1.x, s.c2.x, s.c3.x, u);
+			out[j].y = Horner(s.c0.y, s.c1.y, s.c2.y, s.c3.y, u);
+
+			if constexpr (requires { out[j].z; })
+				out[j].z = Horner(s.c0.z, s.c1.z, s.c2.z, s.c3.z, u);
+		}
+	}
+
+	inline T ParameterInInterval(size_t k, T s) const noexcept
+	{
+		const T len = m_lut_s[k + 1] - m_lut_s[k];
+		const T f = len > T(0) ? std::clamp((s - m_lut_s[k]) / len, T(0), T(1)) : T(0);
+
+		return m_lut_t[k] + (m_lut_t[k + 1] - m_lut_t[k]) * f;
+	}
+
+	inline void ResetArcLength() noexcept
+	{
+		m_lut_t.clear();
+		m_lut_s.clear();
+	}
+
+private:
+	std::vector<segment_t> m_segments;
+
+	// arc-length table, parameter and cumulative distance
+	std::vector<T> m_lut_t, m_lut_s;
+};
+
+} // namespace detail
+
+//
+// type declarations
+//
+
+using Spline = detail::cubic_spline<detail::vector_3d<float>>;
+using Spline2D = detail::cubic_spline<detail::vector_2d<float>>;
+
+template<typename T> using SplineT = detail::cubic_spline<detail::vector_3d<T>>;
+template<typename T> using Spline2DT = detail::cubic_spline<detail::vector_2d<T>>;
+
+#endif // SPLINE_CLASS_H
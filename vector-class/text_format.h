@@ -0,0 +1,199 @@
+//
+// text_format.h -- formatting and parsing of vectors and colors as text
+//
+
+#ifndef TEXT_FORMAT_CLASS_H
+#define TEXT_FORMAT_CLASS_H
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <system_error>
+#include <type_traits>
+
+#include "vector.h"
+#include "color.h"
+
+namespace detail
+{
+
+//
+// components of the types that can be formatted, in text order
+//
+template <typename V>
+struct text_traits;
+
+template <VectorType T>
+struct text_traits<vector_2d<T>>
+{
+	using value_type = T;
+	static constexpr T vector_2d<T>::* k_members[] = { &vector_2d<T>::x, &vector_2d<T>::y };
+};
+
+template <VectorType T>
+struct text_traits<vector_3d<T>>
+{
+	using value_type = T;
+	static constexpr T vector_3d<T>::* k_members[] = { &vector_3d<T>::x, &vector_3d<T>::y, &vector_3d<T>::z };
+};
+
+template <ColorType T>
+struct text_traits<color<T>>
+{
+	using value_type = T;
+	static constexpr T color<T>::* k_members[] = { &color<T>::r, &color<T>::g, &color<T>::b, &color<T>::a };
+};
+
+template <ColorType255 T>
+struct text_traits<color255<T>>
+{
+	using value_type = T;
+	static constexpr T color255<T>::* k_members[] = { &color255<T>::r, &color255<T>::g, &color255<T>::b, &color255<T>::a };
+};
+
+template<typename V> concept TextType = requires { text_traits<V>::k_members; };
+
+//
+// built on std::to_chars and std::from_chars, so nothing allocates and
+// nothing depends on the locale. floating point components are written in
+// the shortest form that parses back to the same value.
+//
+// every value is written as its components separated by 'separator' and
+// ended by 'terminator'. parsing skips any of space, tab, comma, semicolon
+// and line breaks around components, so CSV and OBJ style lines both work.
+//
+class text_format
+{
+public:
+	// upper bound of the characters written for one value, terminator included
+	template <TextType V>
+	static constexpr size_t MaxChars() noexcept
+	{
+		using T = typename text_traits<V>::value_type;
+
+		// sign, digits, point, and an exponent of up to 4 digits with its sign
+		constexpr size_t component = std::is_floating_point_v<T> ?
+			std::numeric_limits<T>::max_digits10 + 8 : std::numeric_limits<T>::digits10 + 2;
+
+		return std::size(text_traits<V>::k_members) * (component + 1);
+	}
+
+	//
+	// Formatting
+	//
+
+	// writes one value into [first, last), returns the end of the text or
+	// nullptr when it does not fit
+	template <TextType V>
+	static inline char* Format(char* first, char* last, const V& value, char separator = ' ', char terminator = '\n') noexcept
+	{
+		for (const auto member : text_traits<V>::k_members)
+		{
+			const std::to_chars_result res = std::to_chars(first, last, value.*member);
+			if (res.ec != std::errc() || res.ptr == last)
+				return nullptr;
+
+			first = res.ptr;
+			*first++ = separator;
+		}
+
+		first[-1] = terminator;
+		return first;
+	}
+
+	// writes as many values as fit into [first, last), never a partial one.
+	// 'written' receives their count, the return value is the end of the text.
+	template <TextType V>
+	static inline char* Format(char* first, char* last, const V* values, size_t count, size_t& written,
+							   char separator = ' ', char terminator = '\n') noexcept
+	{
+		size_t i = 0;
+
+		// while a value of any length fits, there is no need to check
+		for (; i < count && last - first >= static_cast<ptrdiff_t>(MaxChars<V>()); i++)
+			first = Format(first, last, values[i], separator, terminator);
+
+		for (; i < count; i++)
+		{
+			char* end = Format(first, last, values[i], separator, terminator);
+			if (!end)
+				break;
+
+			first = end;
+		}
+
+		written = i;
+		return first;
+	}
+
+	//
+	// Parsing
+	//
+
+	// reads one value from [first, last), returns the end of its last
+	// component or nullptr for malformed or out of range text
+	template <TextType V>
+	static inline const char* Parse(const char* first, const char* last, V& value) noexcept
+	{
+		for (const auto member : text_traits<V>::k_members)
+		{
+			first = SkipSeparators(first, last);
+
+			const std::from_chars_result res = std::from_chars(first, last, value.*member);
+			if (res.ec != std::errc())
+				return nullptr;
+
+			first = res.ptr;
+		}
+
+		return first;
+	}
+
+	// reads up to 'capacity' values, stopping at the end of the text or at
+	// the first malformed value. 'parsed' receives their count, the return
+	// value is where parsing stopped. streamed text should be cut at line
+	// breaks, a number split between two buffers would be read as two.
+	template <TextType V>
+	static inline const char* Parse(const char* first, const char* last, V* values, size_t capacity, size_t& parsed) noexcept
+	{
+		size_t i = 0;
+
+		for (; i < capacity; i++)
+		{
+			first = SkipSeparators(first, last);
+			if (first == last)
+				break;
+
+			const char* end = Parse(first, last, values[i]);
+			if (!end)
+				break;
+
+			first = end;
+		}
+
+		parsed = i;
+		return SkipSeparators(first, last);
+	}
+
+private:
+	static inline const char* SkipSeparators(const char* first, const char* last) noexcept
+	{
+		while (first != last && (*first == ' ' || *first == ',' || *first == '\n' || *first == '\t' || *first == ';' || *first == '\r'))
+			first++;
+
+		return first;
+	}
+};
+
+} // namespace detail
+
+//
+// type declarations
+//
+
+using TextFormat = detail::text_format;
+
+#endif // TEXT_FORMAT_CLASS_H
@@ -6,9 +6,24 @@
 #define VECTOR_CLASS_H
 #pragma once
 
+#include <bit>
 #include <cmath>
+#include <cstdint>
+#include <limits>
 #include <type_traits>
 
+#include "instrument.h"
+
+// for small kernels called from loops that are meant to vectorize, which only
+// happens once the call is gone
+#if defined(_MSC_VER)
+#define VECTORCLASS_FORCEINLINE __forceinline
+#elif defined(__GNUC__)
+#define VECTORCLASS_FORCEINLINE inline __attribute__((always_inline))
+#else
+#define VECTORCLASS_FORCEINLINE inline
+#endif
+
 namespace detail
 {
 
@@ -19,6 +34,150 @@ namespace detail
 template<typename T>
 concept VectorType = std::is_integral_v<T> || std::is_floating_point_v<T>;
 
+//
+// square root usable in constant evaluation
+//
+
+// newton-raphson iteration started above the root, so that it decreases
+// monotonically and stops once it no longer does. float is computed in double
+// and rounded, which matches std::sqrt exactly. double is within one ulp.
+template<typename F> requires(std::is_floating_point_v<F>)
+constexpr inline F constexpr_sqrt(F x) noexcept
+{
+	using W = std::conditional_t<std::is_same_v<F, float>, double, F>;
+
+	if (x != x || x < F(0))
+		return std::numeric_limits<F>::quiet_NaN();
+
+	if (x == F(0) || x == std::numeric_limits<F>::infinity())
+		return x;
+
+	// scale into [1, 4) by powers of four, so only a few iterations are needed
+	W v = static_cast<W>(x), scale = W(1);
+	while (v >= W(4))
+	{
+		v *= W(0.25);
+		scale *= W(2);
+	}
+	while (v < W(1))
+	{
+		v *= W(4);
+		scale *= W(0.5);
+	}
+
+	W cur = v, next = W(0.5) * (cur + v / cur);
+	while (next < cur)
+	{
+		cur = next;
+		next = W(0.5) * (cur + v / cur);
+	}
+
+	return static_cast<F>(cur * scale);
+}
+
+// std::sqrt at runtime, constexpr_sqrt during constant evaluation. integral
+// arguments are computed in double, as std::sqrt would do.
+template<typename U> requires(std::is_arithmetic_v<U>)
+constexpr inline auto vector_sqrt(U x) noexcept
+{
+	using F = std::conditional_t<std::is_floating_point_v<U>, U, double>;
+
+	if (std::is_constant_evaluated())
+		return constexpr_sqrt(static_cast<F>(x));
+
+	return static_cast<F>(std::sqrt(static_cast<F>(x)));
+}
+
+template<typename U> requires(std::is_arithmetic_v<U>)
+constexpr inline auto vector_rsqrt(U x) noexcept
+{
+	using F = decltype(vector_sqrt(x));
+	return F(1) / vector_sqrt(x);
+}
+
+//
+// fused multiply-add, enabled by defining VECTORCLASS_FMA
+//
+
+// a * b + c. in FMA mode this is computed with a single rounding through
+// std::fma, which only pays off when the target has FMA instructions (e.g.
+// /arch:AVX2 or -mfma), otherwise it ends up as a library call. without the
+// define this is the plain expression, so results do not change.
+template<typename A, typename B, typename C>
+constexpr inline auto vector_fma(A a, B b, C c) noexcept
+{
+#ifdef VECTORCLASS_FMA
+	using R = decltype(a * b + c);
+
+	if constexpr (std::is_floating_point_v<R>)
+	{
+		if (!std::is_constant_evaluated())
+			return static_cast<R>(std::fma(static_cast<R>(a), static_cast<R>(b), static_cast<R>(c)));
+	}
+#endif
+
+	return a * b + c;
+}
+
+// a * b - c * d. in FMA mode the rounding error of c * d is recovered with a
+// second fma and added back (kahan's algorithm), which keeps the result within
+// a few ulps even when both products nearly cancel out, as in cross products
+// of almost parallel vectors.
+template<typename A, typename B, typename C, typename D>
+constexpr inline auto vector_diff_of_products(A a, B b, C c, D d) noexcept
+{
+#ifdef VECTORCLASS_FMA
+	using R = decltype(a * b - c * d);
+
+	if constexpr (std::is_floating_point_v<R>)
+	{
+		if (!std::is_constant_evaluated())
+		{
+			const R cd = static_cast<R>(c) * static_cast<R>(d);
+			const R err = std::fma(-static_cast<R>(c), static_cast<R>(d), cd);
+			const R dop = std::fma(static_cast<R>(a), static_cast<R>(b), -cd);
+			return static_cast<R>(dop + err);
+		}
+	}
+#endif
+
+	return a * b - c * d;
+}
+
+//
+// selects done on the bits, for kernels that are meant to vectorize. a plain
+// '?:' around arithmetic lets the compiler move that arithmetic into a
+// branch, since it might trap, and then the loop around it does not vectorize.
+//
+
+template<typename F> requires(std::is_floating_point_v<F>)
+using vector_bits_t = std::conditional_t<sizeof(F) == 4, uint32_t, uint64_t>;
+
+// 'value' if 'cond', otherwise zero
+template<typename F> requires(std::is_floating_point_v<F>)
+constexpr VECTORCLASS_FORCEINLINE F vector_keep_if(bool cond, F value) noexcept
+{
+	using U = vector_bits_t<F>;
+	return std::bit_cast<F>(std::bit_cast<U>(value) & (U(0) - U(cond)));
+}
+
+// -value if 'cond', otherwise value
+template<typename F> requires(std::is_floating_point_v<F>)
+constexpr VECTORCLASS_FORCEINLINE F vector_flip_sign(bool cond, F value) noexcept
+{
+	using U = vector_bits_t<F>;
+	return std::bit_cast<F>(std::bit_cast<U>(value) ^ (U(cond) << (sizeof(F) * 8 - 1)));
+}
+
+// 'a' if 'cond', otherwise 'b'
+template<typename F> requires(std::is_floating_point_v<F>)
+constexpr VECTORCLASS_FORCEINLINE F vector_select(bool cond, F a, F b) noexcept
+{
+	using U = vector_bits_t<F>;
+	const U mask = U(0) - U(cond);
+	return std::bit_cast<F>((std::bit_cast<U>(a) & mask) | (std::bit_cast<U>(b) & ~mask));
+}
+
 //
 // two dimensional vector class with helpers
 //
@@ -447,7 +606,7 @@ public:
 	// dot product of vector
 	constexpr inline auto Dot(const vector_2d& other) const noexcept
 	{
-		return x * other.x + y * other.y;
+		return vector_fma(y, other.y, x * other.x);
 	}
 
 	// returns length without using sqrt
@@ -456,27 +615,25 @@ public:
 		return x * x + y * y;
 	}
 
-	// cross product of vector
-	constexpr inline auto& CrossProduct(const vector_2d& a, const vector_2d& b) noexcept
+	// 2d cross product, z component of the cross product of (x, y, 0) vectors.
+	// positive when other is counter-clockwise from this vector.
+	constexpr inline auto PerpDot(const vector_2d& other) const noexcept
 	{
-		x = (a.y * b.z) - (a.z * b.y);
-		y = (a.z * b.x) - (a.x * b.z);
-
-		return *this;
+		return vector_diff_of_products(x, other.y, y, other.x);
 	}
 
 	// https://en.wikipedia.org/wiki/Linear_interpolation
 	constexpr inline void Lerp(const vector_2d& a, const vector_2d& b, float t)
 	{
-		x = a.x + (b.x - a.x) * t;
-		y = a.y + (b.y - a.y) * t;
+		x = vector_fma(b.x - a.x, t, a.x);
+		y = vector_fma(b.y - a.y, t, a.y);
 	}
 
 	// identical to VectorMA
 	constexpr inline void MulAdd(const vector_2d& a, const vector_2d& b, float scalar)
 	{
-		x = a.x + b.x * scalar;
-		y = a.y + b.y * scalar;
+		x = vector_fma(b.x, scalar, a.x);
+		y = vector_fma(b.y, scalar, a.y);
 	}
 
 	// copy contents of our vector to an allocated array
@@ -486,32 +643,25 @@ public:
 		rgfl[1] = y;
 	}
 
-	// 
-	// Runtime helpers
-	// 
-
-	// checks if the vector contents is valid
-	inline bool IsValid() const noexcept
-	{
-		return isfinite(x) && isfinite(y);
-	}
-
 	// returns length of the vector using sqrt
-	inline auto Length() const noexcept
+	constexpr inline auto Length() const noexcept
 	{
-		return static_cast<T>(sqrt(LengthSqr()));
+		VECTORCLASS_COUNT(k_vector2d_length);
+		return static_cast<T>(vector_sqrt(LengthSqr()));
 	}
 
 	// returns distance to the other vector
-	inline auto Distance(const vector_2d& ToVector) const noexcept
+	constexpr inline auto Distance(const vector_2d& ToVector) const noexcept
 	{
-		return (ToVector - *this).Length();
+		VECTORCLASS_COUNT(k_vector2d_distance);
+		return static_cast<T>(vector_sqrt((ToVector - *this).LengthSqr()));
 	}
 
 	// returns normalized vector, however does not modify it's members
-	inline auto Normalize() const noexcept
+	constexpr inline auto Normalize() const noexcept
 	{
-		T flLen = Length();
+		VECTORCLASS_COUNT(k_vector2d_normalize);
+		T flLen = static_cast<T>(vector_sqrt(LengthSqr()));
 
 		if (flLen == 0.0)
 			return vector_2d(0.0, 0.0);
@@ -520,6 +670,16 @@ public:
 		return vector_2d(x * flLen, y * flLen);
 	}
 
+	// 
+	// Runtime helpers
+	// 
+
+	// checks if the vector contents is valid
+	inline bool IsValid() const noexcept
+	{
+		return isfinite(x) && isfinite(y);
+	}
+
 public:
 	T x, y;
 };
@@ -988,13 +1148,13 @@ public:
 	// dot product of vector
 	constexpr inline auto Dot(const vector_3d& other) const noexcept
 	{
-		return x * other.x + y * other.y + z * other.z;
+		return vector_fma(z, other.z, vector_fma(y, other.y, x * other.x));
 	}
 
 	// dot product of 2D vector
 	constexpr inline auto Dot2D(const vector_3d& other) const noexcept
 	{
-		return x * other.x + y * other.y;
+		return vector_fma(y, other.y, x * other.x);
 	}
 
 	// returns length without using sqrt
@@ -1012,9 +1172,14 @@ public:
 	// cross product of vector
 	constexpr inline auto& CrossProduct(const vector_3d& a, const vector_3d& b) noexcept
 	{
-		x = (a.y * b.z) - (a.z * b.y);
-		y = (a.z * b.x) - (a.x * b.z);
-		z = (a.x * b.y) - (a.y * b.x);
+		// store into temporaries first, so that a or b may alias *this
+		const T cx = vector_diff_of_products(a.y, b.z, a.z, b.y);
+		const T cy = vector_diff_of_products(a.z, b.x, a.x, b.z);
+		const T cz = vector_diff_of_products(a.x, b.y, a.y, b.x);
+
+		x = cx;
+		y = cy;
+		z = cz;
 
 		return *this;
 	}
@@ -1022,17 +1187,17 @@ public:
 	// https://en.wikipedia.org/wiki/Linear_interpolation
 	constexpr inline void Lerp(const vector_3d& a, const vector_3d& b, float t)
 	{
-		x = a.x + (b.x - a.x) * t;
-		y = a.y + (b.y - a.y) * t;
-		z = a.z + (b.z - a.z) * t;
+		x = vector_fma(b.x - a.x, t, a.x);
+		y = vector_fma(b.y - a.y, t, a.y);
+		z = vector_fma(b.z - a.z, t, a.z);
 	}
 
 	// identical to VectorMA
 	constexpr inline void MulAdd(const vector_3d& a, const vector_3d& b, float scalar)
 	{
-		x = a.x + b.x * scalar;
-		y = a.y + b.y * scalar;
-		z = a.z + b.z * scalar;
+		x = vector_fma(b.x, scalar, a.x);
+		y = vector_fma(b.y, scalar, a.y);
+		z = vector_fma(b.z, scalar, a.z);
 	}
 
 	// returns new instance of Vector2D
@@ -1049,44 +1214,39 @@ public:
 		rgfl[2] = z;
 	}
 
-	// 
-	// Runtime helpers
-	// 
-
-	// checks if the vector contents is valid
-	inline bool IsValid() const noexcept
-	{
-		return isfinite(x) && isfinite(y) && isfinite(z);
-	}
-
 	// returns length of the vector using sqrt
-	inline auto Length() const noexcept
+	constexpr inline auto Length() const noexcept
 	{
-		return static_cast<T>(sqrt(LengthSqr()));
+		VECTORCLASS_COUNT(k_vector_length);
+		return static_cast<T>(vector_sqrt(LengthSqr()));
 	}
 
 	// returns length of the 2D vector using sqrt
-	inline auto Length2D() const noexcept
+	constexpr inline auto Length2D() const noexcept
 	{
-		return static_cast<T>(sqrt(LengthSqr2D()));
+		VECTORCLASS_COUNT(k_vector_length_2d);
+		return static_cast<T>(vector_sqrt(LengthSqr2D()));
 	}
 
 	// returns distance to the other vector
-	inline auto Distance(const vector_3d& ToVector) const noexcept
+	constexpr inline auto Distance(const vector_3d& ToVector) const noexcept
 	{
-		return (ToVector - *this).Length();
+		VECTORCLASS_COUNT(k_vector_distance);
+		return static_cast<T>(vector_sqrt((ToVector - *this).LengthSqr()));
 	}
 
 	// returns 2D distance to the other vector
-	inline auto Distance2D(vector_3d& ToVector) const noexcept
+	constexpr inline auto Distance2D(vector_3d& ToVector) const noexcept
 	{
-		return (ToVector - *this).Length2D();
+		VECTORCLASS_COUNT(k_vector_distance_2d);
+		return static_cast<T>(vector_sqrt((ToVector - *this).LengthSqr2D()));
 	}
 
 	// returns normalized vector, however does not modify it's members
-	inline auto Normalize() const noexcept
+	constexpr inline auto Normalize() const noexcept
 	{
-		T flLen = Length();
+		VECTORCLASS_COUNT(k_vector_normalize);
+		T flLen = static_cast<T>(vector_sqrt(LengthSqr()));
 
 		if (flLen == 0.0)
 			return vector_3d(0.0, 0.0, 1.0);
@@ -1095,9 +1255,10 @@ public:
 		return vector_3d(x * flLen, y * flLen, z * flLen);
 	}
 
-	inline auto NormalizeInPlace() noexcept
+	constexpr inline auto NormalizeInPlace() noexcept
 	{
-		T flLen = Length();
+		VECTORCLASS_COUNT(k_vector_normalize_in_place);
+		T flLen = static_cast<T>(vector_sqrt(LengthSqr()));
 
 		if (flLen == 0)
 		{
@@ -1115,6 +1276,16 @@ public:
 		return flLen;
 	}
 
+	// 
+	// Runtime helpers
+	// 
+
+	// checks if the vector contents is valid
+	inline bool IsValid() const noexcept
+	{
+		return isfinite(x) && isfinite(y) && isfinite(z);
+	}
+
 public:
 	T x, y, z;
 };
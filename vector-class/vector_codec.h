@@ -0,0 +1,490 @@
+//
+// vector_codec.h -- lossy delta codec for streams of vector_3d
+//
+
+#ifndef VECTOR_CODEC_CLASS_H
+#define VECTOR_CODEC_CLASS_H
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "vector.h"
+#include "parallel.h"
+
+namespace detail
+{
+
+//
+// coordinates are quantized to multiples of 'step', predicted from the
+// previous values and only the residuals are stored. residuals are zigzag
+// encoded and bit packed in blocks of 128 per coordinate, every block with
+// its own bit width. within a block the values are spread over 4 lanes of 32
+// bit words, value i in lane i % 4, so that unpacking shifts all lanes by the
+// same amount and decoding runs 4 values at once.
+//
+// the stream is a sequence of self-contained chunks, each one carries its
+// step and predictor, which allows encoding and decoding chunk by chunk as
+// well as in parallel. the layout is little endian:
+//
+//	uint32	vector count
+//	uint32	payload bytes following the header
+//	float64	step
+//	uint8	predictor, 3 bytes padding
+//	x, y, z streams:
+//		int32	first quantized value
+//		blocks of 128 residuals:	uint8 bit width, 16 * width bytes of bits
+//
+// every decoded coordinate is within step / 2 of the input, unless the input
+// was outside of the quantized range (2^31 steps), where it is clamped.
+//
+template <VectorType T> requires(std::is_floating_point_v<T>)
+class vector_codec
+{
+public:
+	enum predictor_t : uint8_t
+	{
+		k_previous,	// q[i - 1], good for noisy or static data
+		k_linear,	// 2 * q[i - 1] - q[i - 2], good for smooth trajectories
+	};
+
+	static constexpr size_t k_header_size = 20;
+	static constexpr size_t k_lanes = 4;
+	static constexpr size_t k_block = 32 * k_lanes;
+
+	// vectors per chunk by default
+	static constexpr size_t k_default_chunk = 4096;
+
+	// largest chunk whose count and payload size both fit the uint32 header
+	// fields, with every block at the full 32 bit width
+	static constexpr size_t k_max_chunk = (std::numeric_limits<uint32_t>::max() / 3 - 4) / (1 + 16 * 32) * k_block;
+
+	//
+	// Construction and destruction
+	//
+
+	// 'step' has to be positive and finite, 'chunk' is clamped to
+	// [1, k_max_chunk]
+	vector_codec(T step, predictor_t predictor = k_linear, size_t chunk = k_default_chunk) noexcept :
+		m_step(step),
+		m_predictor(predictor),
+		m_chunk(std::clamp<size_t>(chunk, 1, k_max_chunk))
+	{
+		// also false for NaN
+		assert(step > T(0) && step <= std::numeric_limits<T>::max());
+	}
+
+	inline T Step() const noexcept
+	{
+		return m_step;
+	}
+
+	// largest difference of a decoded coordinate from the input, for inputs
+	// within the quantized range. on top of this comes the rounding of the
+	// decoded value to T, which Encode() includes in the error it returns.
+	inline T ErrorBound() const noexcept
+	{
+		return m_step * T(0.5);
+	}
+
+	//
+	// whole streams, chunks are encoded and decoded in parallel
+	//
+
+	// appends the encoded stream to 'out' and returns the largest error of
+	// a coordinate, which is above ErrorBound() only for clamped inputs
+	inline T Encode(const vector_3d<T>* in, size_t count, std::vector<uint8_t>& out) const
+	{
+		const size_t chunks = (count + m_chunk - 1) / m_chunk;
+
+		std::vector<std::vector<uint8_t>> encoded(chunks);
+		std::vector<T> errors(chunks, T(0));
+
+		parallel_for(chunks, 1, [&](size_t begin, size_t end)
+		{
+			for (size_t c = begin; c < end; c++)
+			{
+				const size_t lo = c * m_chunk, n = std::min(m_chunk, count - lo);
+				errors[c] = EncodeChunk(in + lo, n, encoded[c]);
+			}
+		});
+
+		size_t total = out.size();
+		for (const auto& chunk : encoded)
+			total += chunk.size();
+
+		out.reserve(total);
+		for (const auto& chunk : encoded)
+			out.insert(out.end(), chunk.begin(), chunk.end());
+
+		return errors.empty() ? T(0) : *std::max_element(errors.begin(), errors.end());
+	}
+
+	// appends decoded vectors to 'out', returns false for truncated or
+	// malformed data, in which case 'out' keeps the chunks decoded before
+	static inline bool Decode(const uint8_t* data, size_t size, std::vector<vector_3d<T>>& out)
+	{
+		struct chunk_t
+		{
+			size_t offset, count, first;
+		};
+
+		// chunk sizes are in the headers, so the chunks can be located first.
+		// PeekChunk() checks the counts against the sizes before anything
+		// is allocated for them.
+		std::vector<chunk_t> chunks;
+		size_t offset = 0, total = out.size();
+		bool valid = true;
+
+		while (offset < size)
+		{
+			size_t count, bytes;
+			if (!PeekChunk(data + offset, size - offset, count, bytes))
+			{
+				valid = false;
+				break;
+			}
+
+			chunks.push_back({ offset, count, total });
+			offset += bytes;
+			total += count;
+		}
+
+		out.resize(total);
+
+		std::vector<uint8_t> ok(chunks.size(), 1);
+		parallel_for(chunks.size(), 1, [&](size_t begin, size_t end)
+		{
+			for (size_t c = begin; c < end; c++)
+			{
+				size_t consumed;
+				ok[c] = DecodeChunk(data + chunks[c].offset, size - chunks[c].offset, out.data() + chunks[c].first, consumed) == chunks[c].count;
+			}
+		});
+
+		// drop everything from the first broken chunk on
+		for (size_t c = 0; c < chunks.size(); c++)
+		{
+			if (!ok[c])
+			{
+				out.resize(chunks[c].first);
+				return false;
+			}
+		}
+
+		return valid;
+	}
+
+	//
+	// single chunks, for streaming
+	//
+
+	// appends one chunk with all of 'in' and returns the largest error,
+	// 'count' has to be at most k_max_chunk
+	inline T EncodeChunk(const vector_3d<T>* in, size_t count, std::vector<uint8_t>& out) const
+	{
+		assert(count <= k_max_chunk);
+
+		const size_t start = out.size();
+		out.resize(start + k_header_size);
+
+		const T inv_step = T(1) / m_step;
+		T max_error = T(0);
+
+		// the largest error is measured on the values the decoder will produce
+		const size_t stride = count + k_block;
+		std::vector<uint32_t> planes(stride * 3);
+		uint32_t* __restrict qx = planes.data();
+		uint32_t* __restrict qy = qx + stride;
+		uint32_t* __restrict qz = qy + stride;
+
+		for (size_t i = 0; i < count; i++)
+		{
+			qx[i] = Quantize(in[i].x, inv_step);
+			qy[i] = Quantize(in[i].y, inv_step);
+			qz[i] = Quantize(in[i].z, inv_step);
+
+			const T ex = Distance(ToCoord(qx[i], m_step), in[i].x);
+			const T ey = Distance(ToCoord(qy[i], m_step), in[i].y);
+			const T ez = Distance(ToCoord(qz[i], m_step), in[i].z);
+			max_error = std::max(max_error, std::max(ex, std::max(ey, ez)));
+		}
+
+		std::vector<uint32_t> residuals(stride);
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			const uint32_t* q = planes.data() + axis * stride;
+
+			// residuals wrap around in unsigned arithmetic, decoding wraps the
+			// same way. the second value is always predicted by the first one.
+			for (size_t i = 1; i < count; i++)
+			{
+				const uint32_t pred = (m_predictor == k_linear && i > 1) ? 2u * q[i - 1] - q[i - 2] : q[i - 1];
+				const uint32_t r = q[i] - pred;
+				residuals[i] = r << 1 ^ static_cast<uint32_t>(static_cast<int32_t>(r) >> 31);
+			}
+
+			Put(out, count ? q[0] : 0u);
+
+			// the values past the end are zero and pad the last block
+			for (size_t lo = 1; lo < count; lo += k_block)
+				PackBlock(residuals.data() + lo, std::min(k_block, count - lo), out);
+		}
+
+		const uint32_t header[2] = { static_cast<uint32_t>(count), static_cast<uint32_t>(out.size() - start - k_header_size) };
+		const double step = static_cast<double>(m_step);
+
+		std::memcpy(&out[start], header, sizeof(header));
+		std::memcpy(&out[start + 8], &step, sizeof(step));
+		out[start + 16] = m_predictor;
+		out[start + 17] = out[start + 18] = out[start + 19] = 0;
+
+		return max_error;
+	}
+
+	// reads the header of the chunk at 'data', returns false when it does
+	// not fit in 'size' bytes or its payload is too short for the count
+	static inline bool PeekChunk(const uint8_t* data, size_t size, size_t& count, size_t& bytes) noexcept
+	{
+		if (size < k_header_size)
+			return false;
+
+		uint32_t header[2];
+		std::memcpy(header, data, sizeof(header));
+
+		count = header[0];
+		bytes = k_header_size + header[1];
+
+		// every coordinate takes at least its first value and one width byte
+		// per block, so the count cannot ask for more than the bytes allow
+		const size_t blocks = count > 1 ? (count - 1 + k_block - 1) / k_block : 0;
+		return bytes <= size && header[1] >= 3 * (4 + blocks);
+	}
+
+	// decodes the chunk at 'data' into 'out', which has room for the count
+	// from PeekChunk(). returns the count, or SIZE_MAX for malformed data.
+	static inline size_t DecodeChunk(const uint8_t* data, size_t size, vector_3d<T>* out, size_t& consumed)
+	{
+		size_t count, bytes;
+		if (!PeekChunk(data, size, count, bytes))
+			return SIZE_MAX;
+
+		if (data[16] > k_linear)
+			return SIZE_MAX;
+
+		double step;
+		std::memcpy(&step, data + 8, sizeof(step));
+		const predictor_t predictor = static_cast<predictor_t>(data[16]);
+
+		const uint8_t* at = data + k_header_size;
+		const uint8_t* end = data + bytes;
+
+		if (count == 0)
+		{
+			consumed = bytes;
+			return 0;
+		}
+
+		// residuals of the three coordinates are unpacked first, then summed
+		// up side by side, which keeps three independent dependency chains
+		const size_t stride = 1 + (count - 1 + k_block - 1) / k_block * k_block;
+		std::vector<uint32_t> planes(stride * 3);
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			uint32_t* plane = planes.data() + axis * stride;
+
+			if (end - at < 4)
+				return SIZE_MAX;
+
+			std::memcpy(plane, at, sizeof(uint32_t));
+			at += 4;
+
+			for (size_t lo = 1; lo < count; lo += k_block)
+			{
+				if (at >= end || *at > 32 || end - at < static_cast<ptrdiff_t>(1 + *at * 4 * k_lanes))
+					return SIZE_MAX;
+
+				s_unpack[*at](at + 1, plane + lo);
+				at += 1 + *at * 4 * k_lanes;
+			}
+		}
+
+		const T scale = static_cast<T>(step);
+		const uint32_t* __restrict rx = planes.data();
+		const uint32_t* __restrict ry = rx + stride;
+		const uint32_t* __restrict rz = ry + stride;
+
+		uint32_t px = rx[0], py = ry[0], pz = rz[0];
+		out[0] = vector_3d<T>(ToCoord(px, scale), ToCoord(py, scale), ToCoord(pz, scale));
+
+		// the linear prediction error is the change of the delta, so both
+		// predictors are running sums. the delta starts at zero, which
+		// predicts the second value from the first one.
+		if (predictor == k_linear)
+		{
+			uint32_t dx = 0, dy = 0, dz = 0;
+			for (size_t i = 1; i < count; i++)
+			{
+				px += dx += rx[i];
+				py += dy += ry[i];
+				pz += dz += rz[i];
+				out[i] = vector_3d<T>(ToCoord(px, scale), ToCoord(py, scale), ToCoord(pz, scale));
+			}
+		}
+		else
+		{
+			for (size_t i = 1; i < count; i++)
+			{
+				px += rx[i];
+				py += ry[i];
+				pz += rz[i];
+				out[i] = vector_3d<T>(ToCoord(px, scale), ToCoord(py, scale), ToCoord(pz, scale));
+			}
+		}
+
+		consumed = bytes;
+		return count;
+	}
+
+private:
+	inline static uint32_t Quantize(T v, T inv_step) noexcept
+	{
+		// NaN goes to zero, the clamp keeps the conversion defined. the limit is
+		// the largest float below 2^31, so that it is exact for float as well.
+		T s = v * inv_step;
+		s = s == s ? s : T(0);
+		s = s > T(-2147483520.0) ? s : T(-2147483520.0);
+		s = s < T(2147483520.0) ? s : T(2147483520.0);
+
+		// rounds half away from zero without a call into the math library,
+		// the fraction after truncation is exact at any magnitude
+		const int32_t t = static_cast<int32_t>(s);
+		const T frac = s - static_cast<T>(t);
+		return static_cast<uint32_t>(t + (frac >= T(0.5)) - (frac <= T(-0.5)));
+	}
+
+	inline static void Put(std::vector<uint8_t>& out, uint32_t v)
+	{
+		const size_t at = out.size();
+		out.resize(at + sizeof(v));
+		std::memcpy(&out[at], &v, sizeof(v));
+	}
+
+	inline static T ToCoord(uint32_t q, T scale) noexcept
+	{
+		return static_cast<T>(static_cast<int32_t>(q)) * scale;
+	}
+
+	// |a - b|, with the product in ToCoord() rounded first. written as max -
+	// min, the compiler cannot contract it into a fused multiply-add, which
+	// would measure the error of a value the decoder never produces.
+	inline static T Distance(T a, T b) noexcept
+	{
+		return std::max(a, b) - std::min(a, b);
+	}
+
+	// n <= k_block values at the smallest width that fits all of them, the
+	// values up to k_block are read as well and have to be zero
+	inline static void PackBlock(const uint32_t* values, size_t n, std::vector<uint8_t>& out)
+	{
+		uint32_t any = 0;
+		for (size_t i = 0; i < n; i++)
+			any |= values[i];
+
+		const uint32_t width = any ? 32 - std::countl_zero(any) : 0;
+
+		// word k of every lane is at k * k_lanes + lane
+		uint32_t words[(32 + 1) * k_lanes] = {};
+		for (uint32_t j = 0; width && j < 32; j++)
+		{
+			const uint32_t bit = j * width, shift = bit & 31;
+			uint32_t* lo = words + (bit >> 5) * k_lanes;
+
+			for (size_t lane = 0; lane < k_lanes; lane++)
+				lo[lane] |= values[j * k_lanes + lane] << shift;
+
+			// bits spilling over into the next word of the lanes
+			if (shift + width > 32)
+			{
+				for (size_t lane = 0; lane < k_lanes; lane++)
+					lo[k_lanes + lane] |= values[j * k_lanes + lane] >> (32 - shift);
+			}
+		}
+
+		const size_t at = out.size();
+		out.resize(at + 1 + width * 4 * k_lanes);
+		out[at] = static_cast<uint8_t>(width);
+		std::memcpy(&out[at + 1], words, width * 4 * k_lanes);
+	}
+
+	// one unpacker per bit width, which also undoes the zigzag encoding. the
+	// shifts are the same for all lanes, words past the end of the block are
+	// only read when bits spill into them. blocks of width 0 have no bits
+	// stored and may sit at the very end of the data.
+	template <uint32_t W>
+	static void UnpackWidth(const uint8_t* bits, uint32_t* values) noexcept
+	{
+		if constexpr (W == 0)
+		{
+			std::fill_n(values, k_block, 0u);
+			return;
+		}
+
+		constexpr uint32_t mask = W < 32 ? (1u << W) - 1 : ~0u;
+
+		for (uint32_t j = 0; j < 32; j++)
+		{
+			const uint32_t bit = j * W, shift = bit & 31;
+
+			uint32_t lo[k_lanes], hi[k_lanes] = {};
+			std::memcpy(lo, bits + (bit >> 5) * 4 * k_lanes, sizeof(lo));
+			if (shift + W > 32)
+				std::memcpy(hi, bits + ((bit >> 5) + 1) * 4 * k_lanes, sizeof(hi));
+
+			for (size_t lane = 0; lane < k_lanes; lane++)
+			{
+				const uint32_t v = static_cast<uint32_t>((lo[lane] | static_cast<uint64_t>(hi[lane]) << 32) >> shift) & mask;
+				values[j * k_lanes + lane] = v >> 1 ^ (0u - (v & 1));
+			}
+		}
+	}
+
+	using unpack_t = void (*)(const uint8_t*, uint32_t*) noexcept;
+
+	template <size_t... W>
+	static constexpr std::array<unpack_t, sizeof...(W)> MakeUnpackers(std::index_sequence<W...>) noexcept
+	{
+		return { &UnpackWidth<static_cast<uint32_t>(W)>... };
+	}
+
+	static constexpr std::array<unpack_t, 33> s_unpack = MakeUnpackers(std::make_index_sequence<33>());
+
+private:
+	T m_step;
+	predictor_t m_predictor;
+	size_t m_chunk;
+};
+
+} // namespace detail
+
+//
+// type declarations
+//
+
+using VectorCodec = detail::vector_codec<float>;
+
+template<typename T> using VectorCodecT = detail::vector_codec<T>;
+
+#endif // VECTOR_CODEC_CLASS_H
@@ -0,0 +1,301 @@
+//
+// vector_random.h -- uniform random vectors on spheres, disks and in boxes
+//
+
+#ifndef VECTOR_RANDOM_CLASS_H
+#define VECTOR_RANDOM_CLASS_H
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "vector.h"
+#include "angles.h"
+#include "parallel.h"
+
+namespace detail
+{
+
+//
+// xoshiro128+ running in k_lanes independent lanes, so that generating a
+// block of numbers is a loop over the lanes that vectorizes. there are enough
+// of them for the compiler to keep it a loop rather than unrolling it. floats take
+// the upper 24 bits of one output, doubles 53 bits out of two.
+//
+// every (seed, stream) pair gives an independent sequence, so each thread
+// can own its generator. the samples are drawn directly from the wanted
+// distribution, without rejection or normalizing random points, which would
+// skew the directions towards the corners of the cube.
+//
+// OnSphere() and InDisk() take a square root per vector, their loops only
+// vectorize when std::sqrt is allowed to skip errno (-fno-math-errno).
+//
+// numbers are produced in blocks, what is left of a block after a call is
+// dropped. the sequence therefore depends on how it is split into calls, but
+// the same calls on the same seed always give the same results.
+//
+template <VectorType T> requires(std::is_floating_point_v<T>)
+class vector_random
+{
+public:
+	static constexpr size_t k_lanes = 64;
+
+	// vectors produced at once
+	static constexpr size_t k_chunk = 256;
+
+	// vectors per stream in Parallel()
+	static constexpr size_t k_block = 16384;
+
+	//
+	// Construction and destruction
+	//
+
+	vector_random(uint64_t seed, uint64_t stream = 0) noexcept
+	{
+		Seed(seed, stream);
+	}
+
+	inline void Seed(uint64_t seed, uint64_t stream = 0) noexcept
+	{
+		// the stream is mixed in before the lanes are drawn, so neighbouring
+		// streams do not share any state
+		uint64_t x = SplitMix(seed) ^ (stream * 0xd1b54a32d192ed03ull);
+
+		for (size_t lane = 0; lane < k_lanes; lane++)
+		{
+			const uint64_t a = SplitMix(x), b = SplitMix(x);
+
+			m_state[0][lane] = static_cast<uint32_t>(a);
+			m_state[1][lane] = static_cast<uint32_t>(a >> 32);
+			m_state[2][lane] = static_cast<uint32_t>(b);
+			m_state[3][lane] = static_cast<uint32_t>(b >> 32) | 1; // never all zero
+		}
+	}
+
+	//
+	// Scalars
+	//
+
+	// uniform in [0, 1)
+	inline void Uniform(T* out, size_t count) noexcept
+	{
+		uint32_t words[k_chunk * k_words];
+
+		for (size_t first = 0; first < count; first += k_chunk)
+		{
+			const size_t n = std::min(k_chunk, count - first);
+			Generate(words, n * k_words);
+
+			for (size_t i = 0; i < n; i++)
+				out[first + i] = ToUnit(words, i);
+		}
+	}
+
+	//
+	// Directions and points
+	//
+
+	// on the sphere of 'radius' around the origin
+	inline void OnSphere(vector_3d<T>* out, size_t count, T radius = T(1)) noexcept
+	{
+		ForChunks<2>(count, [&](const T (*u)[k_chunk], size_t first, size_t n)
+		{
+			for (size_t i = 0; i < n; i++)
+			{
+				// z is uniform on the sphere (archimedes), the angle around it too
+				const T z = T(1) - T(2) * u[0][i];
+				const T r = vector_sqrt(std::max(T(1) - z * z, T(0))) * radius;
+				const auto sc = euler_angles<T>::SinCos(T(360) * u[1][i]);
+
+				out[first + i].x = r * sc.cos;
+				out[first + i].y = r * sc.sin;
+				out[first + i].z = z * radius;
+			}
+		});
+	}
+
+	// on the unit hemisphere around 'normal', which has to be normalized
+	inline void OnHemisphere(vector_3d<T>* out, size_t count, const vector_3d<T>& normal) noexcept
+	{
+		OnSphere(out, count);
+
+		// points below the plane are mirrored through it, which keeps the
+		// distribution uniform
+		for (size_t i = 0; i < count; i++)
+		{
+			const T d = out[i].x * normal.x + out[i].y * normal.y + out[i].z * normal.z;
+			const T m = T(2) * std::min(d, T(0));
+
+			out[i].x -= m * normal.x;
+			out[i].y -= m * normal.y;
+			out[i].z -= m * normal.z;
+		}
+	}
+
+	// in the disk of 'radius' around the origin
+	inline void InDisk(vector_2d<T>* out, size_t count, T radius = T(1)) noexcept
+	{
+		ForChunks<2>(count, [&](const T (*u)[k_chunk], size_t first, size_t n)
+		{
+			for (size_t i = 0; i < n; i++)
+			{
+				// the square root evens out the area of the rings
+				const T r = vector_sqrt(u[0][i]) * radius;
+				const auto sc = euler_angles<T>::SinCos(T(360) * u[1][i]);
+
+				out[first + i].x = r * sc.cos;
+				out[first + i].y = r * sc.sin;
+			}
+		});
+	}
+
+	// in the box [mins, maxs]. the unit numbers stay below one, but scaling
+	// them to the box can round up to 'maxs'.
+	inline void InBox(vector_3d<T>* out, size_t count, const vector_3d<T>& mins, const vector_3d<T>& maxs) noexcept
+	{
+		const vector_3d<T> size = maxs - mins;
+
+		ForChunks<3>(count, [&](const T (*u)[k_chunk], size_t first, size_t n)
+		{
+			for (size_t i = 0; i < n; i++)
+			{
+				out[first + i].x = vector_fma(u[0][i], size.x, mins.x);
+				out[first + i].y = vector_fma(u[1][i], size.y, mins.y);
+				out[first + i].z = vector_fma(u[2][i], size.z, mins.z);
+			}
+		});
+	}
+
+	// in the rectangle [mins, maxs], see above
+	inline void InBox(vector_2d<T>* out, size_t count, const vector_2d<T>& mins, const vector_2d<T>& maxs) noexcept
+	{
+		const vector_2d<T> size = maxs - mins;
+
+		ForChunks<2>(count, [&](const T (*u)[k_chunk], size_t first, size_t n)
+		{
+			for (size_t i = 0; i < n; i++)
+			{
+				out[first + i].x = vector_fma(u[0][i], size.x, mins.x);
+				out[first + i].y = vector_fma(u[1][i], size.y, mins.y);
+			}
+		});
+	}
+
+	//
+	// Parallel generation
+	//
+
+	// fills 'out' in blocks of k_block, each from its own stream of 'seed'.
+	// fn is called as fn(vector_random& rng, V* out, size_t count), e.g.
+	//
+	//	VectorRandom::Parallel(seed, dirs, count, [](auto& rng, Vector* out, size_t n) { rng.OnSphere(out, n); });
+	//
+	// the result does not depend on the number of threads.
+	template <typename V, typename Fn>
+	static void Parallel(uint64_t seed, V* out, size_t count, Fn&& fn)
+	{
+		const size_t blocks = (count + k_block - 1) / k_block;
+
+		parallel_for(blocks, 1, [&](size_t begin, size_t end)
+		{
+			for (size_t block = begin; block < end; block++)
+			{
+				const size_t first = block * k_block;
+
+				vector_random rng(seed, block);
+				fn(rng, out + first, std::min(k_block, count - first));
+			}
+		});
+	}
+
+private:
+	// 32 bit outputs per number
+	static constexpr size_t k_words = sizeof(T) == 4 ? 1 : 2;
+
+	static inline uint64_t SplitMix(uint64_t& x) noexcept
+	{
+		uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+
+	static constexpr uint32_t Rotl(uint32_t x, int k) noexcept
+	{
+		return (x << k) | (x >> (32 - k));
+	}
+
+	// 'count' words, rounded up to a multiple of k_lanes
+	inline void Generate(uint32_t* words, size_t count) noexcept
+	{
+		uint32_t* s0 = m_state[0];
+		uint32_t* s1 = m_state[1];
+		uint32_t* s2 = m_state[2];
+		uint32_t* s3 = m_state[3];
+
+		for (size_t first = 0; first < count; first += k_lanes)
+		{
+			for (size_t lane = 0; lane < k_lanes; lane++)
+			{
+				words[first + lane] = s0[lane] + s3[lane];
+
+				const uint32_t t = s1[lane] << 9;
+				s2[lane] ^= s0[lane];
+				s3[lane] ^= s1[lane];
+				s1[lane] ^= s2[lane];
+				s0[lane] ^= s3[lane];
+				s2[lane] ^= t;
+				s3[lane] = Rotl(s3[lane], 11);
+			}
+		}
+	}
+
+	// i-th number of a generated block in [0, 1), from its upper bits
+	static VECTORCLASS_FORCEINLINE T ToUnit(const uint32_t* words, size_t i) noexcept
+	{
+		if constexpr (sizeof(T) == 4)
+			return static_cast<T>(words[i] >> 8) * T(0x1p-24);
+		else
+			return (static_cast<T>(words[i * 2] >> 5) * T(0x1p26) + static_cast<T>(words[i * 2 + 1] >> 6)) * T(0x1p-53);
+	}
+
+	// fn(u, first, n) for chunks of up to k_chunk vectors, u[j][i] is the
+	// j-th of the N uniform numbers drawn for vector first + i
+	template <size_t N, typename Fn>
+	inline void ForChunks(size_t count, Fn&& fn) noexcept
+	{
+		uint32_t words[k_chunk * N * k_words];
+		T u[N][k_chunk];
+
+		for (size_t first = 0; first < count; first += k_chunk)
+		{
+			const size_t n = std::min(k_chunk, count - first);
+			Generate(words, n * N * k_words);
+
+			for (size_t j = 0; j < N; j++)
+			{
+				for (size_t i = 0; i < n; i++)
+					u[j][i] = ToUnit(words + j * n * k_words, i);
+			}
+
+			fn(u, first, n);
+		}
+	}
+
+private:
+	alignas(32) uint32_t m_state[4][k_lanes];
+};
+
+} // namespace detail
+
+//
+// type declarations
+//
+
+using VectorRandom = detail::vector_random<float>;
+
+template<typename T> using VectorRandomT = detail::vector_random<T>;
+
+#endif // VECTOR_RANDOM_CLASS_H